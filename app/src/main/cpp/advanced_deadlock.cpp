@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "advanced_deadlock.h"
 #include "bfs.h"
@@ -20,6 +21,7 @@
 
 #include "xy_deadlock.h"
 #include "stuck.h"
+#include "deadlock_cache.h"
 
 /*
 int stuck_after_pull(board b, int y, int x, int d)
@@ -82,9 +84,9 @@ int simple_pull_box_eliminator(board b)
 	int sok_y, sok_x, to_y, to_x;
 	int changed = 0;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -139,8 +141,8 @@ int eliminate_from_zone(board base, board final_pos, int_board zones, int z)
 
 	// so now we are left only with boxes that can never be moved.
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (e[i][j] & BOX)
 				if ((base[i][j] & BOX) == 0)
 					return 0;
@@ -182,12 +184,12 @@ int free_pull_deadlock(board b_in)
 
 	back_eliminate_loop(b);
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & BOX)
-				if ((initial_board[i][j] & BOX) == 0)
+				if ((current_level->initial_board[i][j] & BOX) == 0)
 				{
 //					printf("found free pull deadlock\n");
 //					print_board(b_in);
@@ -281,8 +283,8 @@ int check_matching_deadlock(board b_in, int pull_mode, int search_mode)
 
 
 	// see if this is BASE_SEARCH
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b_in[i][j] & BASE)
 				has_bases = 1;
 
@@ -291,7 +293,7 @@ int check_matching_deadlock(board b_in, int pull_mode, int search_mode)
 	{
 		turn_fixed_boxes_into_walls(b_in, b);
 
-		for (i = 0; i < index_num; i++)
+		for (i = 0; i < current_level->index_num; i++)
 		{
 			index_to_y_x(i, &y, &x);
 			if (b[y][x] & BOX)
@@ -302,13 +304,13 @@ int check_matching_deadlock(board b_in, int pull_mode, int search_mode)
 	}
 	else
 	{
-		for (i = 0; i < index_num; i++)
+		for (i = 0; i < current_level->index_num; i++)
 		{
 			index_to_y_x(i, &y, &x);
 
 			if (has_bases == 0)
 			{
-				if (initial_board[y][x] & BOX)
+				if (current_level->initial_board[y][x] & BOX)
 					box_places[box_num++] = i;
 			}
 			else
@@ -361,19 +363,19 @@ int check_matching_deadlock(board b_in, int pull_mode, int search_mode)
 			}
 		}
 
-		free(gd);
+		free_graph(gd);
 	}
 	else
 	{
 		for (i = 0; i < box_num; i++)
 			for (j = 0; j < target_num; j++)
-				if (distance_from_to[box_places[i]][target_places[j]] < 1000000)
+				if (get_push_distance(box_places[i], target_places[j]) < 1000000)
 					cost[i][j] = 0;
 	}
 
 	hc = allocate_hungarian_cache(); // dummy, just for interface
 	solve_hungarian(box_num, cost, &sol, hc);
-	free(hc);
+	free_hungarian_cache(hc);
 
 	if (pull_mode == 0)
 	{
@@ -400,7 +402,7 @@ int verify_simple_base_matching(board b, board board_with_bases)
 	int bases_num = 0;
 	int box_index, base_index;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 
@@ -425,7 +427,7 @@ int verify_simple_base_matching(board b, board board_with_bases)
 		for (j = 0; j < box_num; j++)
 		{
 			box_index = box_places[j];
-			if (distance_from_to[base_index][box_index] != 1000000)
+			if (get_push_distance(base_index, box_index) != 1000000)
 				break;
 		}
 		if (j == box_num)
@@ -451,40 +453,214 @@ int start_zone_is_deadlocked(board b)
 }
 
 
-int board_is_deadlocked(board b, int pull_mode, int search_mode)
+// The detectors of board_is_deadlocked, in their default order.
+// With -adaptive_deadlocks, the order is changed during the search by the measured
+// hits per microsecond, and detectors that almost never fire on the level are run only
+// on one call in DETECTOR_SAMPLING. A board that passed such a partial check is not
+// known to be free of deadlocks, so its verdict is not cached.
+
+#define DETECT_MATCHING   0
+#define DETECT_FREE_PULL  1
+#define DETECT_PULL_ZONES 2
+#define DETECT_STUCK      3
+#define DETECT_CORRAL     4
+#define DETECT_DIAG       5
+#define DETECT_K_DIST     6
+#define DETECT_WOBBLERS   7
+#define DETECTORS_NUM     8
+
+#define DEFAULT_DETECTORS_ORDER 0xFAC688 // 0,1,...,7 in 3 bits each
+#define REORDER_INTERVAL 1024
+#define DETECTOR_SAMPLING 16
+
+const char *detector_names[DETECTORS_NUM] =
+	{ "matching", "free pull", "pull zones", "stuck", "corral", "diagonal", "k-dist", "wobblers" };
+
+typedef struct deadlock_stats_data
 {
-	if (check_matching_deadlock(b, pull_mode, search_mode))
-		return 1;
+	UINT_64 calls[DETECTORS_NUM];
+	UINT_64 hits[DETECTORS_NUM];
+	UINT_64 time_us[DETECTORS_NUM]; // includes deadlock checks in nested searches
+	UINT_64 skipped[DETECTORS_NUM];
+	int total_calls;
+	int order; // detector indices, 3 bits each, first detector in the low bits
+	int idle;  // bitmap of detectors that are sampled
+} deadlock_stats_data;
+
+void allocate_deadlock_stats_data(level_context *l)
+{
+	l->deadlock_stats = (deadlock_stats_data*)calloc(1, sizeof(deadlock_stats_data));
+	if (l->deadlock_stats == 0) exit_with_error("can't allocate deadlock stats\n");
+}
 
-	if (pull_mode)
+void clear_deadlock_stats()
+{
+	deadlock_stats_data *s = current_level->deadlock_stats;
+
+	memset(s, 0, sizeof(deadlock_stats_data));
+	s->order = DEFAULT_DETECTORS_ORDER;
+}
+
+int detector_is_better(deadlock_stats_data *s, int a, int b)
+{
+	// more hits per microsecond. Detectors that were not measured yet come first.
+	return (s->hits[a] + 1) * (s->time_us[b] + 1) > (s->hits[b] + 1) * (s->time_us[a] + 1);
+}
+
+void update_detectors_order()
+{
+	deadlock_stats_data *s = current_level->deadlock_stats;
+	int list[DETECTORS_NUM];
+	int i, j, tmp;
+	int order = 0, idle = 0;
+
+	for (i = 0; i < DETECTORS_NUM; i++)
+		list[i] = i;
+
+	for (i = 1; i < DETECTORS_NUM; i++)
+		for (j = i; (j > 0) && detector_is_better(s, list[j], list[j - 1]); j--)
+		{
+			tmp = list[j];
+			list[j] = list[j - 1];
+			list[j - 1] = tmp;
+		}
+
+	for (i = 0; i < DETECTORS_NUM; i++)
 	{
-		if (free_pull_deadlock(b))
-			return 1;
+		order |= list[i] << (3 * i);
+
+		// fires on less than 0.1% of the calls, and is not cheap enough to keep running
+		if ((s->calls[i] >= 1000) && (s->hits[i] * 1000 < s->calls[i]) && (s->time_us[i] >= 2 * s->calls[i]))
+			idle |= 1 << i;
 	}
 
-	if (pull_mode == 0)
-		if (try_pulling_all_zones(b) == 0)
-			return 1;
+	s->order = order;
+	s->idle = idle;
+}
 
-	if (is_stuck_deadlock(b, pull_mode))
-		return 1;
+void print_deadlock_stats()
+{
+	deadlock_stats_data *s = current_level->deadlock_stats;
+	int i;
 
-	if (get_connectivity(b) != 1)
-		if (corral_deadlock(b, pull_mode))
-			return 1;
+	printf("deadlock detectors:\n");
+
+	for (i = 0; i < DETECTORS_NUM; i++)
+	{
+		if ((s->calls[i] == 0) && (s->skipped[i] == 0)) continue;
+
+		printf("%-10s: %10llu calls %9llu hits (%5.2f%%) %9.1f ms %8.2f us/call %10llu skipped\n",
+			detector_names[i], s->calls[i], s->hits[i],
+			(s->calls[i] ? s->hits[i] * 100.0 / s->calls[i] : 0.0),
+			s->time_us[i] / 1000.0,
+			(s->calls[i] ? (double)s->time_us[i] / s->calls[i] : 0.0),
+			s->skipped[i]);
+	}
 
+	if (adaptive_deadlocks)
+	{
+		printf("detectors order:");
+		for (i = 0; i < DETECTORS_NUM; i++)
+			printf(" %s", detector_names[(s->order >> (3 * i)) & 7]);
+		printf("\n");
+	}
+}
 
-	if (pull_mode == 0)
+int run_deadlock_detector(int detector, board b, int pull_mode, int search_mode)
+{
+	// returns 1 if the board is deadlocked, 0 if not, -1 if the detector does not apply
+	switch (detector)
 	{
-		if (is_diag_deadlock(b))
-			return 1;
+	case DETECT_MATCHING:
+		return (check_matching_deadlock(b, pull_mode, search_mode) != 0);
 
-		if (is_k_dist_deadlock(b))
-			return 1;
+	case DETECT_FREE_PULL:
+		if (pull_mode == 0) return -1;
+		return (free_pull_deadlock(b) != 0);
+
+	case DETECT_PULL_ZONES:
+		if (pull_mode) return -1;
+		return (try_pulling_all_zones(b) == 0);
+
+	case DETECT_STUCK:
+		return (is_stuck_deadlock(b, pull_mode) != 0);
+
+	case DETECT_CORRAL:
+		if (get_connectivity(b) == 1) return -1;
+		return (corral_deadlock(b, pull_mode) != 0);
+
+	case DETECT_DIAG:
+		if (pull_mode) return -1;
+		return (is_diag_deadlock(b) != 0);
+
+	case DETECT_K_DIST:
+		if (pull_mode) return -1;
+		return (is_k_dist_deadlock(b) != 0);
+
+	case DETECT_WOBBLERS:
+		return (is_wobblers_deadlock(b, pull_mode) != 0);
 	}
 
-	if (is_wobblers_deadlock(b, pull_mode))
-		return 1;
+	exit_with_error("unknown detector");
+	return 0;
+}
+
+int board_is_deadlocked(board b, int pull_mode, int search_mode, int *partial)
+{
+	// partial is set when a detector was skipped, so a 0 is not a final verdict
+	deadlock_stats_data *s = current_level->deadlock_stats;
+	int i, detector, res;
+	int call, order;
+	UINT_64 start;
+
+	*partial = 0;
+
+	if ((verbose < 4) && (adaptive_deadlocks == 0))
+	{
+		for (detector = 0; detector < DETECTORS_NUM; detector++)
+			if (run_deadlock_detector(detector, b, pull_mode, search_mode) == 1)
+				return 1;
+		return 0;
+	}
+
+	call = ATOMIC_ADD(&s->total_calls, 1);
+
+	order = DEFAULT_DETECTORS_ORDER;
+
+	if (adaptive_deadlocks)
+	{
+		if ((call % REORDER_INTERVAL) == REORDER_INTERVAL - 1)
+			update_detectors_order();
+		order = s->order;
+	}
+
+	for (i = 0; i < DETECTORS_NUM; i++)
+	{
+		detector = (order >> (3 * i)) & 7;
+
+		if (adaptive_deadlocks)
+			if ((s->idle >> detector) & 1)
+				if (call % DETECTOR_SAMPLING)
+				{
+					ATOMIC_ADD_64(&s->skipped[detector], 1);
+					*partial = 1;
+					continue;
+				}
+
+		start = get_time_in_us();
+		res = run_deadlock_detector(detector, b, pull_mode, search_mode);
+
+		if (res == -1) continue;
+
+		ATOMIC_ADD_64(&s->time_us[detector], get_time_in_us() - start);
+		ATOMIC_ADD_64(&s->calls[detector], 1);
+
+		if (res)
+		{
+			ATOMIC_ADD_64(&s->hits[detector], 1);
+			return 1;
+		}
+	}
 
 	return 0;
 }
@@ -492,20 +668,43 @@ int board_is_deadlocked(board b, int pull_mode, int search_mode)
 
 int move_is_deadlocked(board b_in, move *m, int pull_mode, int search_mode)
 {
+	// The verdict of the detectors is cached by the hash of the child position, so a position
+	// that is reached from another father, or by another core, is not checked again.
+	// A deadlock is final. A position that is not deadlocked may be found deadlocked when more
+	// stuck patterns or k-dist entries are learned, so that verdict is also keyed by their count.
+	// The rooms check depends on the move, and is not part of the cached verdict.
 	board b;
-	int res;
+	int res, partial;
+	UINT_64 hash, free_hash;
+	char alg = (char)(MOVE_VERDICT + search_mode);
+	char free_alg = (char)(FREE_MOVE_VERDICT + search_mode);
 
 	if ((m->kill) || (m->base)) return 0;
 
 	copy_board(b_in, b);
 	apply_move(b, m, NORMAL);
 
-	res = board_is_deadlocked(b, pull_mode, search_mode);
+	hash = get_board_hash(b);
+	free_hash = hash ^ ((UINT_64)(ATOMIC_LOAD_ACQUIRE(&current_level->learned_deadlocks) + 1) * 0x9E3779B97F4A7C15ULL);
 
-	if (res) return 1;
+	res = get_from_deadlock_cache(free_hash, pull_mode, free_alg);
 
-	if (is_rooms_deadlock(b, pull_mode, m))
-		return 1;
+	if (res != 0)
+		res = get_from_deadlock_cache(hash, pull_mode, alg);
 
-	return 0;
-}
\ No newline at end of file
+	if (res == -1)
+	{
+		res = board_is_deadlocked(b, pull_mode, search_mode, &partial);
+
+		if (res == 1)
+			insert_to_deadlock_cache(hash, 1, pull_mode, alg);
+		else if (partial == 0)
+			insert_to_deadlock_cache(free_hash, 0, pull_mode, free_alg);
+	}
+
+	if (res == 0)
+		if (is_rooms_deadlock(b, pull_mode, m))
+			res = 1;
+
+	return res;
+}
@@ -5,6 +5,10 @@
 #include "moves.h"
 #include "score.h"
 
+void allocate_deadlock_stats_data(level_context *l);
+void clear_deadlock_stats();
+void print_deadlock_stats();
+
 int move_is_deadlocked(board b, move *m, int pull_mode, int search_mode);
 
 int verify_simple_base_matching(board b, board board_with_bases);
@@ -83,7 +83,7 @@ void set_default_advisor(score_element *base_score, int moves_num, move *moves,
 		if (pull_mode) // don't pull from holes
 		{
 			index_to_y_x(moves[i].from, &y, &x);
-			if (target_holes[y][x]) continue;
+			if (current_level->target_holes[y][x]) continue;
 		}
 
 		if (already_expanded[i]) continue;
@@ -9,8 +9,8 @@
 void init_dist(int_board dist)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 		dist[i][j] = 1000000;
 }
 
@@ -88,10 +88,10 @@ int get_connectivity(board b)
 
 	init_dist(dist);
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 	{
-		if (inner[i][j] == 0) continue;
+		if (current_level->inner[i][j] == 0) continue;
 		if (dist[i][j] != 1000000) continue;
 		if (b[i][j] & OCCUPIED) continue;
 
@@ -106,10 +106,10 @@ void print_connectivity_comps(int_board dist)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
 
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (dist[i][j] == 1000000)
 				printf(" ");
@@ -129,18 +129,18 @@ int mark_connectivities(board b, int_board dist)
 
 	init_dist(dist);
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 	{
-		if (inner[i][j] == 0) continue;
+		if (current_level->inner[i][j] == 0) continue;
 		if (dist[i][j] != 1000000) continue;
 		if (b[i][j] & OCCUPIED) continue;
 
 		init_dist(local_dist);
 		bfs_from_place(b, local_dist, i, j, 0);
 
-		for (y = 0; y < height; y++)
-		for (x = 0;  x < width; x++)
+		for (y = 0; y < current_level->height; y++)
+		for (x = 0;  x < current_level->width; x++)
 		if (local_dist[y][x] < 1000000)
 			dist[y][x] = c;
 
@@ -162,15 +162,15 @@ void mark_connectivities_around_place(board b, int_board dist,
 		i = start_y + delta_y[c];
 		j = start_x + delta_x[c];
 
-		if (inner[i][j] == 0) continue;
+		if (current_level->inner[i][j] == 0) continue;
 		if (dist[i][j] != 1000000) continue;
 		if (b[i][j] & OCCUPIED) continue;
 
 		init_dist(local_dist);
 		bfs_from_place(b, local_dist, i, j, 0);
 
-		for (y = 0; y < height; y++)
-			for (x = 0; x < width; x++)
+		for (y = 0; y < current_level->height; y++)
+			for (x = 0; x < current_level->width; x++)
 				if (local_dist[y][x] < 1000000)
 					dist[y][x] = c;
 	}
@@ -183,8 +183,8 @@ void get_connectivity_sizes(int_board dist, int n, int *sizes)
 	for (i = 0; i < n; i++)
 		sizes[i] = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (dist[i][j] != 1000000)
 				sizes[dist[i][j]]++;
 }
@@ -203,11 +203,11 @@ void get_srcs_of_all_targets(board b_in, board srcs)
 	zero_board(srcs);
 	clear_boxes(b_in, b);
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if ((b[i][j] & TARGET) == 0) continue;
 			queue[queue_len++] = y_x_to_index(i, j);
 			srcs[i][j] = 1;
@@ -242,8 +242,8 @@ void expand_group(board b, board group, int_board dist)
 	int i, j, y, x, next_y, next_x;
 
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			dist[i][j] = 1000000;
 
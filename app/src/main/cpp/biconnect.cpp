@@ -62,8 +62,8 @@ void show_cycles(board b_in, board on_cycle)
 
 	clear_sokoban_inplace(b);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (on_cycle[i][j])
 				b[i][j] |= SOKOBAN;
 
@@ -80,18 +80,18 @@ int biconnect_score(board b_in, int report)
 
 	copy_board(b_in, b);
 
-	for (i = 0 ; i < height ; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0 ; i < current_level->height ; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			visited[i][j] = 0;
 			on_cycle[i][j] = 0;
 			low[i][j] = 1000000;
 		}
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if (visited[i][j]) continue;
 			if (b[i][j] & OCCUPIED) continue;
 
@@ -100,8 +100,8 @@ int biconnect_score(board b_in, int report)
 
 	// allow pulling boxes from target areas even if it creates tunnels
 	// (which increase biconnectivity)
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if ((b[i][j] & TARGET) && (b[i][j] & BOX) == 0)
 				on_cycle[i][j] = 1; 
 
@@ -109,6 +109,6 @@ int biconnect_score(board b_in, int report)
 	if (report)
 		show_cycles(b_in, on_cycle);
 
-	return index_num - global_boxes_in_level - board_popcnt(on_cycle);
+	return current_level->index_num - current_level->boxes_in_level - board_popcnt(on_cycle);
 }
 
@@ -10,30 +10,21 @@
 #include "distance.h"
 #include "util.h"
 
-board initial_board;
-board inner;
-
-int_board y_x_to_index_table;
-int index_to_x[MAX_INNER];
-int index_to_y[MAX_INNER];
-
-int index_num;
-
 void copy_board(board from, board to)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 		to[i][j] = from[i][j];
 }
 
 void save_initial_board(board b)
 {
-	copy_board(b, initial_board);
+	copy_board(b, current_level->initial_board);
 
-	get_sokoban_position(b, &global_initial_sokoban_y, &global_initial_sokoban_x);
-	global_boxes_in_level = boxes_in_level(b);
+	get_sokoban_position(b, &current_level->initial_sokoban_y, &current_level->initial_sokoban_x);
+	current_level->boxes_in_level = boxes_in_level(b);
 }
 
 
@@ -41,8 +32,8 @@ void get_sokoban_position(board b, int *y, int *x)
 {
 	int i,j;
 
-	for (i = 0; i < height ; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height ; i++)
+	for (j = 0; j < current_level->width; j++)
 	{
 		if (b[i][j] & SOKOBAN)
 		{
@@ -65,12 +56,12 @@ void init_inner(board b)
 
 	// set inner
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 	{
-		inner[i][j] = 0;
+		current_level->inner[i][j] = 0;
 		if (c[i][j] & SOKOBAN)
-			inner[i][j] = 1;
+			current_level->inner[i][j] = 1;
 	}
 }
 
@@ -79,12 +70,12 @@ void init_inner(board b)
 
 int y_x_to_index(int y, int x)
 {
-	int val = y_x_to_index_table[y][x];
+	int val = current_level->y_x_to_index_table[y][x];
 
 	if (val < 0)
 		exit_with_error("y_x_to_index");
 
-	if (val >= index_num)
+	if (val >= current_level->index_num)
 	{
 		exit_with_error("val out of range");
 	}
@@ -94,36 +85,36 @@ int y_x_to_index(int y, int x)
 
 void index_to_y_x(int index, int *y, int *x)
 {
-	if ((index < 0) || (index >= index_num))
+	if ((index < 0) || (index >= current_level->index_num))
 	{
-		printf("index: %d index_num: %d\n", index, index_num);
+		printf("index: %d index_num: %d\n", index, current_level->index_num);
 		exit_with_error("index_error");
 	}
 
-	*x = index_to_x[index];
-	*y = index_to_y[index];
+	*x = current_level->index_to_x[index];
+	*y = current_level->index_to_y[index];
 }
 
 void init_index_x_y()
 {
 	int i, j;
-	index_num = 0;
+	current_level->index_num = 0;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			y_x_to_index_table[i][j] = -1;
+			current_level->y_x_to_index_table[i][j] = -1;
 
-			if (inner[i][j] == 0)
+			if (current_level->inner[i][j] == 0)
 				continue;
 
-			y_x_to_index_table[i][j] = index_num;
-			index_to_x[index_num] = j;
-			index_to_y[index_num] = i;
-			index_num++;
+			current_level->y_x_to_index_table[i][j] = current_level->index_num;
+			current_level->index_to_x[current_level->index_num] = j;
+			current_level->index_to_y[current_level->index_num] = i;
+			current_level->index_num++;
 
-			if (index_num >= MAX_INNER)
+			if (current_level->index_num >= MAX_INNER)
 				exit_with_error("inner too big");
 
 		}
@@ -136,8 +127,8 @@ void clear_boxes(board b, board board_without_boxes)
 
 	copy_board(b, board_without_boxes);
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 		board_without_boxes[i][j] &= ~BOX;
 }
 
@@ -145,8 +136,8 @@ void clear_boxes_inplace(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b[i][j] &= ~BOX;
 }
 
@@ -154,8 +145,8 @@ void clear_sokoban_inplace(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 		b[i][j] &= ~SOKOBAN;
 }
 
@@ -163,8 +154,8 @@ int board_contains_boxes(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 	if (b[i][j] & BOX)
 		return 1;
 	return 0;
@@ -175,9 +166,9 @@ void turn_boxes_into_walls(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & BOX)
 				b[i][j] = WALL;
@@ -196,8 +187,8 @@ void expand_sokoban_cloud(board b)
 	int queue_pos = 0;
 
 	// init queue from existing sokoban positions
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & SOKOBAN)
 			{
 				queue_y[queue_len] = i;
@@ -228,6 +219,53 @@ void expand_sokoban_cloud(board b)
 }
 
 
+UINT_64 expand_sokoban_cloud_from(board b, int start_y, int start_x)
+{
+	// expands a cloud that has a single sokoban square, and returns the hash of the cloud
+	// (the cloud key of its first square, see get_sokoban_hash)
+
+	int queue_y[MAX_SIZE*MAX_SIZE];
+	int queue_x[MAX_SIZE*MAX_SIZE];
+
+	int i, y, x, next_y, next_x;
+	int queue_len = 1;
+	int queue_pos = 0;
+	int first_y = start_y, first_x = start_x;
+
+	b[start_y][start_x] |= SOKOBAN;
+	queue_y[0] = start_y;
+	queue_x[0] = start_x;
+
+	while (queue_pos < queue_len)
+	{
+		y = queue_y[queue_pos];
+		x = queue_x[queue_pos];
+
+		for (i = 0; i < 4; i++)
+		{
+			next_y = y + delta_y[i];
+			next_x = x + delta_x[i];
+
+			if (b[next_y][next_x] & SOKOBAN) continue;
+			if (b[next_y][next_x] & OCCUPIED) continue;
+
+			b[next_y][next_x] |= SOKOBAN;
+			queue_y[queue_len] = next_y;
+			queue_x[queue_len] = next_x;
+			queue_len++;
+
+			if ((next_y < first_y) || ((next_y == first_y) && (next_x < first_x)))
+			{
+				first_y = next_y;
+				first_x = next_x;
+			}
+		}
+		queue_pos++;
+	}
+	return get_cloud_key(first_y, first_x);
+}
+
+
 void expand_sokoban_cloud_for_graph(board b)
 {
 	int queue_y[MAX_SIZE*MAX_SIZE];
@@ -238,8 +276,8 @@ void expand_sokoban_cloud_for_graph(board b)
 	int queue_pos = 0;
 
 	// init queue from existing sokoban positions
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & SOKOBAN)
 			{
 				queue_y[queue_len] = i;
@@ -271,25 +309,178 @@ void expand_sokoban_cloud_for_graph(board b)
 
 
 
+// The board hash is the XOR of a random key per (square, bit) for every bit set on the board.
+// A move changes a few bits, so the hash of a child board is derived from its parent's hash
+// (see apply_move_and_hash) instead of rescanning the board.
+//
+// The sokoban cloud is the exception. An expanded cloud is determined by any of its squares,
+// so it is hashed by a single cloud key at its first square (in row major order). A move then
+// replaces the whole cloud of its parent with one XOR.
+
+#define HASH_BITS 6 // WALL .. DEADLOCK_ZONE
+#define CLOUD_KEY HASH_BITS
+
+UINT_64 board_hash_keys[MAX_SIZE][MAX_SIZE][HASH_BITS + 1];
+
+void init_board_hash_keys()
+{
+	// splitmix64 with a fixed seed, so hashes are the same from run to run
+	UINT_64 seed = 0x5ABC0BA5E5ABC0BAULL;
+	UINT_64 z;
+	int i, j, k;
+
+	for (i = 0; i < MAX_SIZE; i++)
+	for (j = 0; j < MAX_SIZE; j++)
+	for (k = 0; k <= HASH_BITS; k++)
+	{
+		seed += 0x9E3779B97F4A7C15ULL;
+		z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		board_hash_keys[i][j][k] = z ^ (z >> 31);
+	}
+}
+
+UINT_64 get_square_hash(int y, int x, int bits)
+{
+	UINT_64 hash = 0;
+	int k;
+
+	for (k = 0; bits; k++, bits >>= 1)
+		if (bits & 1)
+			hash ^= board_hash_keys[y][x][k];
+
+	return hash;
+}
+
+UINT_64 get_cloud_key(int y, int x)
+{
+	return board_hash_keys[y][x][CLOUD_KEY];
+}
+
+UINT_64 get_sokoban_hash(board b)
+{
+	// The part of the board hash that comes from the SOKOBAN bits: the cloud key of the first
+	// square of each cloud. Some boards mark sokoban squares that are not an expanded cloud
+	// (a free neighbour is not marked). Their squares are hashed one by one.
+
+	int queue_y[MAX_SIZE*MAX_SIZE];
+	int queue_x[MAX_SIZE*MAX_SIZE];
+	board seen;
+
+	int i, j, k, y, x, next_y, next_x;
+	int queue_len, queue_pos;
+	int expanded = 1;
+	UINT_64 squares_hash = 0;
+	UINT_64 hash = 0;
+
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
+	{
+		if ((b[i][j] & SOKOBAN) == 0) continue;
+
+		squares_hash ^= get_square_hash(i, j, SOKOBAN);
+
+		for (k = 0; k < 4; k++)
+			if ((b[i + delta_y[k]][j + delta_x[k]] & (SOKOBAN | OCCUPIED)) == 0)
+				expanded = 0;
+	}
+
+	if (expanded == 0)
+		return squares_hash;
+
+	zero_board(seen);
+
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
+	{
+		if ((b[i][j] & SOKOBAN) == 0) continue;
+		if (seen[i][j]) continue;
+
+		hash ^= get_cloud_key(i, j);
+
+		seen[i][j] = 1;
+		queue_y[0] = i;
+		queue_x[0] = j;
+		queue_len = 1;
+		queue_pos = 0;
+
+		while (queue_pos < queue_len)
+		{
+			y = queue_y[queue_pos];
+			x = queue_x[queue_pos];
+
+			for (k = 0; k < 4; k++)
+			{
+				next_y = y + delta_y[k];
+				next_x = x + delta_x[k];
+
+				if ((b[next_y][next_x] & SOKOBAN) == 0) continue;
+				if (seen[next_y][next_x]) continue;
+
+				seen[next_y][next_x] = 1;
+				queue_y[queue_len] = next_y;
+				queue_x[queue_len] = next_x;
+				queue_len++;
+			}
+			queue_pos++;
+		}
+	}
+
+	return hash;
+}
+
 UINT_64 get_board_hash(board b)
 {
-	UINT_64 hash = 1;
+	UINT_64 hash = 0;
+	int i, j, bits;
+	int has_sokoban = 0;
+
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
+	{
+		bits = b[i][j] & ~SOKOBAN;
+		if (bits)
+			hash ^= get_square_hash(i, j, bits);
+		if (b[i][j] & SOKOBAN)
+			has_sokoban = 1;
+	}
+
+	if (has_sokoban)
+		hash ^= get_sokoban_hash(b);
+
+	return hash;
+}
+
+UINT_64 get_bases_hash(board b)
+{
+	UINT_64 hash = 0;
 	int i, j;
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
-		hash = hash * 12345 + b[i][j] + (hash >> 32);
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
+		if (b[i][j] & BASE)
+			hash ^= get_square_hash(i, j, BASE);
 
 	return hash;
 }
 
+UINT_64 clear_sokoban_and_hash(board b)
+{
+	// clears the sokoban cloud and returns the hash of the cleared bits
+	UINT_64 hash = get_sokoban_hash(b);
+
+	clear_sokoban_inplace(b);
+	return hash;
+}
+
 void board_to_bytes(board b, UINT_8 *data)
 {
 	int i, j;
 	int pos = 0;
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 		data[pos++] = b[i][j];
 }
 
@@ -299,8 +490,8 @@ void bytes_to_board(UINT_8 *data, board b)
 	int i, j;
 	int pos = 0;
 
-	for (i = 0; i < height; i++)
-	for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
 		b[i][j] = data[pos++];
 }
 
@@ -308,8 +499,8 @@ int all_boxes_in_place(board b, int pull_mode)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -319,7 +510,7 @@ int all_boxes_in_place(board b, int pull_mode)
 			}
 			else
 			{
-				if ((initial_board[i][j] & BOX) == 0) return 0;
+				if ((current_level->initial_board[i][j] & BOX) == 0) return 0;
 				// don't use BASES because they don't exist in paper mode
 			}
 		}
@@ -330,7 +521,7 @@ int board_is_solved(board b, int pull_mode)
 {
 	if (pull_mode)
 	{
-		if ((b[global_initial_sokoban_y][global_initial_sokoban_x] & SOKOBAN) == 0)
+		if ((b[current_level->initial_sokoban_y][current_level->initial_sokoban_x] & SOKOBAN) == 0)
 			return 0;
 	}
 
@@ -343,9 +534,9 @@ void enter_reverse_mode(board b, int mark_bases)
 
 	clear_sokoban_inplace(b);
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] == BOX)
 				b[i][j] = 0;
@@ -354,7 +545,7 @@ void enter_reverse_mode(board b, int mark_bases)
 				b[i][j] = BOX | TARGET;
 
 			if (mark_bases)
-				if (initial_board[i][j] & BOX)
+				if (current_level->initial_board[i][j] & BOX)
 					b[i][j] |= BASE;
 		}
 	}
@@ -364,8 +555,8 @@ void rev_board(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b[i][j] ^= 1;
 }
 
@@ -380,8 +571,8 @@ int boxes_on_targets(board b)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if ((b[i][j] & ~BASE) == (BOX | TARGET))
 				sum++;
 
@@ -393,12 +584,12 @@ int boxes_on_bases(board b)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
-			if (initial_board[i][j] & BOX)
+			if (current_level->initial_board[i][j] & BOX)
 				sum++;
 		}
 
@@ -411,8 +602,8 @@ int boxes_in_level(board b)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				sum++;
 	return sum;
@@ -422,8 +613,8 @@ int is_same_board(board a, board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (a[i][j] != b[i][j])
 				return 0;
 	return 1;
@@ -433,8 +624,8 @@ int is_same_board(board a, board b)
 void zero_board(board b)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b[i][j] = 0;
 }
 
@@ -442,8 +633,8 @@ void turn_targets_into_walls(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & TARGET)
 				b[i][j] = WALL;
 }
@@ -454,11 +645,11 @@ void show_on_initial_board(board data)
 	board b;
 	int i, j;
 
-	clear_boxes(initial_board, b);
+	clear_boxes(current_level->initial_board, b);
 	clear_sokoban_inplace(b);
 	
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (data[i][j])
 			{
 				if ((b[i][j] != 0) && (b[i][j] != TARGET))
@@ -477,8 +668,8 @@ int board_popcnt(board x)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			sum += x[i][j];
 	return sum;
 }
@@ -486,7 +677,7 @@ int board_popcnt(board x)
 void mark_indices_with_boxes(board b, int *indices)
 {
 	int i,y,x;
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 		indices[i] = (b[y][x] & BOX ? 1 : 0);
@@ -507,8 +698,8 @@ void negate_board(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] > 1)
 				exit_with_error("bad neg value");
@@ -519,8 +710,8 @@ void negate_board(board b)
 void clear_targets_inplace(board b)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b[i][j] &= ~TARGET;
 }
 
@@ -529,9 +720,9 @@ void print_board_with_zones(board b, int zones[MAX_SIZE][MAX_SIZE])
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & WALL)
 			{
@@ -539,7 +730,7 @@ void print_board_with_zones(board b, int zones[MAX_SIZE][MAX_SIZE])
 			}
 			else
 			{
-				if (inner[i][j] == 0)
+				if (current_level->inner[i][j] == 0)
 					printf(" ");
 				else
 				{
@@ -558,8 +749,8 @@ void print_board_with_zones(board b, int zones[MAX_SIZE][MAX_SIZE])
 void turn_targets_into_packed(board b)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & TARGET)
 				b[i][j] = PACKED_BOX;
 }
@@ -569,10 +760,10 @@ void keep_boxes_in_inner(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0)
+			if (current_level->inner[i][j] == 0)
 				if (b[i][j] & BOX)
 					b[i][j] = WALL;
 		}
@@ -583,8 +774,8 @@ void keep_boxes_in_inner(board b)
 void zero_int_board(int_board a)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			a[i][j] = 0;
 }
 
@@ -592,8 +783,8 @@ void clear_bases_inplace(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b[i][j] &= ~BASE;
 }
 
@@ -601,8 +792,8 @@ void get_box_lacations_as_board(board b, board boxes)
 {
 	int i, j;
 	zero_board(boxes);
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				boxes[i][j] = 1;
 
@@ -612,8 +803,8 @@ void and_board(board a, board mask)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			a[i][j] &= mask[i][j];
 }
 
@@ -621,8 +812,8 @@ void and_board(board a, board mask)
 void copy_int_board(int_board from, int_board to)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			to[i][j] = from[i][j];
 }
 
@@ -631,8 +822,8 @@ int all_targets_filled(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if ((b[i][j] & ~SOKOBAN) == TARGET)
 				return 0;
 	return 1;
@@ -642,8 +833,8 @@ void go_to_final_position_with_given_walls(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] == WALL) continue;
 
@@ -659,7 +850,7 @@ int get_indices_of_boxes(board b, int *indices)
 	int i, y, x;
 	int n = 0;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 		if (b[y][x] & BOX)
@@ -673,7 +864,7 @@ int get_indices_of_targets(board b, int *indices)
 	int i, y, x;
 	int n = 0;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 		if (b[y][x] & TARGET)
@@ -687,10 +878,10 @@ int get_indices_of_initial_bases(board b, int *indices)
 	int i, y, x;
 	int n = 0;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
-		if (initial_board[y][x] & BOX)
+		if (current_level->initial_board[y][x] & BOX)
 			indices[n++] = i;
 	}
 	return n;
@@ -700,7 +891,7 @@ void put_sokoban_everywhere(board b)
 {
 	int i,y,x;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 		if ((b[y][x] & OCCUPIED) == 0)
@@ -712,8 +903,8 @@ void put_sokoban_in_zone(board b, int_board zones, int z)
 {
 	int i, j;
 	clear_sokoban_inplace(b);
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (zones[i][j] == z)
 				if ((b[i][j] & OCCUPIED) == 0)
 					b[i][j] |= SOKOBAN;
@@ -725,8 +916,8 @@ int size_of_sokoban_cloud(board b)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & SOKOBAN)
 				sum++;
 	return sum;
@@ -738,10 +929,10 @@ void get_untouched_areas(board b, board untouched)
 
 	zero_board(untouched);
 
-	for (i = 0 ; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0 ; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if (b[i][j] & OCCUPIED) continue;
 
 			if ((b[i][j] & SOKOBAN) == 0)
@@ -757,11 +948,11 @@ void print_with_bases(board b_in)
 
 	copy_board(b_in, b);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			b[i][j] &= ~TARGET;
-			if (initial_board[i][j] & BOX)
+			if (current_level->initial_board[i][j] & BOX)
 				b[i][j] |= BASE;
 		}
 	print_board(b);
@@ -771,11 +962,11 @@ void print_int_board(int_board b, int with_walls)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if ((with_walls) && (initial_board[i][j] == WALL))
+			if ((with_walls) && (current_level->initial_board[i][j] == WALL))
 			{
 				printf(" # ");
 				continue;
@@ -11,9 +11,6 @@ void copy_board(board from, board to);
 
 void init_inner(board b);
 
-extern int index_num;
-extern board inner;
-
 void init_index_x_y();
 int y_x_to_index(int y, int x);
 void index_to_y_x(int index, int *y, int *x);
@@ -24,6 +21,7 @@ void turn_boxes_into_walls(board b);
 
 void expand_sokoban_cloud(board b);
 void expand_sokoban_cloud_for_graph(board b);
+UINT_64 expand_sokoban_cloud_from(board b, int start_y, int start_x);
 
 void get_sokoban_position(board b, int *y, int *x);
 void clear_sokoban_inplace(board b);
@@ -33,7 +31,13 @@ int board_is_solved(board b, int pull_mode);
 
 
 
+void init_board_hash_keys();
+UINT_64 get_square_hash(int y, int x, int bits);
+UINT_64 get_cloud_key(int y, int x);
+UINT_64 get_sokoban_hash(board b);
 UINT_64 get_board_hash(board b);
+UINT_64 get_bases_hash(board b);
+UINT_64 clear_sokoban_and_hash(board b);
 void board_to_bytes(board b, UINT_8 *data);
 void bytes_to_board(UINT_8 *data, board b);
 void enter_reverse_mode(board b, int mark_bases);
@@ -42,8 +46,6 @@ void rev_board(board b);
 void print_board(board b);
 void save_initial_board(board b);
 
-extern board initial_board;
-
 
 int boxes_on_targets(board b);
 int boxes_on_bases(board b);
@@ -64,9 +64,9 @@ void get_corral_boxes(board orig_b, board corral_boxes, corral_data *cd)
 	clear_boxes(orig_b, corral_boxes);
 	clear_sokoban_inplace(corral_boxes);
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((cd->corral)[i][j] == 0) continue;
 
@@ -134,8 +134,8 @@ int is_corral_active(board b_in, corral_data *cd)
 	get_corral_boxes(b_in, corral_boxes, cd);
 	// gets the boxes around the corral, AND marks inner corral with sokoabn
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((cd->corral)[i][j])
 				if (corral_boxes[i][j] == TARGET)
@@ -163,8 +163,8 @@ void set_corral_options(board b_in, board corral_options, corral_data *cd)
 
 	clear_boxes(b_in, corral_options);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((corral_boxes[i][j] & BOX) == 0)
 				continue;
@@ -203,9 +203,9 @@ void get_corral_candidates(board b, corral_data *cd)
 	for (i = 0; i < cd->corral_comps_num; i++)
 		(cd->corral_candidates)[i] = 0;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -249,9 +249,9 @@ int init_corral_with_comp(int comp1, int comp2, board b_in, corral_data *cd)
 	(cd->corral_component_used)[comp1] = 1;
 	(cd->corral_component_used)[comp2] = 1;
 	
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (((cd->corral_d)[i][j] == comp1) || ((cd->corral_d)[i][j] == comp2))
 			{
@@ -269,8 +269,8 @@ void update_corral_with_comp(int comp1, corral_data *cd)
 
 	(cd->corral_component_used)[comp1] = 1;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if ((cd->corral_d)[i][j] == comp1)
 				(cd->corral)[i][j] = 1;
 
@@ -304,9 +304,9 @@ int should_add_component_to_corral(board corral_boxes, int *component, corral_da
 	int dest_x, dest_y;
 	int can_push_inside, can_push_aside;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((corral_boxes[i][j] & BOX) == 0)
 				continue;
@@ -366,14 +366,14 @@ int can_push_box_out_of_corral(board b, board corral)
 	int dest_x, dest_y;
 	int box_y, box_x, direction;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0)
 				continue;
 
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 
 			for (k = 0; k < 4; k++)
 			{
@@ -409,9 +409,9 @@ int check_pi_corral(board corral_boxes, board b_in, corral_data *cd)
 	int dest_x, dest_y;
 
 	// verify that all the boxes on the corral boundary can actually be pushed inside
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((corral_boxes[i][j] & BOX) == 0) continue;
 
@@ -501,8 +501,8 @@ void init_touches_two_comps(board b, corral_data *cd, char touches_two_comps[MAX
 		for (j = 0; j < MAX_CORRALS_NUM; j++)
 			touches_two_comps[i][j] = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
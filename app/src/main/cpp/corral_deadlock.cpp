@@ -44,8 +44,8 @@ int board_contains_more_deadlocks(board new_board, board old_board)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (new_board[i][j] & DEADLOCK_ZONE)
 				if ((old_board[i][j] & DEADLOCK_ZONE) == 0)
 					return 1;
@@ -119,8 +119,8 @@ void keep_two_components(board b, int_board d, int comp1, int comp2, int pull_mo
 
 	zero_board(group);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if ((d[i][j] == comp1) || (d[i][j] == comp2))
 				group[i][j] = 1;
 
@@ -148,29 +148,7 @@ int is_better_deadlock_score(score_element *new_score, score_element *old_score)
 
 int choose_deadlock_son(position *deadlock_positions, int deadlock_pos_num, int *son)
 {
-	int i, j;
-	int res = -1;
-	score_element best_score;
-
-	for (i = 0; i < deadlock_pos_num; i++)
-	{
-		if (deadlock_positions[i].position_deadlocked) continue;
-
-		for (j = 0; j < deadlock_positions[i].moves_num; j++)
-		{
-			if (deadlock_positions[i].move_deadlocked[j]) continue;
-			if (deadlock_positions[i].place_in_positions[j]) continue;
-
-			if ((res == -1) || (is_better_deadlock_score(deadlock_positions[i].scores + j, &best_score)))
-			{
-				res = i;
-				*son = j;
-				best_score = deadlock_positions[i].scores[j];
-			}
-		}
-	}
-
-	return res;
+	return best_frontier_move(deadlock_positions, deadlock_pos_num, son, is_better_deadlock_score);
 }
 
 
@@ -237,7 +215,7 @@ void mark_deadlocked_sons_using_cache(position *deadlock_positions, int deadlock
 	for (i = 0; i < p->moves_num; i++)
 		if (get_from_deadlock_cache(p->hashes[i], p->pull_mode, DEADLOCK_SEARCH) == IS_DEADLOCK)
 			if (p->place_in_positions[i] == 0) // a leaf, not a visited node
-				set_leaf_as_deadlock(deadlock_positions, deadlock_pos_num, node, i);
+				set_leaf_as_deadlock(deadlock_positions, node, i);
 }
 
 /*
@@ -320,7 +298,7 @@ int corral_deadlock_search_actual_2(board b, int pull_mode, int search_size)
 		}
 	}
 
-	free_positions(deadlock_positions, search_size);
+	free_positions(deadlock_positions);
 
 	return result;
 }
@@ -442,7 +420,7 @@ int corral_deadlock_search_actual(board b, int pull_mode, int search_size)
 
 	insert_positions_to_deadlock_cache(deadlock_positions, deadlock_pos_num, result);
 
-	free_positions(deadlock_positions, search_size);
+	free_positions(deadlock_positions);
 	
 	return result;
 }
@@ -468,9 +446,7 @@ int mini_corral(board b)
 		return SEARCH_EXCEEDED;
 	}
 
-	update_queries_counter(hash, 0, MINI_CORRAL);
-
-	if (get_queries_num(hash, 0, MINI_CORRAL) != 100)
+	if (update_queries_counter(hash, 0, MINI_CORRAL) != 100)
 		return SEARCH_EXCEEDED;
 
 	// so there have been 100 queries. time to actually check the pattern
@@ -534,15 +510,10 @@ int advanced_deadlock_search(board b, int pull_mode)
 
 	res = get_from_deadlock_cache(hash, pull_mode, DEADLOCK_SEARCH);
 
-	update_queries_counter(hash, pull_mode, DEADLOCK_SEARCH);
-	// we take the risk that two threads will simultaneously update the counter
-	// thereby risking "should_reevaluate". 
-	// Getting to reevaluation is rare, more so exactly in the same time.
+	queries = update_queries_counter(hash, pull_mode, DEADLOCK_SEARCH);
 
 	if (res == SEARCH_EXCEEDED)
 	{
-		queries = get_queries_num(hash, pull_mode, DEADLOCK_SEARCH);
-
 		if (should_reevaluate(queries))
 		{
 			if (verbose >= 5)
@@ -637,7 +608,7 @@ int advanced_deadlock_pull_mode(board b_in, int without_wobblers)
 
 	clear_boxes_out_of_deadlock_zone(c);
 
-	if (boxes_in_level(c) == global_boxes_in_level)
+	if (boxes_in_level(c) == current_level->boxes_in_level)
 		return NOT_DEADLOCK; // will be explored by the search tree
 
 	if (debug_corral_deadlock)
@@ -743,9 +714,9 @@ int corral_deadlock(board b_in, int pull_mode)
 
 	// check two componenents if they touch a box
 	
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0)
 				continue;
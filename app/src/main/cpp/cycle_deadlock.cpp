@@ -200,7 +200,7 @@ void cycles_explorer(tree* t, expansion_data* e)
 
 			for (i = 0; i < len; i++)
 			{
-				bytes_to_board(cycle[i]->b, b);
+				get_expansion_board(cycle[i], b);
 //				learn_pull_deadlock(b);
 			}
 
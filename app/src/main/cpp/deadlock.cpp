@@ -23,9 +23,6 @@
 
 int debug_deadlock = 0;
 
-board forbidden_push_tunnel;
-board forbidden_pull_tunnel;
-
 #define MAX_PATTERNS 400
 
 typedef struct deadlock_pattern
@@ -51,19 +48,19 @@ void set_forbidden_tunnel()
 	board b;
 	int base, target;
 
-	zero_board(forbidden_push_tunnel);
-	zero_board(forbidden_pull_tunnel);
+	zero_board(current_level->forbidden_push_tunnel);
+	zero_board(current_level->forbidden_pull_tunnel);
 
-	clear_boxes(initial_board, b);
+	clear_boxes(current_level->initial_board, b);
 	clear_sokoban_inplace(b);
 
 	// look for
 	// ######
 	//
 	// ######
-	for (i = 1; i < (height - 1); i++)
+	for (i = 1; i < (current_level->height - 1); i++)
 	{
-		for (j = 1; j < (width - 1); j++)
+		for (j = 1; j < (current_level->width - 1); j++)
 		{
 
 			if (b[i - 1][j - 1] == WALL)
@@ -71,7 +68,7 @@ void set_forbidden_tunnel()
 			if (b[i + 1][j - 1] == WALL) continue; // middle of tunnel
 
 
-			for (k = 0; k < width; k++)
+			for (k = 0; k < current_level->width; k++)
 			{
 				if (b[i - 1][j + k] != WALL) break;
 				if (b[  i  ][j + k] == WALL) break;
@@ -84,21 +81,21 @@ void set_forbidden_tunnel()
 				base = target = 0;
 				for (k = 0; k < n; k++)
 				{
-					if (initial_board[i][j + k] & BOX) base = 1;
+					if (current_level->initial_board[i][j + k] & BOX) base = 1;
 					if (b[i][j + k] & TARGET) target = 1;
 				}
 
 				for (k = 0; k < n; k++)
 				{
-					forbidden_push_tunnel[i][j + k] = 1;
-					forbidden_pull_tunnel[i][j + k] = 1;
+					current_level->forbidden_push_tunnel[i][j + k] = 1;
+					current_level->forbidden_pull_tunnel[i][j + k] = 1;
 				}
 
 				if (base == 0)
-					forbidden_pull_tunnel[i][j] = 0; 
+					current_level->forbidden_pull_tunnel[i][j] = 0; 
 				
 				if (target == 0)
-					forbidden_push_tunnel[i][j] = 0;			
+					current_level->forbidden_push_tunnel[i][j] = 0;			
 			}
 		}
 	}
@@ -107,16 +104,16 @@ void set_forbidden_tunnel()
 	// # #
 	// # #
 	// # #
-	for (i = 1; i < (height - 1); i++)
+	for (i = 1; i < (current_level->height - 1); i++)
 	{
-		for (j = 1; j < (width - 1); j++)
+		for (j = 1; j < (current_level->width - 1); j++)
 		{
 			if (b[i - 1][j - 1] == WALL)
 			if (b[i - 1][  j  ] != WALL)
 			if (b[i - 1][j + 1] == WALL) continue; // middle of tunnel
 
 
-			for (k = 0; k < height; k++)
+			for (k = 0; k < current_level->height; k++)
 			{
 				if (b[i + k][j - 1] != WALL) break;
 				if (b[i + k][  j  ] == WALL) break;
@@ -129,22 +126,22 @@ void set_forbidden_tunnel()
 				base = target = 0;
 				for (k = 0; k < n; k++)
 				{
-					if (initial_board[i + k][j] & BOX) base = 1;
+					if (current_level->initial_board[i + k][j] & BOX) base = 1;
 					if (b[i + k][j] & TARGET) target = 1;
 				}
 
 
 				for (k = 0; k < n; k++)
 				{
-					forbidden_push_tunnel[i + k][j] = 1;
-					forbidden_pull_tunnel[i + k][j] = 1;
+					current_level->forbidden_push_tunnel[i + k][j] = 1;
+					current_level->forbidden_pull_tunnel[i + k][j] = 1;
 				}
 
 				if (base == 0)
-					forbidden_pull_tunnel[i][j] = 0;
+					current_level->forbidden_pull_tunnel[i][j] = 0;
 
 				if (target == 0)
-					forbidden_push_tunnel[i][j] = 0;
+					current_level->forbidden_push_tunnel[i][j] = 0;
 					
 				
 			}
@@ -154,9 +151,9 @@ void set_forbidden_tunnel()
 	if (verbose >= 5)
 	{
 		printf("forbidden push tunnel:\n");
-		show_on_initial_board(forbidden_push_tunnel);
+		show_on_initial_board(current_level->forbidden_push_tunnel);
 		printf("forbidden pull tunnel:\n");
-		show_on_initial_board(forbidden_pull_tunnel);
+		show_on_initial_board(current_level->forbidden_pull_tunnel);
 	}
 }
 
@@ -193,8 +190,8 @@ void mark_deadlock_2x2(board c_inp, board d)
 
 	zero_board(d);
 
-	for (i = 0; i < (height - 1); i++)
-	for (j = 0; j < (width - 1); j++)
+	for (i = 0; i < (current_level->height - 1); i++)
+	for (j = 0; j < (current_level->width - 1); j++)
 	{
 
 		// look for patterns composed of 3 boxes/walls such as
@@ -279,8 +276,8 @@ int deadlock_in_direction(board b, int y, int x, int d)
 	new_y = y + dy;
 	new_x = x + dx;
 
-	if (inner[new_y][new_x] == 0) return 1; // safeguard before calling y_x_to_index
-	if (impossible_place[y_x_to_index(new_y, new_x)]) 
+	if (current_level->inner[new_y][new_x] == 0) return 1; // safeguard before calling y_x_to_index
+	if (current_level->impossible_place[y_x_to_index(new_y, new_x)]) 
 		return 1;
 
 	if ((b[y][x] & BOX) == 0) exit_with_error("missing box");
@@ -397,8 +394,8 @@ int is_freeze_deadlock(board b, int y, int x)
 	{
 		changed = 0;
 
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 				if (c[i][j] & BOX)
 					if (box_is_pushable(c, i, j))
 					{
@@ -407,8 +404,8 @@ int is_freeze_deadlock(board b, int y, int x)
 					}
 	}
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (c[i][j] & BOX)
 				if ((c[i][j] & TARGET) == 0)
 					return 1;
@@ -439,7 +436,7 @@ int is_3x3_deadlock(board b, int box_y, int box_x)
 	{
 		for (x = box_x - 1; x <= (box_x + 1); x++)
 		{
-			if (inner[y][x] == 0) continue;
+			if (current_level->inner[y][x] == 0) continue;
 			if (b[y][x] & OCCUPIED) continue;
 
 			if (b[y][x] & TARGET) continue;
@@ -830,7 +827,7 @@ int check_all_patterns(board b_in, int box_y, int box_x, int pull_mode)
 	}
 	else
 	{
-		if (b[global_initial_sokoban_y][global_initial_sokoban_x] & SOKOBAN)
+		if (b[current_level->initial_sokoban_y][current_level->initial_sokoban_x] & SOKOBAN)
 			return -1;
 		// in pull mode, it is ok to be confined in a corral containing the start position
 
@@ -886,13 +883,13 @@ int is_inefficient_position(board b, int box_index, int pull_mode, int search_mo
 	}
 	else
 	{
-		if (initial_board[box_y][box_x] & BOX)
+		if (current_level->initial_board[box_y][box_x] & BOX)
 			return 0;
 	}
 
 
-	if ((pull_mode == 0) && (forbidden_push_tunnel[box_y][box_x])) return 1;
-	if ((pull_mode     ) && (forbidden_pull_tunnel[box_y][box_x])) return 1;
+	if ((pull_mode == 0) && (current_level->forbidden_push_tunnel[box_y][box_x])) return 1;
+	if ((pull_mode     ) && (current_level->forbidden_pull_tunnel[box_y][box_x])) return 1;
 
 
 	for (i = 0; i < 8; i++)
@@ -1031,7 +1028,7 @@ int has_pull_continuation(board b, int search_mode)
 	all_boxes_solved = all_boxes_in_place(b, 1);
 
 	// it is ok to be stuck on initial position.
-	if (b[global_initial_sokoban_y][global_initial_sokoban_x] & SOKOBAN)
+	if (b[current_level->initial_sokoban_y][current_level->initial_sokoban_x] & SOKOBAN)
 		if (all_boxes_solved)
 			return 1;
 
@@ -1044,8 +1041,8 @@ int has_pull_continuation(board b, int search_mode)
 		return 0;
 	}
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -1106,15 +1103,15 @@ void check_deadlock_in_moves(board b_in, move *moves, int moves_num, int *valid,
 	if (pull_mode)
 		clear_bases_inplace(b);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 		elim[i] = 0;
 
 	if ((pull_mode) && (search_mode == BASE_SEARCH))
 	{
 		// in reverse mode, mark all eliminating places.
 		// if a box gets there, do not prune the move
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if (b_in[i][j] & BASE)
 					elim[y_x_to_index(i, j)] = 1;
@@ -1146,7 +1143,7 @@ void check_deadlock_in_moves(board b_in, move *moves, int moves_num, int *valid,
 			continue; // do not prune move into the elimination zone
 
 
-		if (impossible_place[dest])
+		if (current_level->impossible_place[dest])
 		{
 			valid[i] = 0;
 			if (debug_deadlock)
@@ -17,5 +17,3 @@ int check_all_patterns(board b_in, int box_y, int box_x, int pull_mode);
 int deadlock_in_direction(board b, int y, int x, int d);
 
 void set_forbidden_tunnel();
-extern board forbidden_push_tunnel;
-extern board forbidden_pull_tunnel;
\ No newline at end of file
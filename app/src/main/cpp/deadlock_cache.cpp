@@ -3,109 +3,250 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "deadlock_cache.h"
 #include "util.h"
 #include "global.h"
+#include "knowledge.h"
 
 #ifdef THREADS
 #include <pthread.h>
 #endif
 
-int log_deadlock_cache = 22;
+// The cache is split into shards, each a separate table with its own lock.
+// The shard is chosen by the high bits of the hash and the bucket by the low bits, so threads
+// that check different positions rarely wait for each other.
+// A bucket holds BUCKET_SIZE entries. When a bucket is full, an entry is evicted with the
+// second-chance rule: entries that were used since the last eviction in the bucket are kept.
 
-unsigned int deadlock_cache_mask;
-int total_deadlock_cache_entries;
+#define LOG_SHARDS 6
+#define SHARDS_NUM (1 << LOG_SHARDS)
+#define BUCKET_SIZE 4 // 64 bytes
 
-typedef struct cache_entry
+typedef struct cache_entry // 16 bytes
 {
 	UINT_64 hash;
-	int queries;
+	unsigned int queries;
 	char result;
 	char pull_mode;
 	char alg;
+	char referenced;
 } cache_entry;
 
-cache_entry *deadlock_cache;
+typedef struct cache_shard
+{
+	cache_entry *entries;
+	int total_entries;
+
+	UINT_64 hits;
+	UINT_64 misses;
+	UINT_64 inserts;
+	UINT_64 evictions;
+	UINT_64 verdict_hits;
+	UINT_64 verdict_misses;
+#ifdef THREADS
+	pthread_mutex_t mutex;
+#endif
+} cache_shard;
 
+typedef struct deadlock_cache_data
+{
+	cache_entry *entries;
+	int log_size;
+	int log_shard_size;
+	unsigned int mask; // of a shard
+	cache_shard shards[SHARDS_NUM];
+} deadlock_cache_data;
 
 
 
-void set_log_deadlock_cache()
+
+UINT_64 get_deadlock_cache_memory(int log_size)
+{
+	return (UINT_64)sizeof(cache_entry) << log_size;
+}
+
+int get_log_deadlock_cache()
 {
-	if (cores_num == 1) log_deadlock_cache = 22 + extra_mem;
-	if (cores_num == 2) log_deadlock_cache = 23 + extra_mem;
-	if (cores_num == 4) log_deadlock_cache = 24 + extra_mem;
-	if (cores_num == 8) log_deadlock_cache = 25 + extra_mem;
+	int log_size;
+
+	if (deadlock_cache_mb == 0)
+		log_size = 22 + get_cores_log() + extra_mem;
+	else
+	{
+		// the largest table that fits in the requested size
+		for (log_size = 10; log_size < MAX_TABLE_LOG_SIZE; log_size++)
+			if (((UINT_64)sizeof(cache_entry) << (log_size + 1)) > ((UINT_64)deadlock_cache_mb << 20))
+				break;
+	}
+
+	if (log_size > MAX_TABLE_LOG_SIZE)
+		log_size = MAX_TABLE_LOG_SIZE;
+
+	return log_size;
 }
 
 
-void allocate_deadlock_cache()
+void allocate_deadlock_cache(level_context *l)
 {
-	set_log_deadlock_cache();
+	deadlock_cache_data *c;
 	size_t size;
+	int i;
+
+	c = (deadlock_cache_data*)malloc(sizeof(deadlock_cache_data));
+	if (c == 0)
+		exit_with_error("can't allocate deadlock cache");
+
+	c->log_size = l->deadlock_cache_log_size;
+	if (c->log_size < LOG_SHARDS + 4)
+		c->log_size = LOG_SHARDS + 4;
 
-	size = (1LL << log_deadlock_cache) * sizeof(cache_entry);
-	deadlock_cache = (cache_entry*)malloc(size);
+	size = (1LL << c->log_size) * sizeof(cache_entry);
+	c->entries = (cache_entry*)malloc(size);
 
 	if (verbose >= 4)
-		printf("Allocating %12llu bytes for %d deadlock cache\n",
-			size, 1 << log_deadlock_cache);
+		printf("Allocating %12llu bytes for %llu deadlock cache\n",
+			(UINT_64)size, 1ULL << c->log_size);
 
-	if (deadlock_cache == 0)
+	if (c->entries == 0)
 		exit_with_error("can't allocate deadlock cache");
 
-	deadlock_cache_mask = (1 << log_deadlock_cache) - 1;
-	total_deadlock_cache_entries = 0;
+	c->log_shard_size = c->log_size - LOG_SHARDS;
+	c->mask = (unsigned int)((1ULL << c->log_shard_size) - 1);
+
+	for (i = 0; i < SHARDS_NUM; i++)
+	{
+		c->shards[i].entries = c->entries + ((size_t)i << c->log_shard_size);
+#ifdef THREADS
+		pthread_mutex_init(&c->shards[i].mutex, NULL);
+#endif
+	}
+
+	l->deadlock_cache = c;
 }
 
-void free_deadlock_cache()
+void free_deadlock_cache(level_context *l)
 {
-	free(deadlock_cache);
+#ifdef THREADS
+	int i;
+	for (i = 0; i < SHARDS_NUM; i++)
+		pthread_mutex_destroy(&l->deadlock_cache->shards[i].mutex);
+#endif
+	free(l->deadlock_cache->entries);
+	free(l->deadlock_cache);
 }
 
 void clear_deadlock_cache()
 {
 	int i;
-	for (i = 0; i < (1 << log_deadlock_cache); i++)
+	cache_shard *s;
+
+	// an entry with hash 0 is free, the other fields are set when it is claimed
+	memset(current_level->deadlock_cache->entries, 0,
+		sizeof(cache_entry) << current_level->deadlock_cache->log_size);
+
+	for (i = 0; i < SHARDS_NUM; i++)
+	{
+		s = current_level->deadlock_cache->shards + i;
+		s->total_entries = 0;
+		s->hits = s->misses = s->inserts = s->evictions = 0;
+		s->verdict_hits = s->verdict_misses = 0;
+	}
+}
+
+void print_deadlock_cache_stats()
+{
+	int i;
+	UINT_64 entries = 0, hits = 0, misses = 0, inserts = 0, evictions = 0;
+	UINT_64 verdict_hits = 0, verdict_misses = 0;
+	cache_shard *s;
+
+	for (i = 0; i < SHARDS_NUM; i++)
 	{
-		deadlock_cache[i].hash = 0;
-		deadlock_cache[i].result = -1;
-		deadlock_cache[i].queries = 0;
-		deadlock_cache[i].pull_mode = -1;
-		deadlock_cache[i].alg = -1;
+		s = current_level->deadlock_cache->shards + i;
+		entries += s->total_entries;
+		hits += s->hits;
+		misses += s->misses;
+		inserts += s->inserts;
+		evictions += s->evictions;
+		verdict_hits += s->verdict_hits;
+		verdict_misses += s->verdict_misses;
 	}
 
-	total_deadlock_cache_entries = 0;
+	printf("deadlock cache: %llu/%llu entries, %llu hits, %llu misses, %llu inserts, %llu evictions\n",
+		entries, 1ULL << current_level->deadlock_cache->log_size, hits, misses, inserts, evictions);
+	printf("move verdicts: %llu hits, %llu misses (%.2f%% hit rate)\n", verdict_hits, verdict_misses,
+		(verdict_hits + verdict_misses ? verdict_hits * 100.0 / (verdict_hits + verdict_misses) : 0.0));
+}
+
+
+cache_shard *lock_shard(UINT_64 hash)
+{
+	cache_shard *s = current_level->deadlock_cache->shards + (hash >> (64 - LOG_SHARDS));
+
+#ifdef THREADS
+	if (threads_share_level()) pthread_mutex_lock(&s->mutex);
+#endif
+	return s;
 }
 
+void unlock_shard(cache_shard *s)
+{
 #ifdef THREADS
-pthread_mutex_t deadlock_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+	if (threads_share_level()) pthread_mutex_unlock(&s->mutex);
+#else
+	(void)s;
 #endif
+}
 
 
-cache_entry* get_deadlock_cache_entry(UINT_64 hash, int pull_mode, char alg, int* match)
+cache_entry *get_bucket(cache_shard *s, UINT_64 hash)
 {
-	int index;
-	cache_entry* e;
+	return s->entries + ((hash & current_level->deadlock_cache->mask) & ~(BUCKET_SIZE - 1));
+}
 
-	*match = 0;
-	index = hash & deadlock_cache_mask;
+cache_entry* find_deadlock_cache_entry(cache_shard *s, UINT_64 hash, int pull_mode, char alg)
+{
+	// must be called with the shard locked. Returns NULL if the entry is not in the cache.
+	int i;
+	cache_entry* e = get_bucket(s, hash);
 
-	while (deadlock_cache[index].hash != 0)
+	for (i = 0; i < BUCKET_SIZE; i++, e++)
 	{
-		e = deadlock_cache + index;
-
 		if ((e->hash == hash) && (e->pull_mode == pull_mode) && (e->alg == alg))
 		{
-			*match = 1;
+			e->referenced = 1;
 			return e;
 		}
+	}
+	return NULL;
+}
 
-		index = (index + 1) & deadlock_cache_mask;
+cache_entry* claim_deadlock_cache_entry(cache_shard *s, UINT_64 hash)
+{
+	// returns a free entry in the bucket, or evicts one
+	int i;
+	cache_entry* bucket = get_bucket(s, hash);
+
+	for (i = 0; i < BUCKET_SIZE; i++)
+		if (bucket[i].hash == 0)
+		{
+			s->total_entries++;
+			return bucket + i;
+		}
+
+	s->evictions++;
+
+	for (i = 0; i < BUCKET_SIZE; i++)
+	{
+		if (bucket[i].referenced == 0)
+			return bucket + i;
+		bucket[i].referenced = 0;
 	}
 
-	return deadlock_cache + index;
+	// all were referenced, and now none is
+	return bucket + (hash >> 32) % BUCKET_SIZE;
 }
 
 
@@ -113,94 +254,166 @@ cache_entry* get_deadlock_cache_entry(UINT_64 hash, int pull_mode, char alg, int
 
 int get_from_deadlock_cache(UINT_64 hash, int pull_mode, char alg)
 {
-	int res;
-	int match;
+	int res = -1;
 	cache_entry* e;
+	cache_shard *s = lock_shard(hash);
 
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&deadlock_cache_mutex);
-#endif
-
-	e = get_deadlock_cache_entry(hash, pull_mode, alg, &match);
+	e = find_deadlock_cache_entry(s, hash, pull_mode, alg);
 
-	if (match)
+	if (e)
+	{
 		res = e->result;
+		s->hits++;
+		if (alg >= MOVE_VERDICT) s->verdict_hits++;
+	}
 	else
-		res = -1;
+	{
+		s->misses++;
+		// move_is_deadlocked looks for a free verdict first, a move is counted once
+		if ((alg >= MOVE_VERDICT) && (alg < FREE_MOVE_VERDICT)) s->verdict_misses++;
+	}
 
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&deadlock_cache_mutex);
-#endif
+	unlock_shard(s);
 
 	return res;
 }
 
-int deadlock_cache_is_full()
-{
-	int limit = 1 << (log_deadlock_cache - 1);
-	if (total_deadlock_cache_entries < limit) return 0;
-	if (verbose >= 4) exit_with_error("deadlock cache is full !!!\n");
-	return 1;
-}
-
 void insert_to_deadlock_cache(UINT_64 hash, int res, int pull_mode, char alg)
 {
-	int match;
 	cache_entry* e;
+	cache_shard *s = lock_shard(hash);
 
-	if (deadlock_cache_is_full()) return;
-
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&deadlock_cache_mutex);
-#endif
-
-	e = get_deadlock_cache_entry(hash, pull_mode, alg, &match);
+	e = find_deadlock_cache_entry(s, hash, pull_mode, alg);
 
-	if (match) // already in cache
+	if (e) // already in cache
 	{
 		if ((e->result ^ res) == 1)
-			exit_with_error("different cache value!");
+		{
+			// threads may reach different verdicts for a move, because some detectors depend
+			// on the bounded searches that were cached so far. Keep the deadlock.
+			if (alg < MOVE_VERDICT)
+				exit_with_error("different cache value!");
+			e->result = 1;
+		}
 
 		if (e->result == 2)
 			e->result = res;
 	}
 	else
 	{
+		e = claim_deadlock_cache_entry(s, hash);
+
 		e->hash = hash;
 		e->pull_mode = pull_mode;
 		e->alg = alg;
 		e->result = res;
 		e->queries = 0;
+		e->referenced = 0;
 
-		total_deadlock_cache_entries++;
+		s->inserts++;
 	}
 
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&deadlock_cache_mutex);
-#endif
+	unlock_shard(s);
 }
 
-int get_queries_num(UINT_64 hash, int pull_mode, char alg)
+
+int update_queries_counter(UINT_64 hash, int pull_mode, char alg)
 {
-	int match;
+	// returns the number of queries including this one, or 0 if the entry is not in the cache.
+	// Exactly one thread sees each value, so a threshold triggers only once.
+	int queries = 0;
 	cache_entry* e;
+	cache_shard *s = lock_shard(hash);
+
+	e = find_deadlock_cache_entry(s, hash, pull_mode, alg);
 
-	e = get_deadlock_cache_entry(hash, pull_mode, alg, &match);
+	if (e)
+		queries = ++(e->queries);
 
-	if (match == 0) return 0;
+	unlock_shard(s);
 
-	return e->queries;
+	return queries;
 }
 
 
-void update_queries_counter(UINT_64 hash, int pull_mode, char alg)
+// Only final verdicts are saved. SEARCH_EXCEEDED depends on the search budget, and a free move
+// verdict depends on the patterns that were learned in this run.
+#define MAX_SAVED_VERDICTS (1 << 20)
+
+typedef struct saved_verdict // 12 bytes in the file
 {
-	int match;
-	cache_entry* e;
+	UINT_64 hash;
+	char result;
+	char pull_mode;
+	char alg;
+	char unused;
+} saved_verdict;
+
+int is_saved_verdict(cache_entry *e)
+{
+	if (e->alg >= FREE_MOVE_VERDICT) return 0;
+	return ((e->hash != 0) && ((e->result == 0) || (e->result == 1)));
+}
+
+int write_deadlock_cache(FILE *fp)
+{
+	int i, n = 0, total;
+	cache_entry *e;
+	saved_verdict v;
 
-	e = get_deadlock_cache_entry(hash, pull_mode, alg, &match);
+	total = 1 << current_level->deadlock_cache->log_size;
 
-	if (match == 0) return;
+	for (i = 0; i < total; i++)
+		if (is_saved_verdict(current_level->deadlock_cache->entries + i))
+			n++;
+	if (n > MAX_SAVED_VERDICTS) n = MAX_SAVED_VERDICTS;
 
-	e->queries++;
-}
\ No newline at end of file
+	if (write_kb_data(fp, &n, sizeof(int)) == 0) return 0;
+
+	for (i = 0; (i < total) && (n > 0); i++)
+	{
+		e = current_level->deadlock_cache->entries + i;
+		if (is_saved_verdict(e) == 0) continue;
+
+		v.hash = e->hash;
+		v.result = e->result;
+		v.pull_mode = e->pull_mode;
+		v.alg = e->alg;
+		v.unused = 0;
+
+		if (write_kb_data(fp, &v.hash, sizeof(UINT_64)) == 0) return 0;
+		if (write_kb_data(fp, &v.result, 1) == 0) return 0;
+		if (write_kb_data(fp, &v.pull_mode, 1) == 0) return 0;
+		if (write_kb_data(fp, &v.alg, 1) == 0) return 0;
+		if (write_kb_data(fp, &v.unused, 1) == 0) return 0;
+		n--;
+	}
+	return 1;
+}
+
+int read_deadlock_cache(FILE *fp)
+{
+	int i, n;
+	saved_verdict v;
+
+	if (read_kb_data(fp, &n, sizeof(int)) == 0) return 0;
+	if ((n < 0) || (n > MAX_SAVED_VERDICTS)) return 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (read_kb_data(fp, &v.hash, sizeof(UINT_64)) == 0) return 0;
+		if (read_kb_data(fp, &v.result, 1) == 0) return 0;
+		if (read_kb_data(fp, &v.pull_mode, 1) == 0) return 0;
+		if (read_kb_data(fp, &v.alg, 1) == 0) return 0;
+		if (read_kb_data(fp, &v.unused, 1) == 0) return 0;
+
+		if ((v.hash == 0) || ((v.result != 0) && (v.result != 1))) return 0;
+
+		if ((v.pull_mode != 0) && (v.pull_mode != 1)) continue;
+		// free move verdicts depend on the patterns learned in the run that saved them
+		if ((v.alg < 0) || (v.alg >= FREE_MOVE_VERDICT)) continue;
+
+		insert_to_deadlock_cache(v.hash, v.result, v.pull_mode, v.alg);
+	}
+	return 1;
+}
@@ -1,14 +1,25 @@
 // Festival Sokoban Solver
 // Copyright 2018-2020 Yaron Shoham
 
+#include <stdio.h>
+
 #include "global.h"
 
+// The verdicts of move_is_deadlocked() for a child position are cached with alg MOVE_VERDICT + search_mode
+// (deadlocked) and FREE_MOVE_VERDICT + search_mode (not deadlocked, valid only until more patterns are learned)
+#define MOVE_VERDICT      64
+#define FREE_MOVE_VERDICT 96
+
 int get_from_deadlock_cache(UINT_64 hash, int pull_mode, char alg);
 void insert_to_deadlock_cache(UINT_64 hash, int res, int pull_mode, char alg);
 void clear_deadlock_cache();
-int get_queries_num(UINT_64 hash, int pull_mode, char alg);
-void update_queries_counter(UINT_64 hash, int pull_mode, char alg);
+void print_deadlock_cache_stats();
+int write_deadlock_cache(FILE *fp);
+int read_deadlock_cache(FILE *fp);
+int update_queries_counter(UINT_64 hash, int pull_mode, char alg);
 
 
-void allocate_deadlock_cache();
-void free_deadlock_cache();
\ No newline at end of file
+int get_log_deadlock_cache();
+UINT_64 get_deadlock_cache_memory(int log_size);
+void allocate_deadlock_cache(level_context *l);
+void free_deadlock_cache(level_context *l);
\ No newline at end of file
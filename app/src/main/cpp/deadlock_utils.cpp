@@ -13,8 +13,8 @@ void get_deadlock_zone_indicator(board b, board dz)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			dz[i][j] = (b[i][j] >> 5) & 1;
 }
 
@@ -22,8 +22,8 @@ void clear_deadlock_zone_inplace(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b[i][j] &= ~DEADLOCK_ZONE;
 }
 
@@ -31,8 +31,8 @@ void clear_deadlock_zone(board b_in, board b_out)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b_out[i][j] = b_in[i][j] & ~DEADLOCK_ZONE;
 }
 
@@ -41,8 +41,8 @@ int work_left_in_deadlock_zone(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & DEADLOCK_ZONE) == 0) continue;
 			if (b[i][j] & SOKOBAN) continue; // probably a diagonal added to the zone
@@ -60,16 +60,16 @@ int work_left_outside_deadlock_zone(board b)
 	// make sure boxes match bases.
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & DEADLOCK_ZONE) continue;
 
 			if (b[i][j] & BOX) 
-				if ((initial_board[i][j] & BOX) == 0)
+				if ((current_level->initial_board[i][j] & BOX) == 0)
 					return 1;
 
-			if (initial_board[i][j] & BOX)
+			if (current_level->initial_board[i][j] & BOX)
 				if ((b[i][j] & BOX) == 0)
 					return 1;
 		}
@@ -79,8 +79,8 @@ int work_left_outside_deadlock_zone(board b)
 void get_sokoban_cloud_as_group(board b, board g)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			g[i][j] = (b[i][j] & SOKOBAN ? 1 : 0);
 }
 
@@ -116,7 +116,7 @@ void update_deadlock_zone_from_group_push_mode(board b, board group)
 
 	clear_deadlock_zone_inplace(b);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 
@@ -143,8 +143,8 @@ void update_deadlock_zone_from_group_push_mode(board b, board group)
 		}
 	}
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (prev_deadlock_zone[i][j] == 0)
 				b[i][j] &= ~DEADLOCK_ZONE;
@@ -159,10 +159,10 @@ void add_islands(board b)
 
 	get_deadlock_zone_indicator(b, dz);
 
-	for (i = 0 ; i < height ; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0 ; i < current_level->height ; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if (b[i][j] & OCCUPIED) continue;
 			if (dz[i][j]) continue;
 
@@ -195,8 +195,8 @@ void init_deadlock_zone_from_group(board b, board group, int pull_mode)
 	{
 		clear_deadlock_zone_inplace(b);
 
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if (group[i][j] == 0) continue;
 
@@ -212,8 +212,8 @@ void init_deadlock_zone_from_group(board b, board group, int pull_mode)
 	}
 
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			b[i][j] |= DEADLOCK_ZONE;
 
 	update_deadlock_zone_from_group_push_mode(b, group);
@@ -236,11 +236,11 @@ void update_deadlock_zone_push_mode(board b)
 
 	zero_board(unreachable);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & SOKOBAN) continue;
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if (b[i][j] & OCCUPIED) continue;
 
 			if ((b[i][j] & DEADLOCK_ZONE) == 0) continue; // new DZ must be inside older DZ
@@ -272,13 +272,13 @@ void clear_frozen_boxes_away_from_deadlock_zone(board b)
 	board b_in;
 	int changed = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 
 			if (b[i][j] == WALL)
-				if (initial_board[i][j] != WALL)
+				if (current_level->initial_board[i][j] != WALL)
 					has_frozen = 1;
 		}
 
@@ -286,16 +286,16 @@ void clear_frozen_boxes_away_from_deadlock_zone(board b)
 
 	copy_board(b, b_in);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 
 			if (b[i][j] == WALL)
-				if (initial_board[i][j] != WALL)
+				if (current_level->initial_board[i][j] != WALL)
 					if (near_deadlock_zone(b, i, j) == 0)
 					{
-						b[i][j] = initial_board[i][j] & TARGET; // holes can be wallified
+						b[i][j] = current_level->initial_board[i][j] & TARGET; // holes can be wallified
 						changed = 1;
 					}
 		}
@@ -316,8 +316,8 @@ void clear_boxes_out_of_deadlock_zone(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if ((b[i][j] & DEADLOCK_ZONE) == 0)
 				b[i][j] &= ~BOX;
 
@@ -329,8 +329,8 @@ int exited_deadlock_zone(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & SOKOBAN)
 				if ((b[i][j] & DEADLOCK_ZONE) == 0)
 					return 1;
@@ -354,8 +354,8 @@ int size_of_deadlock_zone(board b)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & DEADLOCK_ZONE)
 				sum++;
 	return sum;
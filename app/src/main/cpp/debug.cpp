@@ -96,7 +96,7 @@ void print_node(tree* t, expansion_data* e, int print_moves, const char* message
 
 	printf("%s", message);
 
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 	print_board(b);
 
 	if (verbose < 4)
@@ -118,7 +118,7 @@ void print_node(tree* t, expansion_data* e, int print_moves, const char* message
 
 	if ((t->pull_mode) && (t->search_mode == NAIVE_SEARCH))
 	{
-		copy_board(initial_board, h->imagined_hf_board);
+		copy_board(current_level->initial_board, h->imagined_hf_board);
 		print_board_with_imagined(b, h);
 	}
 
@@ -212,13 +212,13 @@ void show_progress_tree(tree *t, expansion_data *last_node, expansion_data *best
 
 	if (verbose <= 3)
 	{   // do not show positions with removed boxes
-		if (best_so_far->node->score.boxes_in_level != global_boxes_in_level)
+		if (best_so_far->node->score.boxes_in_level != current_level->boxes_in_level)
 			return;
 	}
 
 	if ((verbose >= 5) || ((verbose >= 3) && (iter_num % 500) == 0))
 	{
-		sprintf(message, "Level: %d\n", level_id);
+		sprintf(message, "Level: %d\n", current_level->level_id);
 
 		if (show_current)
 		{
@@ -239,7 +239,7 @@ void show_progress_tree(tree *t, expansion_data *last_node, expansion_data *best
 
 		*last_best = best_so_far;
 
-		bytes_to_board(best_so_far->b, b);
+		get_expansion_board(best_so_far, b);
 		save_status(b, t->pull_mode);
 	}
 }
@@ -258,7 +258,7 @@ void show_progress_dragonfly(dragonfly_node* best_so_far, int iter_num, helper*
 
 	if ((verbose >= 5) || ((verbose >= 3) && (iter_num % 500) == 0))
 	{
-		sprintf(message, "Level: %d\n", level_id);
+		sprintf(message, "Level: %d\n", current_level->level_id);
 		strcat(message, "best so far: (pull mode)\n");
 
 		if (cores_num > 1)
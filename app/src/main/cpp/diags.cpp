@@ -26,17 +26,17 @@
 
 void mark_diags(board b, board diag_right, board diag_left)
 {
-	board inner;
+	board surrounded;
 	int i, j, k;
 	int diag_start,diag_end;
 
-	zero_board(inner);
+	zero_board(surrounded);
 	zero_board(diag_right);
 	zero_board(diag_left);
 
 	// mark all empty squares surrounded by four elements
-	for (i = 1; i < (height - 1); i++)
-		for (j = 1; j < (width - 1); j++)
+	for (i = 1; i < (current_level->height - 1); i++)
+		for (j = 1; j < (current_level->width - 1); j++)
 		{
 			if (b[i][j] & OCCUPIED) continue;
 			if (b[i][j] & SOKOBAN) continue; // this can happen in the initial position
@@ -45,7 +45,7 @@ void mark_diags(board b, board diag_right, board diag_left)
 			if ((b[i + 1][j] & OCCUPIED) == 0) continue;
 			if ((b[i][j + 1] & OCCUPIED) == 0) continue;
 			if ((b[i][j - 1] & OCCUPIED) == 0) continue;
-			inner[i][j] = 1;
+			surrounded[i][j] = 1;
 		}
 
 	// look for pattern:
@@ -56,10 +56,10 @@ void mark_diags(board b, board diag_right, board diag_left)
 	//    D
 	//     O
 
-	for (i = 1; i < (height - 1); i++)
-		for (j = 1; j < (width - 1); j++)
+	for (i = 1; i < (current_level->height - 1); i++)
+		for (j = 1; j < (current_level->width - 1); j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (surrounded[i][j] == 0) continue;
 
 			diag_start = 0;
 			if (b[i - 1][j - 1] & OCCUPIED) diag_start = 1;
@@ -67,7 +67,7 @@ void mark_diags(board b, board diag_right, board diag_left)
 			if (diag_start == 0) continue;
 
 			k = 1;
-			while (inner[i + k][j + k])
+			while (surrounded[i + k][j + k])
 				k++;
 
 			diag_end = 0;
@@ -86,10 +86,10 @@ void mark_diags(board b, board diag_right, board diag_left)
 	//   D
 	//  O
 
-	for (i = 1; i < (height - 1); i++)
-		for (j = 1; j < (width - 1); j++)
+	for (i = 1; i < (current_level->height - 1); i++)
+		for (j = 1; j < (current_level->width - 1); j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (surrounded[i][j] == 0) continue;
 
 			diag_start = 0;
 			if (b[i - 1][j + 1] & OCCUPIED) diag_start = 1;
@@ -97,7 +97,7 @@ void mark_diags(board b, board diag_right, board diag_left)
 			if (diag_start == 0) continue;
 
 			k = 1;
-			while (inner[i + k][j - k])
+			while (surrounded[i + k][j - k])
 				k++;
 
 			diag_end = 0;
@@ -242,9 +242,9 @@ int is_diag_deadlock(board b)
 
 	mark_diags(b, diag_right, diag_left);
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			n = diag_right[i][j];
 			if (n != 0)
@@ -4,34 +4,33 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef THREADS
+#include <pthread.h>
+#endif
+
 #include "graph.h"
 #include "distance.h"
 #include "bfs.h"
 #include "util.h"
 
-int distance_from_to[MAX_INNER][MAX_INNER];
-int bfs_distance_from_to[MAX_INNER][MAX_INNER];
-
-int impossible_place[MAX_INNER];
-
 void compute_can_get_to_dest(board b, int can_get_to_dest[MAX_INNER])
 {
 	int i, x, y, place;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		can_get_to_dest[i] = 0;
 
-		for (y = 0; y < height; y++)
+		for (y = 0; y < current_level->height; y++)
 		{
-			for (x = 0; x < width; x++)
+			for (x = 0; x < current_level->width; x++)
 			{
-				if (inner[y][x] == 0) continue;
+				if (current_level->inner[y][x] == 0) continue;
 
 				if (b[y][x] & TARGET)
 				{
 					place = y_x_to_index(y, x);
-					if (distance_from_to[i][place] < 1000000)
+					if (get_push_distance(i, place) < 1000000)
 						can_get_to_dest[i] = 1;
 				}
 			}
@@ -39,7 +38,7 @@ void compute_can_get_to_dest(board b, int can_get_to_dest[MAX_INNER])
 	}
 
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	if (can_get_to_dest[i] == 0)
 	{
 		index_to_y_x(i, &y, &x);
@@ -52,20 +51,20 @@ void compute_can_from_start(board b, int can_get_from_start[MAX_INNER])
 {
 	int i, x, y, place;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		can_get_from_start[i] = 0;
 
-		for (y = 0; y < height; y++)
+		for (y = 0; y < current_level->height; y++)
 		{
-			for (x = 0; x < width; x++)
+			for (x = 0; x < current_level->width; x++)
 			{
-				if (inner[y][x] == 0) continue;
+				if (current_level->inner[y][x] == 0) continue;
 
 				if (b[y][x] & BOX)
 				{
 					place = y_x_to_index(y, x);
-					if (distance_from_to[place][i] < 1000000)
+					if (get_push_distance(place, i) < 1000000)
 						can_get_from_start[i] = 1;
 				}
 			}
@@ -73,7 +72,7 @@ void compute_can_from_start(board b, int can_get_from_start[MAX_INNER])
 	}
 
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	if (can_get_from_start[i] == 0)
 	{
 		index_to_y_x(i, &y, &x);
@@ -86,39 +85,91 @@ void set_impossible_places(int can_get_to_dest[MAX_INNER], int can_get_from_star
 	int i;
 
 	for (i = 0; i < MAX_INNER; i++)
-		impossible_place[i] = 1;
+		current_level->impossible_place[i] = 1;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	if ((can_get_from_start[i]) && (can_get_to_dest[i]))
-		impossible_place[i] = 0;
+		current_level->impossible_place[i] = 0;
 
 }
 
 
 
-void set_bfs_distances(board b)
+void allocate_distance_tables()
 {
-	int i, j;
-	int y1, x1;
-	int y2, x2;
+	// the tables are kept between levels, and grow when a level has more inner squares
+	size_t size = (size_t)current_level->index_num * current_level->index_num;
+
+	if (size <= current_level->distance_table_size) return;
+
+	free(current_level->distance_from_to);
+	free(current_level->bfs_distance_from_to);
+
+	current_level->distance_from_to     = (UINT_16*)malloc(size * sizeof(UINT_16));
+	current_level->bfs_distance_from_to = (UINT_16*)malloc(size * sizeof(UINT_16));
+
+	if ((current_level->distance_from_to == 0) || (current_level->bfs_distance_from_to == 0))
+		exit_with_error("can't allocate distance tables\n");
+
+	current_level->distance_table_size = size;
+}
+
+void set_distance_entry(UINT_16 *table, int from, int to, int dist)
+{
+	if (dist >= NO_DISTANCE) dist = NO_DISTANCE; // unreachable
+
+	table[from * current_level->index_num + to] = (UINT_16)dist;
+}
 
+
+
+typedef struct distance_worker_data
+{
+	level_context *level;
+	graph_data *gd;
+	board *b;
+	int first_index;
+	int step;
+} distance_worker_data;
+
+void *distance_worker(void *arg)
+{
+	// fills the rows first_index, first_index + step, ... of both distance tables
+	distance_worker_data *w = (distance_worker_data*)arg;
+	int from_index, to_index;
+	int y, x;
+	int *weights, *deque;
 	int_board d;
 
-	for (i = 0; i < index_num; i++)
+	current_level = w->level;
+
+	weights = (int*)malloc(sizeof(int) * w->gd->vertices_num);
+	deque = (int*)malloc(sizeof(int) * get_graph_deque_size(w->gd));
+	if ((weights == 0) || (deque == 0))
+		exit_with_error("can't allocate distance buffers\n");
+
+	for (from_index = w->first_index; from_index < current_level->index_num; from_index += w->step)
 	{
-		index_to_y_x(i, &y1, &x1);
-		bfs(b, d, y1, x1, 1); // 1 = ignore boxes
-		
-		for (j = 0; j < index_num; j++)
-		{
-			index_to_y_x(j, &y2, &x2);
+		compute_graph_distances(from_index, 0, w->gd, weights, deque); // 0 = push mode
+
+		for (to_index = 0; to_index < current_level->index_num; to_index++)
+			set_distance_entry(current_level->distance_from_to, from_index, to_index,
+				get_cell_weight(to_index, w->gd, weights));
 
-			bfs_distance_from_to[i][j] = d[y2][x2];
+		index_to_y_x(from_index, &y, &x);
+		bfs(*w->b, d, y, x, 1); // 1 = ignore boxes
+
+		for (to_index = 0; to_index < current_level->index_num; to_index++)
+		{
+			index_to_y_x(to_index, &y, &x);
+			set_distance_entry(current_level->bfs_distance_from_to, from_index, to_index, d[y][x]);
 		}
 	}
-}
-
 
+	free(weights);
+	free(deque);
+	return NULL;
+}
 
 void set_distances(board b)
 {
@@ -126,9 +177,12 @@ void set_distances(board b)
 	int can_get_to_dest[MAX_INNER];
 	int can_get_from_start[MAX_INNER];
 
-	int from_index, to_index;
-	int dist;
+	int i, workers_num = 1;
+	distance_worker_data *workers;
 	graph_data *gd;
+	UINT_64 start_ms = get_time_in_ms();
+
+	allocate_distance_tables();
 
 	gd = allocate_graph();
 
@@ -136,26 +190,55 @@ void set_distances(board b)
 
 	build_graph(board_without_boxes, 0, gd); // 0 = push_mode
 
-	for (from_index = 0; from_index < index_num; from_index++)
+#ifdef THREADS
+	workers_num = cores_num;
+	if (workers_num > current_level->index_num)
+		workers_num = current_level->index_num;
+	if (workers_num < 1)
+		workers_num = 1;
+#endif
+
+	workers = (distance_worker_data*)malloc(sizeof(distance_worker_data) * workers_num);
+	if (workers == 0) exit_with_error("can't allocate distance workers\n");
+
+	for (i = 0; i < workers_num; i++)
 	{
-		set_graph_weights_to_infinity(gd);
-		clear_weight_around_cell(from_index, gd);
-		do_graph_iterations(0, gd); // 0 = push mode
-		
-		for (to_index = 0; to_index < index_num; to_index++)
-		{
-			dist = get_weight_around_cell(to_index, gd);
-			distance_from_to[from_index][to_index] = dist;
-		}
+		workers[i].level = current_level;
+		workers[i].gd = gd;
+		workers[i].b = &board_without_boxes;
+		workers[i].first_index = i;
+		workers[i].step = workers_num;
+	}
+
+	if (workers_num == 1)
+		distance_worker((void*)workers);
+	else
+	{
+#ifdef THREADS
+		pthread_t *threads = (pthread_t*)malloc(sizeof(pthread_t) * workers_num);
+		if (threads == 0) exit_with_error("can't allocate threads\n");
+
+		for (i = 0; i < workers_num; i++)
+			pthread_create(&threads[i], NULL, distance_worker, workers + i);
+
+		for (i = 0; i < workers_num; i++)
+			pthread_join(threads[i], NULL);
+
+		free(threads);
+#endif
 	}
 
+	free(workers);
+
 	compute_can_get_to_dest(b, can_get_to_dest);
 	compute_can_from_start(b, can_get_from_start);
 	set_impossible_places(can_get_to_dest, can_get_from_start);
 
-	set_bfs_distances(b);
+	free_graph(gd);
 
-	free(gd);
+	if (verbose >= 4)
+		printf("distances: %d squares, %d threads, %d ms\n", current_level->index_num, workers_num,
+			(int)(get_time_in_ms() - start_ms));
 }
 
 
@@ -168,8 +251,8 @@ void get_distance_from_targets(board b, int_board dist)
 	zero_board(target_area);
 	clear_boxes(b, board_without_boxes);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & TARGET)
 				target_area[i][j] = 1;
 
@@ -5,9 +5,32 @@
 
 void set_distances(board b);
 
-extern int distance_from_to[MAX_INNER][MAX_INNER];
-extern int impossible_place[MAX_INNER];
-extern int bfs_distance_from_to[MAX_INNER][MAX_INNER];
+// Distances between inner squares are kept in tables of index_num x index_num 16 bit entries.
+// Row "from" holds the distances from square "from" to all squares.
+// Unreachable squares are stored as NO_DISTANCE and reported as 1000000.
+
+#define NO_DISTANCE 0xFFFF
+
+inline int unpack_distance(UINT_16 d)
+{
+	return (d == NO_DISTANCE ? 1000000 : d);
+}
+
+inline UINT_16 *get_push_distance_row(int from)
+{
+	return current_level->distance_from_to + from * current_level->index_num;
+}
+
+inline int get_push_distance(int from, int to)
+{
+	return unpack_distance(current_level->distance_from_to[from * current_level->index_num + to]);
+}
+
+inline int get_bfs_distance(int from, int to)
+{
+	return unpack_distance(current_level->bfs_distance_from_to[from * current_level->index_num + to]);
+}
+
 
 void get_distance_from_targets(board b, int_board dist);
 
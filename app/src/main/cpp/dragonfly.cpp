@@ -17,37 +17,97 @@
 #include "fixed_boxes.h"
 #include "debug.h"
 
-dragonfly_node* dragonfly_nodes;
-int dragonfly_nodes_num;
-int dragonfly_max_nodes;
-
 #define MAX_DRAGONFLY_ROOTS 200
 
-board dragonfly_roots[MAX_DRAGONFLY_ROOTS];
-int dragonfly_roots_num = 0;
+// Every DRAGONFLY_CHECKPOINT_DEPTH levels, a node stores its boxes in the checkpoints table,
+// so a board is rebuilt by replaying at most that many moves instead of the whole path
+// from the root. A checkpoint holds the root index, the number of boxes and their indices.
+// The table has room for a checkpoint per DRAGONFLY_CHECKPOINT_DEPTH nodes and per root.
+// When it is full, nodes are rebuilt from an earlier checkpoint.
+#define DRAGONFLY_CHECKPOINT_DEPTH 16
+#define MAX_CHECKPOINT_ENTRIES 0x7FFFFFFF // places are ints
+
+typedef struct dragonfly_data
+{
+	dragonfly_node* nodes;
+	int nodes_num;
+	int max_nodes;
+
+	UINT_16 *checkpoints;
+	int checkpoints_used;
+	int max_checkpoints;
+
+	board roots[MAX_DRAGONFLY_ROOTS];
+	int roots_num;
 
-dragonfly_queue dragonfly_q ;
+	dragonfly_queue q;
+
+	// expansion buffers
+	move moves[MAX_MOVES];
+	UINT_64 hashes[MAX_MOVES];
+	int visited[MAX_MOVES];
+	score_element scores[MAX_MOVES];
+	int packed[MAX_MOVES];
+	int possible[MAX_MOVES];
+} dragonfly_data;
+
+int get_dragonfly_log_size()
+{
+	return 22 + get_cores_log() + extra_mem;
+}
 
-void init_dragonfly()
+UINT_64 get_checkpoint_entries(UINT_64 max_nodes, int boxes)
 {
+	UINT_64 entries = (max_nodes / DRAGONFLY_CHECKPOINT_DEPTH + MAX_DRAGONFLY_ROOTS) * (2 + boxes);
+
+	if (entries > MAX_CHECKPOINT_ENTRIES)
+		entries = MAX_CHECKPOINT_ENTRIES;
+	return entries;
+}
+
+UINT_64 get_dragonfly_memory(int log_size)
+{
+	// the nodes, the queue in the worst case, and the checkpoints of a level with MAX_BOXES boxes
+	return ((UINT_64)(sizeof(dragonfly_node) + sizeof(int)) << log_size) +
+		sizeof(UINT_16) * get_checkpoint_entries((UINT_64)1 << log_size, MAX_BOXES);
+}
+
+void init_dragonfly(level_context *l)
+{
+	dragonfly_data *d;
 	size_t size;
 
-	if (cores_num == 1) dragonfly_max_nodes = 1 << 22;
-	if (cores_num == 2) dragonfly_max_nodes = 1 << 23;
-	if (cores_num == 4) dragonfly_max_nodes = 1 << 24;
-	if (cores_num == 8) dragonfly_max_nodes = 1 << 25;
+	d = (dragonfly_data*)malloc(sizeof(dragonfly_data));
+	if (d == 0) exit_with_error("can't allocate dragonfly data");
+
+	d->max_nodes = 1 << l->dragonfly_log_size;
 
-	dragonfly_max_nodes *= (1 << extra_mem);
+	size = d->max_nodes * sizeof(dragonfly_node);
+	d->nodes = (dragonfly_node*)malloc(size);
+	if (d->nodes == 0) exit_with_error("can't allocate nodes");
 
-	size = dragonfly_max_nodes * sizeof(dragonfly_node);
-	dragonfly_nodes = (dragonfly_node*)malloc(size);
-	if (dragonfly_nodes == 0) exit_with_error("can't allocate nodes");
+	// allocated for the number of boxes of the level (see set_dragonfly_checkpoints)
+	d->checkpoints = 0;
+	d->max_checkpoints = 0;
+	d->checkpoints_used = 0;
 
 	if (verbose >= 4)
 		printf("Allocating %12llu bytes for %12d dragonfly nodes\n", 
-			(UINT_64)size, dragonfly_max_nodes);
+			(UINT_64)size, d->max_nodes);
 
-	dragonfly_init_queue(&dragonfly_q, dragonfly_nodes);
+	d->nodes_num = 0;
+	d->roots_num = 0;
+	dragonfly_init_queue(&d->q, d->nodes);
+
+	l->dragonfly = d;
+}
+
+void free_dragonfly(level_context *l)
+{
+	dragonfly_free_heap(&l->dragonfly->q);
+	free(l->dragonfly->nodes);
+	free(l->dragonfly->checkpoints);
+	free(l->dragonfly);
 }
 
 	
@@ -63,24 +123,25 @@ int dist_from_bases(board b)
 
 void add_dragonfly_root(board b)
 {
-	dragonfly_node* e = dragonfly_nodes + dragonfly_nodes_num;
+	dragonfly_node* e = current_level->dragonfly->nodes + current_level->dragonfly->nodes_num;
 
-	copy_board(b, dragonfly_roots[dragonfly_roots_num]);
-	dragonfly_roots_num++;
+	copy_board(b, current_level->dragonfly->roots[current_level->dragonfly->roots_num]);
+	current_level->dragonfly->roots_num++;
 
-	if (dragonfly_roots_num >= MAX_DRAGONFLY_ROOTS) exit_with_error("too many roots");
+	if (current_level->dragonfly->roots_num >= MAX_DRAGONFLY_ROOTS) exit_with_error("too many roots");
 
-	e->board = dragonfly_roots_num - 1;
+	e->board = current_level->dragonfly->roots_num - 1;
 	e->depth = 0;
 	e->father = -1;
+	e->checkpoint = -1;
 	e->move_from = -1;
 	e->move_to = -1;
 	e->player_position = 4;
 	e->dist = dist_from_bases(b);
 	e->packed = boxes_on_bases(b);
-	dragonfly_nodes_num++;
+	current_level->dragonfly->nodes_num++;
 
-	dragonfly_heap_insert(&dragonfly_q, dragonfly_nodes_num - 1);
+	dragonfly_heap_insert(&current_level->dragonfly->q, current_level->dragonfly->nodes_num - 1);
 
 	UINT_64 hash = get_board_hash(b);
 	int visited = 0;
@@ -88,32 +149,114 @@ void add_dragonfly_root(board b)
 
 }
 
-void dragonfly_get_board(dragonfly_node* e, board b)
+void set_dragonfly_checkpoints()
+{
+	// the table only grows, so it is reallocated when a level has more boxes than the previous ones
+	dragonfly_data *d = current_level->dragonfly;
+	int entries = (int)get_checkpoint_entries(d->max_nodes, current_level->boxes_in_level);
+
+	d->checkpoints_used = 0;
+
+	if (entries <= d->max_checkpoints) return;
+
+	free(d->checkpoints);
+	d->checkpoints = (UINT_16*)malloc(entries * sizeof(UINT_16));
+	if (d->checkpoints == 0) exit_with_error("can't allocate checkpoints");
+	d->max_checkpoints = entries;
+}
+
+int add_dragonfly_checkpoint(board father_board, move *m, int root)
 {
-	move moves[MAX_SOL_LEN];
+	// stores the boxes of the board after the move. Returns the place, or -1 if there is no room
+	dragonfly_data *d = current_level->dragonfly;
+	int place = d->checkpoints_used;
+	int i, y, x, n = 0;
+
+	if (place + 2 + current_level->boxes_in_level > d->max_checkpoints)
+		return -1;
+
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		if (father_board[y][x] & BOX)
+		{
+			if (n == current_level->boxes_in_level) exit_with_error("too many boxes in checkpoint");
+			d->checkpoints[place + 2 + n++] = (i == m->from ? m->to : i);
+		}
+	}
+
+	d->checkpoints[place] = root;
+	d->checkpoints[place + 1] = n;
+	d->checkpoints_used += 2 + n;
+
+	return place;
+}
+
+int get_board_from_checkpoint(int place, board b)
+{
+	// returns the root index
+	UINT_16 *c = current_level->dragonfly->checkpoints + place;
+	int i, y, x;
+
+	copy_board(current_level->dragonfly->roots[c[0]], b);
+
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		b[y][x] &= ~BOX;
+	}
+
+	for (i = 0; i < c[1]; i++)
+	{
+		index_to_y_x(c[2 + i], &y, &x);
+		b[y][x] |= BOX;
+	}
+
+	return c[0];
+}
+
+int dragonfly_get_board(dragonfly_node* e, board b)
+{
+	// returns the index of the node's root
+	move moves[DRAGONFLY_CHECKPOINT_DEPTH];
 	int moves_num = 0;
 	int i,y,x;
 	int player = e->player_position;
+	int root = -1;
+	dragonfly_node *last = e;
 
 	if (e->board != 0xff) // root
 	{
-		copy_board(dragonfly_roots[e->board], b);
-		return;
+		copy_board(current_level->dragonfly->roots[e->board], b);
+		return e->board;
 	}
 
-	while (e->board == 0xff) // not a root
+	while ((e->board == 0xff) && (e->checkpoint == -1)) // not a root and no checkpoint
 	{
-		if (moves_num >= MAX_SOL_LEN) exit_with_error("too deep");
+		if (moves_num == DRAGONFLY_CHECKPOINT_DEPTH)
+		{
+			// no room for the checkpoint of an ancestor. Rebuild it first.
+			root = dragonfly_get_board(e, b);
+			break;
+		}
 
 		moves[moves_num].from = e->move_from;
 		moves[moves_num].to   = e->move_to;
 		moves_num++;
-		e = dragonfly_nodes + e->father;
+		e = current_level->dragonfly->nodes + e->father;
+	}
 
-		if (moves_num >= MAX_SOL_LEN) exit_with_error("sol too long");
+	if (root == -1)
+	{
+		if (e->board != 0xff)
+		{
+			copy_board(current_level->dragonfly->roots[e->board], b);
+			root = e->board;
+		}
+		else
+			root = get_board_from_checkpoint(e->checkpoint, b);
 	}
 
-	copy_board(dragonfly_roots[e->board], b);
 	for (i = moves_num - 1; i >= 0; i--)
 	{
 		index_to_y_x(moves[i].from, &y, &x);
@@ -125,9 +268,13 @@ void dragonfly_get_board(dragonfly_node* e, board b)
 		b[y][x] |= BOX;
 	}
 
+	index_to_y_x(last->move_to, &y, &x);
+
 	clear_sokoban_inplace(b);
 	b[y + delta_y[player]][x + delta_x[player]] |= SOKOBAN;
 	expand_sokoban_cloud(b);
+
+	return root;
 }
 
 
@@ -233,16 +380,18 @@ int dragonfly_expand_node(dragonfly_node* e, helper* h)
 	move m;
 	int i, moves_num;
 	int has_corral;
+	move_parent parent;
 	score_element base_score;
 	dragonfly_node new_node, * father;
+	int root;
 
-	// using static - only one instance of dragonfly
-	static move moves[MAX_MOVES];
-	static UINT_64 hashes[MAX_MOVES];
-	static int visited[MAX_MOVES];
-	static score_element scores[MAX_MOVES];
-	static int packed[MAX_MOVES];
-	static int possible[MAX_MOVES];
+	// the buffers are too big for the stack
+	move *moves = current_level->dragonfly->moves;
+	UINT_64 *hashes = current_level->dragonfly->hashes;
+	int *visited = current_level->dragonfly->visited;
+	score_element *scores = current_level->dragonfly->scores;
+	int *packed = current_level->dragonfly->packed;
+	int *possible = current_level->dragonfly->possible;
 
 	if (verbose >= 5)
 	{
@@ -255,7 +404,7 @@ int dragonfly_expand_node(dragonfly_node* e, helper* h)
 
 	if (e->board == 0xff) // not a root
 	{
-		father = dragonfly_nodes + e->father;
+		father = current_level->dragonfly->nodes + e->father;
 
 		dragonfly_get_board(father, b);
 
@@ -274,7 +423,7 @@ int dragonfly_expand_node(dragonfly_node* e, helper* h)
 	
 	// so the node seems to be valid
 
-	dragonfly_get_board(e, b);
+	root = dragonfly_get_board(e, b);
 
 	moves_num = find_possible_moves(b, moves, 1, &has_corral, NORMAL, h);
 
@@ -282,11 +431,11 @@ int dragonfly_expand_node(dragonfly_node* e, helper* h)
 
 	mark_moves_when_corral(b, moves, moves_num, e->move_to, possible);
 
+	prepare_move_parent(b, get_board_hash(b), &parent);
+
 	for (i = 0; i < moves_num; i++)
 	{
-		copy_board(b, c);
-		apply_move(c, moves + i, NORMAL);
-		hashes[i] = get_board_hash(c);
+		hashes[i] = apply_move_and_hash(&parent, moves + i, NORMAL, c);
 		packed[i] = boxes_on_bases(c);
 	}
 
@@ -323,11 +472,15 @@ int dragonfly_expand_node(dragonfly_node* e, helper* h)
 		new_node.board = 0xff;
 		new_node.depth = e->depth + 1;
 		new_node.dist = scores[i].dist_to_targets;
-		new_node.father = (int)(e - dragonfly_nodes);
+		new_node.father = (int)(e - current_level->dragonfly->nodes);
 		new_node.move_from = moves[i].from;
 		new_node.move_to = moves[i].to;
 		new_node.player_position = moves[i].sokoban_position;
 		new_node.packed = packed[i];
+		new_node.checkpoint = -1;
+
+		if ((new_node.depth % DRAGONFLY_CHECKPOINT_DEPTH) == 0)
+			new_node.checkpoint = add_dragonfly_checkpoint(b, moves + i, root);
 
 		if (visited[i] < 0)
 		{
@@ -344,9 +497,9 @@ int dragonfly_expand_node(dragonfly_node* e, helper* h)
 			new_node.dist = visited[i]; // make dist an attractive negative value
 		}
 
-		dragonfly_nodes[dragonfly_nodes_num++] = new_node;
+		current_level->dragonfly->nodes[current_level->dragonfly->nodes_num++] = new_node;
 
-		dragonfly_heap_insert(&dragonfly_q, dragonfly_nodes_num - 1);
+		dragonfly_heap_insert(&current_level->dragonfly->q, current_level->dragonfly->nodes_num - 1);
 	}
 
 	dragonfly_update_perimeter(hashes, visited, moves_num, e->depth + 1);
@@ -375,7 +528,7 @@ void dragonfly_show_path(dragonfly_node* e)
 	{
 		dragonfly_get_board(e, b);
 		print_board(b);
-		e = dragonfly_nodes + e->father;
+		e = current_level->dragonfly->nodes + e->father;
 	}
 }
 
@@ -390,12 +543,13 @@ void dragonfly_search(board b_in, int time_allocation, helper *h)
 	board b,c;
 	dragonfly_node* e, *best_so_far;
 	int iter_num = 0;
-	int start_time = (int)time(0);
+	UINT_64 local_start_ms = get_time_in_ms();
 
 
-	dragonfly_reset_heap(&dragonfly_q);
-	dragonfly_nodes_num = 0;
-	dragonfly_roots_num = 0;
+	dragonfly_reset_heap(&current_level->dragonfly->q);
+	current_level->dragonfly->nodes_num = 0;
+	current_level->dragonfly->roots_num = 0;
+	set_dragonfly_checkpoints();
 
 	h->perimeter_found = 0;
 
@@ -411,21 +565,21 @@ void dragonfly_search(board b_in, int time_allocation, helper *h)
 		add_dragonfly_root(c);
 	}
 
-	best_so_far = dragonfly_nodes;
+	best_so_far = current_level->dragonfly->nodes;
 
 	while (1)
 	{
 		iter_num++;
 
-		if (any_core_solved) break;
+		if (current_level->any_core_solved) break;
 		
-		if ((int)time(0) > (start_time + time_allocation))
+		if (time_limit_exceeded(time_allocation, local_start_ms))
 		{
-			if (verbose >= 4) printf("dragonfly time exceeded. %d nodes\n", dragonfly_nodes_num);
+			if (verbose >= 4) printf("dragonfly time exceeded. %d nodes\n", current_level->dragonfly->nodes_num);
 			break;
 		}
 		
-		node_index = dragonfly_extarct_max(&dragonfly_q);
+		node_index = dragonfly_extarct_max(&current_level->dragonfly->q);
 
 		if (node_index == -1)
 		{
@@ -433,7 +587,7 @@ void dragonfly_search(board b_in, int time_allocation, helper *h)
 			break;
 		}
 
-		e = dragonfly_nodes + node_index;
+		e = current_level->dragonfly->nodes + node_index;
 		
 		
 
@@ -442,7 +596,7 @@ void dragonfly_search(board b_in, int time_allocation, helper *h)
 			if (verbose >= 4)
 			{
 				dragonfly_print_node(e);
-				printf("%d nodes\n\n", dragonfly_nodes_num);
+				printf("%d nodes\n\n", current_level->dragonfly->nodes_num);
 				printf("\ndragonfly SOLVED!\n\n");
 				//	dragonfly_show_path(e);
 			}
@@ -460,7 +614,7 @@ void dragonfly_search(board b_in, int time_allocation, helper *h)
 //		if (((iter_num % 9999) == 0) && (res == 1))
 //			dragonfly_print_node(e);		
 
-		if (dragonfly_nodes_num >= (dragonfly_max_nodes - MAX_MOVES))
+		if (current_level->dragonfly->nodes_num >= (current_level->dragonfly->max_nodes - MAX_MOVES))
 		{
 			if (verbose >= 4) printf("dragonfly max nodes reached\n");
 			break;
@@ -473,5 +627,5 @@ void dragonfly_search(board b_in, int time_allocation, helper *h)
 		}
 	}
 
-	dragonfly_reset_heap(&dragonfly_q);
+	dragonfly_reset_heap(&current_level->dragonfly->q);
 }
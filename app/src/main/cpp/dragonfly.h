@@ -5,17 +5,21 @@
 
 typedef struct dragonfly_node
 {
-	unsigned char board;
-	unsigned short depth;
 	int father;
+	int dist;
+	int checkpoint; // place of the node's boxes in the checkpoints table, or -1
+	unsigned short depth;
 	unsigned short move_from;
 	unsigned short move_to;
-	unsigned char player_position;
-	int dist;
 	unsigned short packed;
+	unsigned char board;
+	unsigned char player_position;
 } dragonfly_node;
 
-void init_dragonfly();
+int get_dragonfly_log_size();
+UINT_64 get_dragonfly_memory(int log_size);
+void init_dragonfly(level_context *l);
+void free_dragonfly(level_context *l);
 void dragonfly_search(board b_in, int time_allocation, helper* h);
 void dragonfly_print_node(dragonfly_node* e);
 
@@ -42,19 +42,19 @@ int has_winning_move(tree *t, expansion_data *e, helper *h)
 	{
 		place = find_node_by_hash(t, mh[i].hash);
 		if (place == -1) exit_with_error("missing node");
-		if (t->nodes[place].score.boxes_on_targets == global_boxes_in_level)
+		if (t->nodes[place].score.boxes_on_targets == current_level->boxes_in_level)
 			break;
 	}
 
 	if (i == e->moves_num) return 0;
 
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 	apply_move(b, &mh[i].move, NORMAL);
 
 	// perturb the board a little to differentiate it from the actual root
 
-	for (y = 0; y < height; y++)
-		for (x = 0; x < width; x++)
+	for (y = 0; y < current_level->height; y++)
+		for (x = 0; x < current_level->width; x++)
 			b[y][x] &= ~TARGET;
 
 	set_root(t, b, h);
@@ -75,7 +75,7 @@ void FESS(board b, int time_allocation, int search_mode, tree *t, helper *h)
 	int weight;
 	int solved = 0;
 	expansion_data *best_so_far;
-	int local_start_time;
+	UINT_64 local_start_ms;
 	board c;
 	int label;
 	score_element *s;
@@ -94,7 +94,7 @@ void FESS(board b, int time_allocation, int search_mode, tree *t, helper *h)
 
 	init_scored_distance(b, 0, h); // 0 = push_mode
 
-	local_start_time = (int)time(0);
+	local_start_ms = get_time_in_ms();
 	
 	// TREE
 	reset_tree(t);
@@ -136,8 +136,8 @@ void FESS(board b, int time_allocation, int search_mode, tree *t, helper *h)
 	{
 		iter_num++;
 
-		if (time_limit_exceeded(time_allocation, local_start_time)) break;
-		if (any_core_solved) break;
+		if (time_limit_exceeded(time_allocation, local_start_ms)) break;
+		if (current_level->any_core_solved) break;
 
 
 		if ((iter_num & 1) || h->perimeter_found)
@@ -192,7 +192,7 @@ void FESS(board b, int time_allocation, int search_mode, tree *t, helper *h)
 		}
 	
 		// check if the chosen move is deadlocked
-		bytes_to_board(expanded_node->b, c);
+		get_expansion_board(expanded_node, c);
 		if (move_is_deadlocked(c, played_move, 0, search_mode)) // 0 - pull mode
 		{
 			if (verbose >= 5)
@@ -271,11 +271,12 @@ void FESS(board b, int time_allocation, int search_mode, tree *t, helper *h)
 			break;
 		}
 
-		if (tree_nearly_full(t))
+		if (tree_nearly_full(t, &best_so_far))
 		{
-			strcpy(global_fail_reason, "Max nodes reached");
+			strcpy(current_level->fail_reason, "Max nodes reached");
 			break;
 		}
+		new_node = last_expansion(t); // moved if the tree was compacted
 		
 		show_progress_tree(t, new_node, best_so_far, search_pos_num, &last_best, h);
 
@@ -306,7 +307,10 @@ void FESS(board b, int time_allocation, int search_mode, tree *t, helper *h)
 	}
 
 	if (verbose >= 4)
+	{
 		printf("perimeter entries: %d\n", perimeter_entries);
+		print_request_stats(h);
+	}
 
 	if (solved)
 	{
@@ -315,10 +319,10 @@ void FESS(board b, int time_allocation, int search_mode, tree *t, helper *h)
 		{
 			printf("solved. %d positions\n", search_pos_num);
 			if (cores_num > 1)
-				printf("solved by core %d at time %d\n", h->my_core,(int)time(0) - start_time);
+				printf("solved by core %d at time %d ms\n", h->my_core, get_elapsed_ms(current_level->start_ms));
 		}
 		store_solution_in_helper(t, new_node, h);
-		any_core_solved = 1;
+		ATOMIC_STORE_RELEASE(&current_level->any_core_solved, 1);
 	}
 
 	if (solved == 0)
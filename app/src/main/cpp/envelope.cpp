@@ -2,6 +2,7 @@
 // Copyright 2018-2020 Yaron Shoham
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 
 #include "envelope.h"
@@ -13,16 +14,25 @@
 
 #define MAX_ENVELOPE_PATTERNS 50
 
-int   new_envelope_patterns_num;
-board new_envelope_patterns[MAX_ENVELOPE_PATTERNS];
+typedef struct envelope_data
+{
+	int   patterns_num;
+	board patterns[MAX_ENVELOPE_PATTERNS];
+} envelope_data;
+
+void allocate_envelope_data(level_context *l)
+{
+	l->envelope = (envelope_data*)calloc(1, sizeof(envelope_data));
+	if (l->envelope == 0) exit_with_error("can't allocate envelope patterns\n");
+}
 
 int size_of_corral(int_board corrals, int corral_index)
 {
 	int sum = 0;
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (corrals[i][j] == corral_index)
 				sum++;
 	return sum;
@@ -32,10 +42,10 @@ int size_of_corral(int_board corrals, int corral_index)
 void wallify_boxes_using_pattern(board b, int pat_num)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (new_envelope_patterns[pat_num][i][j] & BOX)
+			if (current_level->envelope->patterns[pat_num][i][j] & BOX)
 				b[i][j] = WALL;
 		}
 }
@@ -46,16 +56,16 @@ int matches_envelope_pattern(board b, int n)
 	int i, j;
 
 	// check that all pattern boxes are in place
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (new_envelope_patterns[n][i][j] & BOX)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->envelope->patterns[n][i][j] & BOX)
 				if ((b[i][j] & OCCUPIED) == 0) // a wall is as good as box
 					return 0;
 
 	// make sure the sokoban is not in the corral
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if ((new_envelope_patterns[n][i][j] & SOKOBAN) == 0)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if ((current_level->envelope->patterns[n][i][j] & SOKOBAN) == 0)
 				if (b[i][j] & SOKOBAN)
 					return 0;
 
@@ -66,7 +76,7 @@ void fix_boxes_using_envelopes(board b)
 {
 	int i;
 
-	for (i = 0; i < new_envelope_patterns_num; i++)
+	for (i = 0; i < current_level->envelope->patterns_num; i++)
 	{
 		if (matches_envelope_pattern(b, i) == 0) continue;
 
@@ -80,7 +90,7 @@ void fix_boxes_using_envelopes(board b)
 int already_in_envelopes(board b)
 {
 	int i;
-	for (i = 0; i < new_envelope_patterns_num; i++)
+	for (i = 0; i < current_level->envelope->patterns_num; i++)
 		if (matches_envelope_pattern(b, i))
 			return 1;
 	return 0;
@@ -95,13 +105,13 @@ void get_envelope_boxes(int_board corrals, int corral_index,
 	board b;
 	int i, j,k,y,x;
 
-	clear_boxes(initial_board, b);
+	clear_boxes(current_level->initial_board, b);
 
 	// collect regular boxes
 	*regular_boxes_num = 0;
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (corrals[i][j] != corral_index) continue;
 
@@ -122,9 +132,9 @@ void get_envelope_boxes(int_board corrals, int corral_index,
 
 	// collect diagonal boxes
 	*diag_boxes_num = 0;
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (corrals[i][j] != corral_index) continue;
 
@@ -162,7 +172,7 @@ void set_up_corral(int *regular_boxes, int regular_boxes_num,
 {
 	int i, y, x;
 
-	clear_boxes(initial_board, b);
+	clear_boxes(current_level->initial_board, b);
 	clear_sokoban_inplace(b);
 
 	for (i = 0; i < regular_boxes_num; i++)
@@ -187,10 +197,10 @@ void put_sokoban_out_of_corral(board b, int_board corrals, int corral_index)
 
 	clear_sokoban_inplace(b);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if (corrals[i][j] == corral_index) continue;
 			if (b[i][j] & OCCUPIED) continue;
 			b[i][j] |= SOKOBAN;
@@ -210,8 +220,8 @@ int can_solve_from_any_zone(int_board corrals, int corral_index, board b_in)
 
 	zones_num = mark_connectivities(b, zones);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (corrals[i][j] == corral_index)
 				corral_zone = zones[i][j];
 
@@ -238,9 +248,7 @@ int can_solve_from_any_zone(int_board corrals, int corral_index, board b_in)
 
 int should_abort_envelopes()
 {
-	int t;
-	t = (int)time(0) - start_time;
-	if (t > (time_limit / 2))
+	if (get_elapsed_ms(current_level->start_ms) > (time_limit_ms / 2))
 	{
 		if (verbose >= 4)
 			printf("aborted envelopes\n");
@@ -273,7 +281,7 @@ void analyse_envelope(int_board corrals, int corral_index,
 //			printf("checking:\n");
 //			print_board(b);
 
-			if (boxes_in_level(b) == global_boxes_in_level) continue; // position is solved
+			if (boxes_in_level(b) == current_level->boxes_in_level) continue; // position is solved
 
 			if (already_in_envelopes(b))
 				continue;
@@ -283,15 +291,15 @@ void analyse_envelope(int_board corrals, int corral_index,
 
 
 //			printf("adding envelope!\n");
-			copy_board(b, new_envelope_patterns[new_envelope_patterns_num]);
-			new_envelope_patterns_num++;
+			copy_board(b, current_level->envelope->patterns[current_level->envelope->patterns_num]);
+			current_level->envelope->patterns_num++;
 
-			if (new_envelope_patterns_num >= MAX_ENVELOPE_PATTERNS)
+			if (current_level->envelope->patterns_num >= MAX_ENVELOPE_PATTERNS)
 			{
 				if (verbose >= 4)
 					exit_with_error("Too many envelopes!");
 				else
-					new_envelope_patterns_num--;
+					current_level->envelope->patterns_num--;
 			}
 
 //				my_getch();
@@ -311,9 +319,9 @@ void init_envelope_patterns()
 	int diag_boxes[MAX_INNER];
 	int regular_boxes_num, diag_boxes_num;
 
-	new_envelope_patterns_num = 0;
+	current_level->envelope->patterns_num = 0;
 
-	copy_board(initial_board, b);
+	copy_board(current_level->initial_board, b);
 	enter_reverse_mode(b, 0); // 0 : don't mark bases
 
 	n = mark_connectivities(b, corrals);
@@ -327,7 +335,7 @@ void init_envelope_patterns()
 		get_envelope_boxes(corrals, i,
 							regular_boxes, &regular_boxes_num, diag_boxes, &diag_boxes_num);
 
-		if (size_of_corral(corrals, i) > (index_num / 2)) continue;
+		if (size_of_corral(corrals, i) > (current_level->index_num / 2)) continue;
 
 		analyse_envelope(corrals, i,
 			regular_boxes, regular_boxes_num, diag_boxes, diag_boxes_num);
@@ -1,4 +1,5 @@
 #include "board.h"
 
+void allocate_envelope_data(level_context *l);
 void init_envelope_patterns();
 void fix_boxes_using_envelopes(board b);
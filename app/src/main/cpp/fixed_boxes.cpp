@@ -20,8 +20,8 @@ int turn_2x2_to_walls(board b)
 	int sum;
 	int changed = 0;
 
-	for (i = 0; i < (height - 1); i++)
-	for (j = 0; j < (width - 1); j++)
+	for (i = 0; i < (current_level->height - 1); i++)
+	for (j = 0; j < (current_level->width - 1); j++)
 	{
 		sum = 0;
 
@@ -48,9 +48,9 @@ int close_holes(board b)
 {
 	int i, j, k;
 
-	for (i = 1; i < (height - 1); i++)
+	for (i = 1; i < (current_level->height - 1); i++)
 	{
-		for (j = 1; j < (width - 1); j++)
+		for (j = 1; j < (current_level->width - 1); j++)
 		{
 			if (b[i][j] == SPACE)
 			{
@@ -105,9 +105,9 @@ void remove_all_pushable_boxes(board b)
 	{
 		changed = 0;
 
-		for (i = 0; i < height; i++)
+		for (i = 0; i < current_level->height; i++)
 		{
-			for (j = 0; j < width; j++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if ((b[i][j] & BOX) == 0) continue;
 
@@ -152,9 +152,9 @@ int fix_crystaline(board b_in)
 	do
 	{
 		removed_box = 0;
-		for (i = 0; i < height; i++)
+		for (i = 0; i < current_level->height; i++)
 		{
-			for (j = 0; j < width; j++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if (b[i][j] != PACKED_BOX) continue;
 
@@ -172,16 +172,16 @@ int fix_crystaline(board b_in)
 	}
 	while (removed_box);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				if (b_in[i][j] & BOX)
 					fixed_box = 1;
 
 	if (fixed_box)
 	{
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 				if (b[i][j] & BOX)
 					if (b_in[i][j] & BOX)
 						b_in[i][j] = WALL;
@@ -200,8 +200,8 @@ int turn_immovable_boxes_to_walls(board b)
 	copy_board(b, remaining);
 	remove_all_pushable_boxes(remaining);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (remaining[i][j] & BOX)
 			{
 				b[i][j] = WALL;
@@ -219,8 +219,8 @@ int fix_diagonals(board w)
 
 	mark_diags(w, diag_right, diag_left);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (diag_right[i][j])
 				if (diag_has_no_targets(w, i, j, diag_right[i][j], 1))
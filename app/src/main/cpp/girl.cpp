@@ -1,6 +1,7 @@
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "girl.h"
 #include "util.h"
@@ -12,29 +13,38 @@
 #include "tree.h"
 #include "distance.h"
 
-int_board girl_distance;
-int max_push_dist;
+typedef struct girl_data
+{
+	int_board girl_distance;
+	int max_push_dist;
 
-double gamma_table[MAX_BOXES + 1];
-double inv_n_boxes;
-double dist_normalizer;
+	double gamma_table[MAX_BOXES + 1];
+	double inv_n_boxes;
+	double dist_normalizer;
+} girl_data;
+
+void allocate_girl_data(level_context *l)
+{
+	l->girl = (girl_data*)calloc(1, sizeof(girl_data));
+	if (l->girl == 0) exit_with_error("can't allocate girl data\n");
+}
 
 void init_girl_distance(board b)
 {
 	int i, j;
-	get_distance_from_targets(b, girl_distance);
+	get_distance_from_targets(b, current_level->girl->girl_distance);
 
 	if (verbose >= 5)
-		show_ints_on_initial_board(girl_distance);
+		show_ints_on_initial_board(current_level->girl->girl_distance);
 
 	// init max_push_dist:
-	max_push_dist = 0;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	current_level->girl->max_push_dist = 0;
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (girl_distance[i][j] == 1000000) continue;
-			if (girl_distance[i][j] > max_push_dist)
-				max_push_dist = girl_distance[i][j];
+			if (current_level->girl->girl_distance[i][j] == 1000000) continue;
+			if (current_level->girl->girl_distance[i][j] > current_level->girl->max_push_dist)
+				current_level->girl->max_push_dist = current_level->girl->girl_distance[i][j];
 		}
 }
 
@@ -43,10 +53,10 @@ int get_girl_distance(board b)
 	int sum = 0;
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
-				sum += girl_distance[i][j];
+				sum += current_level->girl->girl_distance[i][j];
 	return sum;
 }
 
@@ -55,8 +65,8 @@ void init_gamma_table()
 	int i;
 	double gamma_val = 0.95;
 
-	for (i = 0; i <= global_boxes_in_level; i++)
-		gamma_table[i] = pow(gamma_val, i);
+	for (i = 0; i <= current_level->boxes_in_level; i++)
+		current_level->girl->gamma_table[i] = pow(gamma_val, i);
 }
 
 void init_girl_variables(board b)
@@ -64,10 +74,8 @@ void init_girl_variables(board b)
 	init_girl_distance(b);
 	init_gamma_table();	
 	
-	inv_n_boxes = 1 / (double)global_boxes_in_level;
-	dist_normalizer = 1 / (double)(global_boxes_in_level * max_push_dist);
-
-	set_inv_epsilon();
+	current_level->girl->inv_n_boxes = 1 / (double)current_level->boxes_in_level;
+	current_level->girl->dist_normalizer = 1 / (double)(current_level->boxes_in_level * current_level->girl->max_push_dist);
 }
 
 
@@ -84,22 +92,22 @@ int prepare_vector_of_basic_features(score_element *s, int pull_mode, double *fe
 
 	if (pull_mode == 0)
 	{
-		features[n++] = packed * inv_n_boxes;
-		features[n++] = tgt * inv_n_boxes;
-		features[n++] = connectivity * inv_n_boxes;
-		features[n++] = dist * dist_normalizer;
-		features[n++] = overlap * inv_n_boxes;
-		features[n++] = gamma_table[global_boxes_in_level - tgt];
-		features[n++] = gamma_table[global_boxes_in_level];
+		features[n++] = packed * current_level->girl->inv_n_boxes;
+		features[n++] = tgt * current_level->girl->inv_n_boxes;
+		features[n++] = connectivity * current_level->girl->inv_n_boxes;
+		features[n++] = dist * current_level->girl->dist_normalizer;
+		features[n++] = overlap * current_level->girl->inv_n_boxes;
+		features[n++] = current_level->girl->gamma_table[current_level->boxes_in_level - tgt];
+		features[n++] = current_level->girl->gamma_table[current_level->boxes_in_level];
 		features[n++] = 1;
 		return n;
 	}
 
-	features[n++] = tgt * inv_n_boxes;
-	features[n++] = connectivity * inv_n_boxes;
-	features[n++] = dist * dist_normalizer;
-	features[n++] = gamma_table[tgt];
-	features[n++] = gamma_table[global_boxes_in_level];
+	features[n++] = tgt * current_level->girl->inv_n_boxes;
+	features[n++] = connectivity * current_level->girl->inv_n_boxes;
+	features[n++] = dist * current_level->girl->dist_normalizer;
+	features[n++] = current_level->girl->gamma_table[tgt];
+	features[n++] = current_level->girl->gamma_table[current_level->boxes_in_level];
 	features[n++] = 1;
 	return n;
 }
@@ -200,7 +208,7 @@ expansion_data* find_best_RL_parking_node(tree *t)
 	expansion_data *e;
 	double dist;
 
-	max_allowed_depth = MAX_SOL_LEN - global_boxes_in_level;
+	max_allowed_depth = MAX_SOL_LEN - current_level->boxes_in_level;
 
 	for (i = 0; i < t->expansions_num; i++)
 	{
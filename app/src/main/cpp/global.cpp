@@ -9,10 +9,7 @@
 
 char solver_name[100] = "Festival 3.1";
 
-int time_limit = 600;
-
-int height;
-int width;
+int time_limit_ms = 600000;
 
 int verbose = 3;
 
@@ -23,16 +20,8 @@ int delta_y_8[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
 int delta_x_8[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
 
 
-int level_id = 0;
-char level_title[1000];
-
-int global_initial_sokoban_y, global_initial_sokoban_x;
-int global_boxes_in_level;
-
 int cores_num = -1;
 
-int any_core_solved;
-
 #ifdef VISUAL_STUDIO
 char global_dir[1000] = "c:\\sokoban";
 #else
@@ -40,13 +29,15 @@ char global_dir[1000] = ".";
 #endif
 
 char global_output_filename[1000] = "";
+
+char knowledge_dir[1000] = ""; // empty: knowledge is not saved
 int YASC_mode = 0;
 int save_best_flag = 0;
 int extra_mem = 0;
-
-char global_fail_reason[50];
-
-int start_time, end_time;
+int adaptive_deadlocks = 0; // reorder the deadlock detectors by their measured cost
+int spec_threads = 0; // helper threads that check the sons of new expansions for deadlocks
+int deadlock_cache_mb = 0; // 0 = sized by extra_mem and the number of cores
+UINT_64 memory_budget = 0; // bytes for all the tables. 0 = sized by extra_mem and the number of cores
 
 int just_one_level    = -1;
 int global_from_level = -1;
@@ -22,9 +22,6 @@
 #define PACKED_BOX (BOX | TARGET)
 #define SOKOBAN_ON_TARGET (SOKOBAN | TARGET)
 
-extern int height;
-extern int width;
-
 #define MAX_INNER (MAX_SIZE*MAX_SIZE)
 #define MAX_ROOMS 70
 
@@ -61,33 +58,30 @@ extern int delta_y_8[8];
 extern int delta_x_8[8];
 
 extern int verbose;
-extern int level_id;
-extern char level_title[1000];
-
-extern int global_initial_sokoban_y, global_initial_sokoban_x;
-extern int global_boxes_in_level;
 
 extern char global_dir[1000];
 extern char global_level_set_name[1000];
+extern char knowledge_dir[1000];
 
 extern char global_output_filename[1000];
 extern int YASC_mode;
 extern int save_best_flag;
 extern int extra_mem;
+extern int adaptive_deadlocks;
+extern int spec_threads;
+extern int deadlock_cache_mb;
+extern UINT_64 memory_budget;
 
 
 extern int just_one_level;
 extern int global_from_level;
 extern int global_to_level;
 
-extern int start_time, end_time , time_limit;
-
-extern char global_fail_reason[50];
+extern int time_limit_ms;
 
 extern char solver_name[100];
 
 extern int cores_num;
-extern int any_core_solved;
 
 typedef unsigned char board[MAX_SIZE][MAX_SIZE];
 typedef int int_board[MAX_SIZE][MAX_SIZE];
@@ -97,5 +91,34 @@ typedef int box_mat[MAX_BOXES][MAX_BOXES];
 #define VISUAL_STUDIO
 #endif
 
+#ifdef VISUAL_STUDIO
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// atomic operations for the tables that are shared by the search threads.
+// ATOMIC_CAS returns nonzero if *p was "old" and was replaced by "val".
+// A table that only grows publishes its size with ATOMIC_STORE_RELEASE after the new entry is
+// written, and readers take the size with ATOMIC_LOAD_ACQUIRE.
+#ifdef VISUAL_STUDIO
+#include <intrin.h>
+#define ATOMIC_CAS_64(p, old, val) (_InterlockedCompareExchange64((volatile long long*)(p), (long long)(val), (long long)(old)) == (long long)(old))
+#define ATOMIC_CAS_32(p, old, val) (_InterlockedCompareExchange((volatile long*)(p), (long)(val), (long)(old)) == (long)(old))
+#define ATOMIC_ADD(p, val) _InterlockedExchangeAdd((volatile long*)(p), (long)(val))
+#define ATOMIC_ADD_64(p, val) _InterlockedExchangeAdd64((volatile long long*)(p), (long long)(val))
+#define ATOMIC_LOAD_ACQUIRE(p) (*(volatile long*)(p))
+#define ATOMIC_STORE_RELEASE(p, val) (*(volatile long*)(p) = (long)(val))
+#else
+#define ATOMIC_CAS_64(p, old, val) __sync_bool_compare_and_swap((p), (old), (val))
+#define ATOMIC_CAS_32(p, old, val) __sync_bool_compare_and_swap((p), (old), (val))
+#define ATOMIC_ADD(p, val) __sync_fetch_and_add((p), (val))
+#define ATOMIC_ADD_64(p, val) __sync_fetch_and_add((p), (val))
+#define ATOMIC_LOAD_ACQUIRE(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ATOMIC_STORE_RELEASE(p, val) __atomic_store_n((p), (val), __ATOMIC_RELEASE)
+#endif
+
+#include "level.h"
+
 
 #endif
\ No newline at end of file
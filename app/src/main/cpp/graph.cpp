@@ -9,19 +9,25 @@
 #include "distance.h"
 #include "util.h"
 #include "deadlock.h"
+#include "scratch.h"
 
 graph_data *allocate_graph()
 {
 	graph_data *gd;
+	int vertices_num = current_level->index_num * 4;
 
-	gd = (graph_data*)malloc(sizeof(graph_data));
-	if (gd == 0)
-		exit_with_error("can't allocate graph");
+	gd = (graph_data*)get_scratch(SCRATCH_GRAPH, sizeof(graph_data) + sizeof(vertex) * vertices_num);
 
-	gd->vertices_num = index_num * 4;
+	gd->vertices_num = vertices_num;
+	gd->vertices = (vertex*)(gd + 1);
 	return gd;
 }
 
+void free_graph(graph_data *gd)
+{
+	release_scratch(SCRATCH_GRAPH, gd);
+}
+
 void init_active(board b, graph_data *gd)
 {
 	int i, j;
@@ -31,11 +37,11 @@ void init_active(board b, graph_data *gd)
 
 	// "active" tests if sokoban can be positioned in this side of the box
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 		for (j = 0; j < 4; j++)
 			vertices[i * 4 + j].active = 0;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &base_y, &base_x);
 
@@ -79,11 +85,11 @@ void make_holes_inactive(board b, graph_data *gd)
 
 	vertex *vertices = gd->vertices;
 
-	for (y = 0; y < height; y++)
+	for (y = 0; y < current_level->height; y++)
 	{
-		for (x = 0; x < width; x++)
+		for (x = 0; x < current_level->width; x++)
 		{
-			if (inner[y][x] == 0) continue;
+			if (current_level->inner[y][x] == 0) continue;
 			if (b[y][x] & OCCUPIED) continue;
 
 			sum = 0;
@@ -99,7 +105,7 @@ void make_holes_inactive(board b, graph_data *gd)
 				box_x = x + delta_x[i];
 				if (b[box_y][box_x] == WALL) continue;
 
-				if (inner[box_y][box_x] == 0) continue;
+				if (current_level->inner[box_y][box_x] == 0) continue;
 
 				index = y_x_to_index(box_y, box_x) * 4;
 
@@ -129,7 +135,7 @@ void init_shift(board b, graph_data *gd)
 		for (j = 0; j < 4; j++)
 			vertices[i].shift[j] = 0;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 
@@ -262,7 +268,7 @@ void build_graph(board b, int pull_mode, graph_data *gd)
 	vertex *vertices = gd->vertices;
 	int vertices_num = gd->vertices_num;
 
-	vertices_num = index_num * 4;
+	vertices_num = current_level->index_num * 4;
 
 	if (board_contains_boxes(b)) exit_with_error("boxes in board");
 	
@@ -375,6 +381,81 @@ void do_graph_iterations(int pull_mode, graph_data *gd)
 
 
 
+int get_graph_deque_size(graph_data *gd)
+{
+	// a vertex is improved at most twice in a 0-1 BFS, so half the deque is enough for each side
+	return gd->vertices_num * 8;
+}
+
+void compute_graph_distances(int index, int pull_mode, graph_data *gd, int *weights, int *deque)
+{
+	// Exact 0-1 BFS from the vertices around "index": shifts cost 0 and push/pull cost 1.
+	// Unlike do_graph_iterations, the graph is only read, so threads can share it.
+	// "weights" and "deque" are buffers of gd->vertices_num and get_graph_deque_size() entries.
+
+	int i, j, v, next_vertex;
+	int head, tail;
+
+	vertex *vertices = gd->vertices;
+	int vertices_num = gd->vertices_num;
+
+	for (i = 0; i < vertices_num; i++)
+		weights[i] = 1000000;
+
+	head = tail = vertices_num * 4;
+
+	for (j = 0; j < 4; j++)
+	{
+		v = index * 4 + j;
+		if (vertices[v].active == 0) continue;
+		weights[v] = 0;
+		deque[tail++] = v;
+	}
+
+	while (head < tail)
+	{
+		v = deque[head++];
+
+		for (j = 0; j < 4; j++)
+		{
+			next_vertex = vertices[v].shift[j];
+			if (next_vertex == 0) continue;
+			if (weights[next_vertex] <= weights[v]) continue;
+
+			weights[next_vertex] = weights[v];
+			deque[--head] = next_vertex;
+		}
+
+		if (pull_mode)
+			next_vertex = vertices[v].pull;
+		else
+			next_vertex = vertices[v].push;
+
+		if (next_vertex == 0) continue;
+		if (weights[next_vertex] <= weights[v] + 1) continue;
+
+		weights[next_vertex] = weights[v] + 1;
+		deque[tail++] = next_vertex;
+	}
+}
+
+int get_cell_weight(int index, graph_data *gd, int *weights)
+{
+	int j;
+	int min = 1000000;
+
+	for (j = 0; j < 4; j++)
+	{
+		if (gd->vertices[index * 4 + j].active == 0) continue;
+
+		if (weights[index * 4 + j] < min)
+			min = weights[index * 4 + j];
+	}
+	return min;
+}
+
+
+
 void mark_reversible_nodes(int pull_mode, graph_data *gd)
 {
 	// this routine marks all vertices from which the initial set can be reached.
@@ -421,7 +502,7 @@ int get_box_moves_from_graph(int start_index, move *moves, graph_data *gd)
 
 	vertex *vertices = gd->vertices;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 
@@ -475,7 +556,7 @@ int find_sources_of_a_group(board b, int *group, int group_size, board res)
 
 	do_graph_iterations(1, gd);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		cond1 = get_weight_around_cell(i, gd) != 1000000;
 		cond2 = in_group(i, group, group_size);
@@ -492,7 +573,7 @@ int find_sources_of_a_group(board b, int *group, int group_size, board res)
 		res[y][x] = 1;
 	}
 
-	free(gd);
+	free_graph(gd);
 
 	return n;
 }
@@ -512,7 +593,7 @@ int find_targets_of_a_group(board b, int *group, int group_size, board targets)
 
 	do_graph_iterations(0, gd); // 0 - push mode
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		if ((get_weight_around_cell(i, gd) != 1000000) ||
 			in_group(i, group, group_size))
@@ -526,7 +607,7 @@ int find_targets_of_a_group(board b, int *group, int group_size, board targets)
 		targets[y][x] = 1;
 	}
 
-	free(gd);
+	free_graph(gd);
 	return n;
 }
 
@@ -536,10 +617,10 @@ void find_targets_of_a_board_input(board b, board in, board targets)
 	int group_size = 0;
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 
 			if (in[i][j])
 				group[group_size++] = y_x_to_index(i, j);
@@ -555,9 +636,9 @@ void find_sources_of_a_board_input(board b, board in, board sources)
 	int group_size = 0;
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (in[i][j])
 				group[group_size++] = y_x_to_index(i, j);
@@ -596,7 +677,7 @@ void find_distance_from_a_group(board b, board group, int_board dist, int pull_m
 
 	build_graph(b, pull_mode, gd); 
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 		if (group[y][x])
@@ -605,17 +686,17 @@ void find_distance_from_a_group(board b, board group, int_board dist, int pull_m
 
 	do_graph_iterations(pull_mode, gd); 
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			dist[i][j] = 1000000;
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 		dist[y][x] = get_weight_around_cell(i, gd);
 	}
 
-	free(gd);
+	free_graph(gd);
 }
 
 
@@ -625,7 +706,7 @@ void clear_shift(graph_data *gd)
 	vertex *vertices = gd->vertices;
 	int vertices_num = gd->vertices_num;
 
-	for (i = 0; i < (index_num * 4); i++)
+	for (i = 0; i < (current_level->index_num * 4); i++)
 		for (j = 0; j < 4; j++)
 			vertices[i].shift[j] = 0;
 }
@@ -935,11 +1016,11 @@ void set_current_impossible(board b_in, int box_y, int box_x, int pull_mode, int
 
 	zero_board(gd->current_impossible_board);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 
-		if (impossible_place[i]) // general impossible places of the level. board edges etc.
+		if (current_level->impossible_place[i]) // general impossible places of the level. board edges etc.
 			(gd->current_impossible_board)[y][x] = 1;
 
 		// add boxes that were wallified
@@ -953,10 +1034,10 @@ void set_current_impossible(board b_in, int box_y, int box_x, int pull_mode, int
 
 		mark_deadlock_2x2(b, blocked);
 
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
-				if (inner[i][j] == 0) continue;
+				if (current_level->inner[i][j] == 0) continue;
 
 				if (blocked[i][j])
 					(gd->current_impossible_board)[i][j] = 1;
@@ -964,10 +1045,10 @@ void set_current_impossible(board b_in, int box_y, int box_x, int pull_mode, int
 	}
 
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 
 			if (possible_board[i][j] == 0)
 				(gd->current_impossible_board)[i][j] = 1;
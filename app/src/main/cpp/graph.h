@@ -21,7 +21,7 @@ typedef struct vertex
 typedef struct graph_data
 {
 	int vertices_num;
-	vertex vertices[MAX_INNER * 4];
+	vertex *vertices; // vertices_num entries, allocated after the struct
 
 	board current_impossible_board;
 } graph_data;
@@ -31,11 +31,15 @@ typedef struct graph_data
 // shift,push,pull is in the index to which we move by applying this operation.
 
 graph_data *allocate_graph();
+void free_graph(graph_data *gd);
 void build_graph(board b, int pull_mode, graph_data *gd);
 void set_graph_weights_to_infinity(graph_data *gd);
 void clear_weight_around_cell(int index, graph_data *gd);
 void do_graph_iterations(int pull_mode, graph_data *gd);
 int get_weight_around_cell(int index, graph_data *gd);
+int get_graph_deque_size(graph_data *gd);
+void compute_graph_distances(int index, int pull_mode, graph_data *gd, int *weights, int *deque);
+int get_cell_weight(int index, graph_data *gd, int *weights);
 int get_box_moves_from_graph(int start_index, move *moves, graph_data *gd);
 int find_sources_of_a_group(board b, int *group, int group_size, board res);
 int find_targets_of_a_group(board b, int *group, int group_size, board targets);
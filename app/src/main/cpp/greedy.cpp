@@ -6,14 +6,8 @@
 #include "tree.h"
 #include "debug.h"
 
-int inv_epsilon = 20;
-
 int debug_greedy = 0;
 
-void set_inv_epsilon()
-{
-	inv_epsilon = global_boxes_in_level + 1;
-}
 
 expansion_data *go_to_root_greedy_tree(tree *t)
 {
@@ -134,6 +128,7 @@ int choose_best_value_son_tree(tree *t, expansion_data *e, helper *h)
 int pick_son_Epsilon_greedy_tree(tree *t, expansion_data *e, helper *h)
 {
 	int son;
+	int inv_epsilon = current_level->boxes_in_level + 1;
 
 	if (e->node->deadlocked)
 		exit_with_error("epsilon deadlocked");
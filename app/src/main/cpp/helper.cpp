@@ -2,6 +2,7 @@
 
 #include "helper.h"
 #include "util.h"
+#include "request.h"
 
 void reset_helper(helper *h)
 {
@@ -29,18 +30,24 @@ void init_helper(helper *h)
 
 void init_helper_extra_fields(helper *h)
 {
-	h->oop = (oop_data*)malloc(sizeof(oop_data));
+	// the oop and imagine arrays are allocated when a plan is set
+	h->oop = (oop_data*)calloc(1, sizeof(oop_data));
 	if (h->oop == 0) exit_with_error("can't alloc oop");
-	h->imagine = (imagine_data*)malloc(sizeof(imagine_data));
+	h->imagine = (imagine_data*)calloc(1, sizeof(imagine_data));
 	if (h->imagine == 0) exit_with_error("can't alloc imagine");
-	h->request = (request_data*)malloc(sizeof(request_data));
+	h->request = (request_data*)calloc(1, sizeof(request_data));
 	if (h->request == 0) exit_with_error("can't alloc request");
 
 }
 
 void free_helper(helper *h)
 {
+	free(h->oop->zone);
+	free(h->oop->distance);
 	free(h->oop);
+	free(h->imagine->boxes);
+	free(h->imagine->fixed);
+	free(h->imagine->packed_num);
 	free(h->imagine);
-	free(h->request);
+	free_request_data(h->request);
 }
@@ -30,18 +30,25 @@ typedef struct park_order_data
 	int until;
 } park_order_data;
 
+// The plan structures are sized when the plan is built, and keep one entry per inner square
+// for each step: entry [step * index_num + index].
+
 typedef struct
 {
-	board oop_zone_for_step[MAX_SOL_LEN];
-	int_board oop_zone_distance_for_step[MAX_SOL_LEN];
+	UINT_8 *zone; // 1 if a box there is out of plan
+	int *distance; // from the oop zone
+	int steps_num;
+	int index_num;
 } oop_data;
 
 
 typedef struct
 {
-	board imagined_boards[MAX_SOL_LEN];
-	int imagine_packed_num[MAX_SOL_LEN];
-	board fixed_at_step[MAX_SOL_LEN];
+	UINT_8 *boxes; // the boxes of each imagined board
+	UINT_8 *fixed; // boxes that are already packed
+	int *packed_num;
+	int max_boards;
+	int index_num;
 
 	int imagined_boards_num;
 
@@ -65,17 +72,28 @@ typedef struct request
 	int imagine;
 } request;
 
-#define MAX_REQUESTS 10000
+// the feature-space cells of FESS. The arrays grow as needed, and each has a hash index
+// (open addressing, -1 = free) from the cell's features to its position in the array.
 
 typedef struct request_data
 {
-	pack_request pack_requests[MAX_REQUESTS];
+	pack_request *pack_requests;
 	int pack_requests_num;
 	int pack_requests_pos;
+	int max_pack_requests;
+	int *pack_index;
+	int pack_index_size;
 
-	request requests[MAX_REQUESTS];
+	request *requests;
 	int requests_num;
 	int requests_pos;
+	int max_requests;
+	int *index;
+	int index_size;
+
+	// lookup statistics. The time is measured only when verbose >= 4
+	UINT_64 lookups;
+	UINT_64 lookup_time; // microseconds
 } request_data;
 
 
@@ -86,7 +104,7 @@ typedef struct request_data
 
 
 
-typedef struct
+typedef struct helper
 {
 	// park order
 	park_order_data parking_order[MAX_SOL_LEN];
@@ -23,16 +23,14 @@ int boxes_in_different_rooms(int index1, int index2)
 	int index2_has_room = 0;
 	int r1, r2;
 
-	extern board room_with_corridors[MAX_ROOMS];
-
-	if (bfs_distance_from_to[index1][index2] >= BIG_DISTANCE)
+	if (get_bfs_distance(index1, index2) >= BIG_DISTANCE)
 		return 1;
 
 	index_to_y_x(index1, &box1_y, &box1_x);
 	index_to_y_x(index2, &box2_y, &box2_x);
 
-	r1 = rooms_board[box1_y][box1_x];
-	r2 = rooms_board[box2_y][box2_x];
+	r1 = current_level->rooms_board[box1_y][box1_x];
+	r2 = current_level->rooms_board[box2_y][box2_x];
 
 	if ((r1 != 1000000) && (r2 != 1000000))
 		if (r1 != r2)
@@ -41,11 +39,11 @@ int boxes_in_different_rooms(int index1, int index2)
 	if (r1 != r2)
 	{
 		if (r1 != 1000000)
-			if (room_with_corridors[r1][box2_y][box2_x])
+			if (is_in_room_with_corridor(r1, box2_y, box2_x))
 				return 0;
 
 		if (r2 != 1000000)
-			if (room_with_corridors[r2][box1_y][box1_x])
+			if (is_in_room_with_corridor(r2, box1_y, box1_x))
 				return 0;
 
 		if ((box1_y != box2_y) && (box1_x != box2_x))
@@ -62,20 +60,20 @@ void get_kill_zone(board bases, board kill_zone)
 	int bases_list_num = 0;
 	int i, j, y, x;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (bases[i][j])
 				bases_list[bases_list_num++] = y_x_to_index(i, j);
 
 	zero_board(kill_zone);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		// check if place i can be a kill square
 
 		for (j = 0; j < bases_list_num; j++)
 		{
-			if (bfs_distance_from_to[i][bases_list[j]] < BIG_DISTANCE)
+			if (get_bfs_distance(i, bases_list[j]) < BIG_DISTANCE)
 				break;
 		}
 
@@ -94,8 +92,8 @@ void get_bases_as_board(board b, board bases)
 {
 	int i, j;
 	zero_board(bases);
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BASE)
 				bases[i][j] = 1;
 }
@@ -110,7 +108,7 @@ void compute_possible_from_bases(board b, board possible_from_bases)
 	board bases;
 	board board_without_boxes;
 
-	clear_boxes(initial_board, board_without_boxes);
+	clear_boxes(current_level->initial_board, board_without_boxes);
 	get_bases_as_board(b, bases);
 	find_targets_of_a_board_input(board_without_boxes, bases, possible_from_bases);
 }
@@ -149,8 +147,8 @@ int test_base_matching(board b, int from, int to)
 int unreachable_area_contains_elim(board b, board elim)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (elim[i][j])
 				if ((b[i][j] & SOKOBAN) == 0)
@@ -179,8 +177,8 @@ void compute_bases_scc(board b_in, board scc_board)
 	copy_board(b_in, b);
 	turn_boxes_into_walls(b);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BASE)
 				bases[bases_num++] = y_x_to_index(i, j);
 
@@ -210,7 +208,7 @@ void compute_bases_scc(board b_in, board scc_board)
 				mat[i][j] = 1;
 		}
 	}
-	free(gd);
+	free_graph(gd);
 
 	for (i = 0; i < bases_num; i++)
 		if (mat[i][i] != 1)
@@ -335,7 +333,7 @@ int mark_sink_squares_moves(board b, move *moves, int moves_num)
 	// keep only eliminating moves. keep just one source 
 
 	int box_was_pulled[MAX_INNER];
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 		box_was_pulled[i] = 0;
 
 	for (i = 0; i < moves_num; i++)
@@ -466,8 +464,8 @@ int pick_pull_advisor_normal(board b_in, score_element *base_score,
 		current_pull.kill_zone = kill_zone[to_y][to_x];
 		current_pull.connectivity = scores[i].connectivity;
 		current_pull.room_connectivity = scores[i].rooms_score;
-		current_pull.pull_len = distance_from_to[moves[i].to][moves[i].from];
-		current_pull.target_hole = target_holes[from_y][from_x];
+		current_pull.pull_len = get_push_distance(moves[i].to, moves[i].from);
+		current_pull.target_hole = current_level->target_holes[from_y][from_x];
 
 		if (is_better_pull_candidate(&best_pull, &current_pull))
 		{
@@ -548,12 +546,12 @@ int find_best_base_pull(board b_in, score_element *base_score,
 		if (moves[i].base == 0) continue;
 
 		index_to_y_x(moves[i].from, &y, &x);
-		current_pull.hole = target_holes[y][x];
+		current_pull.hole = current_level->target_holes[y][x];
 
 		current_pull.connectivity = connectivity_after_move(b, moves + i);
 
 		index_to_y_x(moves[i].to, &y, &x);
-		current_pull.dist = bfs_distance_from_to[moves[i].to][moves[i].from];
+		current_pull.dist = get_bfs_distance(moves[i].to, moves[i].from);
 
 
 		if ((best_move == -1) || (is_better_base_prioirity(&current_pull, &best_pull)))
@@ -38,8 +38,8 @@ int hf_hotspots(board b, int pull_mode, helper* h)
 
 	if (pull_mode)
 	{
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if (b[i][j] & BOX)
 					if (can_be_accessed_from_some_direction(b, i, j) == 0)
@@ -49,8 +49,8 @@ int hf_hotspots(board b, int pull_mode, helper* h)
 	}
 
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) && ((h->imagined_hf_board[i][j] & BOX) == 0))
 			{
@@ -176,7 +176,7 @@ void set_rev_advisor(board b, score_element* base_score, int moves_num, move* mo
 		{
 			index_to_y_x(moves[i].to, &y, &x);
 
-			if (target_holes[y][x])
+			if (current_level->target_holes[y][x])
 			{
 				l->pack = i;
 				return;
@@ -201,7 +201,7 @@ void setup_rev_board(expansion_data *e, helper *h)
 	FILE* fp;
 	fp = fopen("c:\\sokoban\\rev.sok", "a");
 	board tt;
-	bytes_to_board(e->b, tt);
+	get_expansion_board(e, tt);
 	get_sokoban_position(tt, &i, &j);
 	clear_sokoban_inplace(tt);
 	tt[i][j] |= SOKOBAN;
@@ -210,7 +210,7 @@ void setup_rev_board(expansion_data *e, helper *h)
 	fclose(fp);
 */
 
-	bytes_to_board(e->b, h->imagined_hf_board);
+	get_expansion_board(e, h->imagined_hf_board);
 
 	if (verbose >= 4)
 	{
@@ -222,11 +222,11 @@ void setup_rev_board(expansion_data *e, helper *h)
 	turn_fixed_boxes_into_walls(h->imagined_hf_board, w);
 
 	zero_board(h->wallified);
-	for (i = 0 ; i < height ; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0 ; i < current_level->height ; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (w[i][j] == WALL)
-				if (inner[i][j])
+				if (current_level->inner[i][j])
 					h->wallified[i][j] = 1;
 		}
 
@@ -251,10 +251,10 @@ void set_rev_distance(tree *t, expansion_data* e, helper *h,
 		get_score_of_hash(t, mh[i].hash, scores + i);
 	}
 
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 
 	compute_rev_distance(b, &(e->node->score), e->moves_num, moves, scores,
-						h->imagined_hf_board, distance_from_to); // TODO: dist
+						h->imagined_hf_board); // TODO: dist
 
 	for (i = 0; i < e->moves_num; i++)
 	{
@@ -282,8 +282,8 @@ void get_rev_hotspots(board b, board hs)
 
 	int i, j, k;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 			{
 				if (b[i][j] & TARGET) continue; // no need to be pushed
@@ -310,11 +310,11 @@ int rev_hotspots_distance(board b, helper *h)
 	// no hotspots. With nothing better to do, push away from targets
 
 	// find BFS distance from hotspots
-	clear_boxes(initial_board, b2);
+	clear_boxes(current_level->initial_board, b2);
 	expand_group(b2, hs, dist);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				sum += dist[i][j];
 	return sum;
@@ -350,8 +350,8 @@ int compare_to_imagined_hf(board b, helper* h)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				if (h->imagined_hf_board[i][j] & BOX)
 					sum++;
@@ -370,11 +370,11 @@ int get_distance_in_hf_search(board b, score_element *s, helper *h)
 
 	get_untouched_areas(b, untouched);
 
-	clear_boxes(initial_board, tmp);
+	clear_boxes(current_level->initial_board, tmp);
 	expand_group(tmp, untouched, dist);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				sum += dist[i][j];
 	return sum;
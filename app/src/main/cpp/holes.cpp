@@ -1,9 +1,6 @@
 #include "holes.h"
 #include "util.h"
 
-board target_holes;
-board semi_holes;
-
 int is_square_a_target_hole(board b, int y, int x)
 {
 	int i;
@@ -20,12 +17,12 @@ int is_square_a_target_hole(board b, int y, int x)
 
 void mark_semi_holes(board b)
 {
-	zero_board(semi_holes);
+	zero_board(current_level->semi_holes);
 
 	int i, j, k, val1, val2;
 
-	for (i = 0 ; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0 ; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & TARGET)
 			{
@@ -35,7 +32,7 @@ void mark_semi_holes(board b)
 					val2 = b[i + delta_y[(k+1)&3]][j + delta_x[(k+1)&3]];
 
 					if ((val1 == WALL) && (val2 == WALL))
-						semi_holes[i][j] = 1;
+						current_level->semi_holes[i][j] = 1;
 				}
 			}
 		}
@@ -55,21 +52,21 @@ void mark_target_holes(board b_in)
 	clear_boxes_inplace(b);
 	clear_sokoban_inplace(b);
 
-	zero_board(target_holes);
+	zero_board(current_level->target_holes);
 
 	while (changed)
 	{
 		changed = 0;
 
-		for (i = 0; i < height; i++)
+		for (i = 0; i < current_level->height; i++)
 		{
-			for (j = 0; j < width; j++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if (is_square_a_target_hole(b, i, j))
 				{
 					b[i][j] = WALL;
 					changed = 1;
-					target_holes[i][j] = 1;
+					current_level->target_holes[i][j] = 1;
 				}
 			}
 		}
@@ -86,9 +83,9 @@ void turn_target_holes_into_walls(board b)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (target_holes[i][j])
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->target_holes[i][j])
 				b[i][j] = WALL;
 }
 
@@ -18,11 +18,20 @@ that would be blocked.
 */
 
 
-int targets_reachable_from[MAX_INNER];
-int blocks_place[MAX_INNER][MAX_INNER];
-// blocks_place[x][y] = number of targets reachable from x given a fixed y.
+typedef struct hotspot_data
+{
+	int targets_reachable_from[MAX_INNER];
+	int blocks_place[MAX_INNER][MAX_INNER];
+	// blocks_place[x][y] = number of targets reachable from x given a fixed y.
+
+	int completely_blocks[MAX_INNER][MAX_INNER];
+} hotspot_data;
 
-int completely_blocks[MAX_INNER][MAX_INNER];
+void allocate_hotspot_data(level_context *l)
+{
+	l->hotspot = (hotspot_data*)calloc(1, sizeof(hotspot_data));
+	if (l->hotspot == 0) exit_with_error("can't allocate hotspot data\n");
+}
 
 
 int hotspots_score(board b)
@@ -39,8 +48,8 @@ int count_targets_on_mask(board b, board mask)
 	int sum = 0;
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (mask[i][j])
 				if (b[i][j] & TARGET)
 					sum++;
@@ -51,21 +60,17 @@ void clear_hotspots_data()
 {
 	int i, j;
 
-	for (i = 0; i < index_num; i++)
-		for (j = 0; j < index_num; j++)
+	for (i = 0; i < current_level->index_num; i++)
+		for (j = 0; j < current_level->index_num; j++)
 		{
-			blocks_place[i][j] = 0;
-			completely_blocks[i][j] = 0;
+			current_level->hotspot->blocks_place[i][j] = 0;
+			current_level->hotspot->completely_blocks[i][j] = 0;
 		}
 }
 
 int hotspots_take_too_much_time()
 {
-	int t;
-
-	t = (int)time(0) - start_time;
-
-	if (t < (time_limit / 4))
+	if (get_elapsed_ms(current_level->start_ms) < (time_limit_ms / 4))
 		return 0;
 
 	clear_hotspots_data();
@@ -91,24 +96,24 @@ void init_hotspots(board b)
 	clear_boxes(b, empty);
 
 	build_graph(empty, 0, gd);
-	for (p = 0; p < index_num; p++)
+	for (p = 0; p < current_level->index_num; p++)
 	{
 		index_to_y_x(p, &y, &x);
 
 		find_targets_of_place_without_init_graph(y, x, targets, gd);
 
-		targets_reachable_from[p] = count_targets_on_mask(b, targets);
+		current_level->hotspot->targets_reachable_from[p] = count_targets_on_mask(b, targets);
 	}
 
-	for (blocker = 0; blocker < index_num; blocker++)
+	for (blocker = 0; blocker < current_level->index_num; blocker++)
 	{
 		if (hotspots_take_too_much_time())
 		{
-			free(gd);
+			free_graph(gd);
 			return; // abort hotspots calculation if it is too heavy
 		}
 
-		if (impossible_place[blocker])
+		if (current_level->impossible_place[blocker])
 			continue;
 
 		index_to_y_x(blocker, &blocker_y, &blocker_x);
@@ -122,9 +127,9 @@ void init_hotspots(board b)
 
 		build_graph(board_with_blocker, 0, gd);
 
-		for (p = 0; p < index_num; p++)
+		for (p = 0; p < current_level->index_num; p++)
 		{
-			if (impossible_place[p])
+			if (current_level->impossible_place[p])
 				continue;
 
 			if (p == blocker) continue;
@@ -136,24 +141,24 @@ void init_hotspots(board b)
 
 			find_targets_of_place_without_init_graph(y, x, targets, gd);
 
-			blocks_place[p][blocker] =  targets_reachable_from[p]; // how many targets without the blocker
+			current_level->hotspot->blocks_place[p][blocker] =  current_level->hotspot->targets_reachable_from[p]; // how many targets without the blocker
 			updated_targets = count_targets_on_mask(b, targets); // how many targets with the blocker
-			blocks_place[p][blocker] -= updated_targets;
+			current_level->hotspot->blocks_place[p][blocker] -= updated_targets;
 
 			if (updated_targets == 0)
-				completely_blocks[p][blocker] = 1;
+				current_level->hotspot->completely_blocks[p][blocker] = 1;
 
 		}
 	}
 
-	free(gd);
+	free_graph(gd);
 }
 
 
 int double_blocking(int index1, int index2)
 {
-	if (completely_blocks[index1][index2] == 0) return 0;
-	if (completely_blocks[index2][index1] == 0) return 0;
+	if (current_level->hotspot->completely_blocks[index1][index2] == 0) return 0;
+	if (current_level->hotspot->completely_blocks[index2][index1] == 0) return 0;
 	return 1;
 }
 
@@ -168,10 +173,10 @@ void find_hotspots(board b, board h, board hotspot_weights)
 	zero_board(h);
 	zero_board(hotspot_weights);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 
 			if (b[i][j] & BOX)
 				boxes_indices[boxes_num++] = y_x_to_index(i, j);
@@ -185,7 +190,7 @@ void find_hotspots(board b, board h, board hotspot_weights)
 			if (j == i)
 				continue;
 
-			if (blocks_place[boxes_indices[j]][boxes_indices[i]]) // i is blocking j
+			if (current_level->hotspot->blocks_place[boxes_indices[j]][boxes_indices[i]]) // i is blocking j
 //			if (completely_blocks[boxes_indices[j]][boxes_indices[i]]) // i is blocking j
 			{
 				index_to_y_x(boxes_indices[i], &y, &x);
@@ -3,6 +3,7 @@
 
 #include "board.h"
 
+void allocate_hotspot_data(level_context *l);
 void init_hotspots(board b);
 
 int hotspots_score(board b);
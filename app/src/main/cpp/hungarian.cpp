@@ -7,6 +7,7 @@
 #include "hungarian.h"
 #include "global.h"
 #include "util.h"
+#include "scratch.h"
 
 typedef struct
 {
@@ -34,12 +35,16 @@ typedef struct
 hungarian_cache *allocate_hungarian_cache()
 {
 	hungarian_cache *hc;
-	hc = (hungarian_cache*)malloc(sizeof(hungarian_cache));
-	if (hc == NULL) exit_with_error("can't alloc");
+	hc = (hungarian_cache*)get_scratch(SCRATCH_HUNGARIAN_CACHE, sizeof(hungarian_cache));
 	hc->prev_n = -1;
 	return hc;
 }
 
+void free_hungarian_cache(hungarian_cache *hc)
+{
+	release_scratch(SCRATCH_HUNGARIAN_CACHE, hc);
+}
+
 void set_hungarian_problem(int size, box_mat mat, hungarian_data *hd)
 {
 	int i, j, n;
@@ -554,8 +559,7 @@ void solve_hungarian(int n, box_mat cost, hungarian_solution *sol,	hungarian_cac
 
 	hungarian_data *hd;
 
-	hd = (hungarian_data*)malloc(sizeof(hungarian_data));
-	if (hd == NULL) exit_with_error("can't alloc");
+	hd = (hungarian_data*)get_scratch(SCRATCH_HUNGARIAN, sizeof(hungarian_data));
 
 	set_hungarian_problem(n, cost, hd);
 
@@ -571,7 +575,7 @@ void solve_hungarian(int n, box_mat cost, hungarian_solution *sol,	hungarian_cac
 		if (row == n) // same problem
 		{
 			*sol = hc->prev_sol;
-			free(hd);
+			release_scratch(SCRATCH_HUNGARIAN, hd);
 			return;
 		}
 		init_from_prev(row, hd, hc);
@@ -584,6 +588,6 @@ void solve_hungarian(int n, box_mat cost, hungarian_solution *sol,	hungarian_cac
 	if (one_row_changed == 0) // solved a new problem and not a variation
 		save_prev_data(sol, hd, hc);
 
-	free(hd);
+	release_scratch(SCRATCH_HUNGARIAN, hd);
 }
 
@@ -22,5 +22,6 @@ void solve_hungarian(int n, box_mat cost, hungarian_solution *sol,
 	hungarian_cache *hc);
 
 hungarian_cache *allocate_hungarian_cache();
+void free_hungarian_cache(hungarian_cache *hc);
 
 
@@ -1,5 +1,6 @@
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "imagine.h"
 #include "util.h"
@@ -10,6 +11,50 @@
 #include "biconnect.h"
 #include "hf_search.h"
 
+void allocate_imagined_boards(int boards_num, helper *h)
+{
+	imagine_data *im = h->imagine;
+	int size;
+
+	if ((boards_num > im->max_boards) || (current_level->index_num != im->index_num))
+	{
+		free(im->boxes);
+		free(im->fixed);
+		free(im->packed_num);
+
+		size = boards_num * current_level->index_num;
+		im->boxes = (UINT_8*)malloc(size);
+		im->fixed = (UINT_8*)malloc(size);
+		im->packed_num = (int*)malloc(sizeof(int) * boards_num);
+		if ((im->boxes == 0) || (im->fixed == 0) || (im->packed_num == 0))
+			exit_with_error("can't alloc imagined boards");
+
+		im->max_boards = boards_num;
+		im->index_num = current_level->index_num;
+	}
+
+	memset(im->boxes, 0, im->max_boards * im->index_num);
+	memset(im->fixed, 0, im->max_boards * im->index_num);
+	memset(im->packed_num, 0, sizeof(int) * im->max_boards);
+}
+
+void store_imagined_board(board b, board fixed, int permanent, helper *h)
+{
+	imagine_data *im = h->imagine;
+	int i, y, x;
+	int place = im->imagined_boards_num * im->index_num;
+
+	for (i = 0; i < im->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		im->boxes[place + i] = (b[y][x] & BOX ? 1 : 0);
+		im->fixed[place + i] = fixed[y][x];
+	}
+
+	im->packed_num[im->imagined_boards_num] = permanent;
+	im->imagined_boards_num++;
+}
+
 void init_imagine(park_order_data *full, int n, helper *h)
 {
 	int i;
@@ -24,6 +69,9 @@ void init_imagine(park_order_data *full, int n, helper *h)
 
 	h->imagine->imagined_boards_num = 0;
 
+	// at most one board per step, and at least one board
+	allocate_imagined_boards(n + 1, h);
+
 	for (i = 0; i < n; i++)
 		if (full[i].from == -1) // box from sink 
 			return;
@@ -37,7 +85,7 @@ void init_imagine(park_order_data *full, int n, helper *h)
 			exit_with_error("shifting a box in place");
 		}
 
-	copy_board(initial_board, b);
+	copy_board(current_level->initial_board, b);
 	clear_boxes_inplace(b);
 	clear_sokoban_inplace(b);
 	zero_board(fixed);
@@ -57,10 +105,7 @@ void init_imagine(park_order_data *full, int n, helper *h)
 //			printf("before permanently putting %d boxes, board is:\n", permanent);
 //			print_board(b);
 
-			copy_board(b, h->imagine->imagined_boards[h->imagine->imagined_boards_num]);
-			copy_board(fixed, h->imagine->fixed_at_step[h->imagine->imagined_boards_num]);
-			h->imagine->imagine_packed_num[h->imagine->imagined_boards_num] = permanent;
-			h->imagine->imagined_boards_num++;
+			store_imagined_board(b, fixed, permanent, h);
 	//		my_getch();
 		}
 
@@ -77,26 +122,24 @@ void init_imagine(park_order_data *full, int n, helper *h)
 	if (h->imagine->imagined_boards_num == 0)
 	{ // for the extra rare case of no plan, i.e. all boxes are just in place
 
-		if (n != global_boxes_in_level)	exit_with_error("corrupted plan");
+		if (n != current_level->boxes_in_level)	exit_with_error("corrupted plan");
 
-		copy_board(b, h->imagine->imagined_boards[0]);
-		copy_board(fixed, h->imagine->fixed_at_step[0]);
-		h->imagine->imagine_packed_num[0] = permanent;
-		h->imagine->imagined_boards_num = 1;
+		store_imagined_board(b, fixed, permanent, h);
 	}
 
 }
 
 void get_imagined_board(board b, board imagined, int *relevant_board, helper *h)
 {
-	int i;
+	int i, y, x;
 	int packed_boxes;
+	UINT_8 *boxes;
 
 	if (h->imagine == 0) exit_with_error("imagine not allocated");
 
 	packed_boxes = score_parked_boxes(b, h);
 
-	if (packed_boxes == global_boxes_in_level) // level is solved
+	if (packed_boxes == current_level->boxes_in_level) // level is solved
 	{
 		copy_board(b, imagined);
 		*relevant_board = h->imagine->imagined_boards_num - 1;
@@ -104,12 +147,23 @@ void get_imagined_board(board b, board imagined, int *relevant_board, helper *h)
 	}
 
 	for (i = 0; i < h->imagine->imagined_boards_num; i++)
-		if (h->imagine->imagine_packed_num[i] > packed_boxes)
+		if (h->imagine->packed_num[i] > packed_boxes)
 			break;
 
 	*relevant_board = i;
 
-	copy_board(h->imagine->imagined_boards[i], imagined);
+	// the imagined board is the level without boxes, with the imagined boxes
+	copy_board(current_level->initial_board, imagined);
+	clear_boxes_inplace(imagined);
+	clear_sokoban_inplace(imagined);
+
+	boxes = h->imagine->boxes + i * h->imagine->index_num;
+	for (i = 0; i < h->imagine->index_num; i++)
+		if (boxes[i])
+		{
+			index_to_y_x(i, &y, &x);
+			imagined[y][x] |= BOX;
+		}
 }
 
 
@@ -120,6 +174,7 @@ int imagine_score(board b, int search_mode, helper *h)
 	board imagined;
 	int sum = 0;
 	int i, j;
+	int place, index;
 
 	if (h->imagine == 0) exit_with_error("imagine not allocated");
 
@@ -132,17 +187,24 @@ int imagine_score(board b, int search_mode, helper *h)
 	if (search_mode != NORMAL)
 		exit_with_error("why here?\n");
 
-	if (h->parking_order_num != global_boxes_in_level)
+	if (h->parking_order_num != current_level->boxes_in_level)
 		exit_with_error("debug order");
 
 	get_imagined_board(b, imagined, &relevant_board, h);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	place = relevant_board * h->imagine->index_num;
+
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
-				if ((h->imagine->imagined_boards)[relevant_board][i][j] & BOX)
-					if ((h->imagine->fixed_at_step)[relevant_board][i][j] == 0) // don't count packed boxes
+			{
+				index = current_level->y_x_to_index_table[i][j];
+				if (index < 0) continue;
+
+				if (h->imagine->boxes[place + index])
+					if (h->imagine->fixed[place + index] == 0) // don't count packed boxes
 						sum++;
+			}
 
 	return sum;
 }
@@ -180,8 +242,8 @@ void set_imagined_hf_board(board b, helper *h)
 
 	copy_board(b, c);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			c[i][j] &= ~TARGET;
 			if (c[i][j] & BOX)
@@ -225,8 +287,8 @@ void print_board_with_imagined(board b_in, helper* h)
 
 	copy_board(b_in, b);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			b[i][j] &= ~TARGET;
 			if (h->imagined_hf_board[i][j] & BOX)
@@ -187,13 +187,13 @@ void show_board(board b_in)
 	board b;
 
 #ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&show_board_mutex);
+	if (threads_share_level()) pthread_mutex_lock(&show_board_mutex);
 #endif
 
 	copy_board(b_in, b);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & DEADLOCK_ZONE)
 			{
@@ -204,15 +204,15 @@ void show_board(board b_in)
 
 
 	printf("  ");
-	for (i = 0; i < width; i++)
+	for (i = 0; i < current_level->width; i++)
 		printf("%d", i % 10);
 	printf("\n");
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
 		printf("%d ", i % 10);
 
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			switch (b[i][j])
 			{
@@ -301,7 +301,7 @@ void show_board(board b_in)
 	fflush(stdout);
 
 #ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&show_board_mutex);
+	if (threads_share_level()) pthread_mutex_unlock(&show_board_mutex);
 #endif
 
 }
@@ -310,7 +310,7 @@ void show_board(board b_in)
 void print_in_color(const char *txt, const char *color)
 {
 #ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&show_board_mutex);
+	if (threads_share_level()) pthread_mutex_lock(&show_board_mutex);
 #endif
 
 	if (strcmp(color, "red") == 0)
@@ -322,16 +322,16 @@ void print_in_color(const char *txt, const char *color)
 	SetColorAndBackground(WHITE, BLACK);
 
 #ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&show_board_mutex);
+	if (threads_share_level()) pthread_mutex_unlock(&show_board_mutex);
 #endif
 }
 
 void save_board_to_file(board b, FILE *fp)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] == 0) fprintf(fp, " ");
 			if (b[i][j] == WALL) fprintf(fp, "#");
@@ -446,28 +446,40 @@ int is_sokoban_line(char *s)
 
 void set_board_and_title(board text_level, int row_num, board b)
 {
-	get_board_from_text(text_level, row_num, b, &width);
-	height = row_num;
+	get_board_from_text(text_level, row_num, b, &current_level->width);
+	current_level->height = row_num;
 }
 
 
-int load_level_from_file(board b, int level_number) // level number is one-based!
+// The level set is read once and indexed. Each level keeps the place of its rows and its
+// title, so loading a level does not rescan the file. This matters for collections with
+// thousands of levels.
+
+typedef struct
 {
-	// loads a sokoban level from a .sok or .txt format
-	// returns the number of levels in the file
+	int first_line;
+	int rows_num;
+	int ok; // 0 if the level is too big
+	char *title;
+} level_index_data;
+
+char *level_set_text = 0;
+char **level_set_lines = 0;
+int level_set_lines_num = 0;
+
+level_index_data *level_index = 0;
+int level_index_num = 0;
+int level_index_size = 0;
 
+char no_title[] = "None";
+
+FILE *open_level_set()
+{
 	FILE *fp;
-	board text_level;
-	int row_num;
-	char s[1000];
-	int in_level = 0;
-	int current_level_num = 0; // how many levels were already read
 	char filename[3000];
-	char tmp_title[1000] = "None";
-	int ok = 0;
 
-	if (level_number <= 0)
-		exit_with_error("Level number must be positive");
+	if (strcmp(global_level_set_name, "-") == 0)
+		return stdin;
 
 #ifndef LINUX
 	sprintf(filename, "%s\\levels\\%s.sok", global_dir, global_level_set_name);
@@ -480,10 +492,6 @@ int load_level_from_file(board b, int level_number) // level number is one-based
 		strstr(global_level_set_name, "/"))
 		strcpy(filename, global_level_set_name);
 
-	
-	
-//	sprintf(filename, "c:\\data\\debug.txt"); level_number = 1;
-
 	fp = fopen(filename, "rb");
 	if (fp == NULL)
 	{
@@ -491,101 +499,185 @@ int load_level_from_file(board b, int level_number) // level number is one-based
 		my_getch();
 		exit(0);
 	}
+	return fp;
+}
+
+void read_level_set()
+{
+	// reads the whole file and splits it into lines
+	FILE *fp;
+	size_t size = 0, allocated = 1 << 16;
+	size_t n, i;
+	int lines_allocated = 1024;
+
+	fp = open_level_set();
 
-	while (fgets(s, 1000, fp))
+	level_set_text = (char*)malloc(allocated + 1);
+	if (level_set_text == 0) exit_with_error("can't alloc level set");
+
+	while ((n = fread(level_set_text + size, 1, allocated - size, fp)) > 0)
 	{
-		remove_newline(s);
+		size += n;
+		if (size < allocated) continue;
+
+		allocated *= 2;
+		level_set_text = (char*)realloc(level_set_text, allocated + 1);
+		if (level_set_text == 0) exit_with_error("can't alloc level set");
+	}
+	level_set_text[size] = 0;
+
+	if (fp != stdin)
+		fclose(fp);
+
+	level_set_lines = (char**)malloc(sizeof(char*) * lines_allocated);
+	if (level_set_lines == 0) exit_with_error("can't alloc level set");
+
+	i = 0;
+	while (i < size)
+	{
+		if (level_set_lines_num == lines_allocated)
+		{
+			lines_allocated *= 2;
+			level_set_lines = (char**)realloc(level_set_lines, sizeof(char*) * lines_allocated);
+			if (level_set_lines == 0) exit_with_error("can't alloc level set");
+		}
+
+		level_set_lines[level_set_lines_num++] = level_set_text + i;
+
+		while ((i < size) && (level_set_text[i] != '\n'))
+			i++;
+		level_set_text[i++] = 0;
+
+		remove_newline(level_set_lines[level_set_lines_num - 1]);
+	}
+}
+
+void add_level_to_index(int first_line, int rows_num, int ok, char *title)
+{
+	level_index_data *e;
+
+	if (level_index_num == level_index_size)
+	{
+		level_index_size = (level_index_size == 0 ? 256 : level_index_size * 2);
+		level_index = (level_index_data*)realloc(level_index, sizeof(level_index_data) * level_index_size);
+		if (level_index == 0) exit_with_error("can't alloc level index");
+	}
+
+	e = level_index + level_index_num++;
+	e->first_line = first_line;
+	e->rows_num = rows_num;
+	e->ok = ok;
+	e->title = title;
+}
+
+void index_level_set()
+{
+	// a level is a block of sokoban lines. Its title is the last line with "'" before the
+	// level ends, or a ';' line right after it, or a "Title:" line that follows it.
+	// A level without any of these gets the last such line before it.
+
+	int i;
+	char *s;
+	char *tmp_title = no_title;
+	int in_level = 0;
+	int first_line = 0;
+	int ok = 0;
+
+	read_level_set();
+
+	for (i = 0; i < level_set_lines_num; i++)
+	{
+		s = level_set_lines[i];
 
 		if (strstr(s, "'"))
-			strcpy(tmp_title, s);
+			tmp_title = s;
 
 		if (is_sokoban_line(s))
 		{
 			if (in_level == 0)
 			{
 				in_level = 1;
-				row_num = 0;
+				first_line = i;
 				ok = 1;
 			}
 
-			if (strlen(s) >= MAX_SIZE)
-			{
-				s[MAX_SIZE - 1] = 0;
-				ok = 0;
-				if (verbose >= 4)
-					printf("width is too big! level %d\n", current_level_num + 1);
-				strcpy(global_fail_reason, "Size is too big");
-			}
-
-			strcpy((char*)text_level[row_num], s);
-			row_num++;
-
-			if (row_num >= MAX_SIZE)
-			{
-				ok = 0;
-				if (verbose >= 4)
-					printf("height is too big! level %d\n", current_level_num + 1);
-				strcpy(global_fail_reason, "Size is too big");
-				row_num--;
-			}
+			if (strlen(s) >= MAX_SIZE) ok = 0;
+			if ((i - first_line + 1) >= MAX_SIZE) ok = 0;
 		}
 		else // not a sokoban line
 		{
 			if (in_level)
 			{
-				current_level_num++;
-
 				if (s[0] == ';')
 				{
-					strcpy(tmp_title, s + 1);
-					remove_preceeding_spaces(tmp_title);
+					tmp_title = s + 1;
+					while (*tmp_title == ' ') tmp_title++;
 				}
 
-				if (current_level_num == level_number)
-				{
-					if (ok)
-						set_board_and_title(text_level, row_num, b);
-					else
-						height = width = 0;
-
-					strcpy(level_title, tmp_title);
-					strcpy(tmp_title, "None");
-				}
+				add_level_to_index(first_line, i - first_line, ok, tmp_title);
 			}
 			in_level = 0;
 		}
 
+		if (level_index_num == 0) continue;
+
 		if (strncmp(s, "Title:", 6) == 0)
-		{
-			if (current_level_num == level_number)
-				strcpy(level_title, s + 7);
-		}
+			level_index[level_index_num - 1].title = s + 7;
 
 		if (strncmp(s, "Title : ", 7) == 0)
-		{
-			if (current_level_num == level_number)
-				strcpy(level_title, s + 8);
-		}
+			level_index[level_index_num - 1].title = s + 8;
 	}
 
 	if (in_level)
-	{
-		current_level_num++;
+		add_level_to_index(first_line, level_set_lines_num - first_line, ok, tmp_title);
 
-		if (current_level_num == level_number)
-		{
-			if (ok)
-				set_board_and_title(text_level, row_num, b);
-			else
-				height = width = 0;
+	if (verbose >= 4)
+		printf("%d levels in level set\n", level_index_num);
+}
 
-			strcpy(level_title, tmp_title);
-		}
+int get_levels_num()
+{
+	if (level_set_lines == 0)
+		index_level_set();
+
+	return level_index_num;
+}
+
+int load_level_from_file(board b, int level_number) // level number is one-based!
+{
+	// loads a sokoban level from a .sok or .txt format
+	// returns the number of levels in the file
+
+	board text_level;
+	level_index_data *e;
+	int i;
+
+	if (level_number <= 0)
+		exit_with_error("Level number must be positive");
+
+	if (level_number > get_levels_num())
+		return level_index_num;
+
+	e = level_index + level_number - 1;
+
+	if (e->ok)
+	{
+		for (i = 0; i < e->rows_num; i++)
+			strcpy((char*)text_level[i], level_set_lines[e->first_line + i]);
+		set_board_and_title(text_level, e->rows_num, b);
+	}
+	else
+	{
+		if (verbose >= 4)
+			printf("level %d is too big!\n", level_number);
+		strcpy(current_level->fail_reason, "Size is too big");
+		current_level->height = current_level->width = 0;
 	}
 
-	fclose(fp);
-	
-	return current_level_num;
+	strncpy(current_level->level_title, e->title, sizeof(current_level->level_title) - 1);
+	current_level->level_title[sizeof(current_level->level_title) - 1] = 0;
+
+	return level_index_num;
 }
 
 void save_debug_board(board b)
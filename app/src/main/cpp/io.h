@@ -10,5 +10,6 @@ void save_board_to_file(board b, FILE *fp);
 void save_debug_board(board b);
 
 int load_level_from_file(board b, int level_number); // level number is one-based!
+int get_levels_num();
 
 void print_in_color(const char *txt, const char *color);
@@ -13,6 +13,7 @@
 #include "distance.h"
 #include "rooms.h"
 #include "holes.h"
+#include "knowledge.h"
 
 #define K_DIST_MAX_POSITIONS 600
 
@@ -29,21 +30,74 @@ typedef struct k_dist_entry
 
 #define MAX_K_DIST_HASH_SIZE 500
 
-k_dist_entry k_dist_hash[MAX_K_DIST_HASH_SIZE];
+typedef struct k_dist_data
+{
+	k_dist_entry hash[MAX_K_DIST_HASH_SIZE];
+	int hash_num;
+} k_dist_data;
 
-int k_dist_hash_num;
+void allocate_k_dist_data(level_context *l)
+{
+	l->k_dist = (k_dist_data*)calloc(1, sizeof(k_dist_data));
+	if (l->k_dist == 0) exit_with_error("can't allocate k dist hash\n");
+}
 
 void clear_k_dist_hash()
 {
-	k_dist_hash_num = 0;
+	current_level->k_dist->hash_num = 0;
+}
+
+int write_k_dist_hash(FILE *fp)
+{
+	int i;
+	k_dist_entry *e;
+
+	if (write_kb_data(fp, &current_level->k_dist->hash_num, sizeof(int)) == 0) return 0;
+
+	for (i = 0; i < current_level->k_dist->hash_num; i++)
+	{
+		e = current_level->k_dist->hash + i;
+
+		if (write_kb_data(fp, &e->hash, sizeof(UINT_64)) == 0) return 0;
+		if (write_kb_board(fp, e->b) == 0) return 0;
+		if (write_kb_board(fp, e->forced) == 0) return 0;
+		if (write_kb_board(fp, e->adj_4) == 0) return 0;
+		if (write_kb_board(fp, e->adj_9) == 0) return 0;
+	}
+	return 1;
+}
+
+int read_k_dist_hash(FILE *fp)
+{
+	int i, n;
+	k_dist_entry *e;
+
+	if (read_kb_data(fp, &n, sizeof(int)) == 0) return 0;
+	if ((n < 0) || (n > MAX_K_DIST_HASH_SIZE)) return 0;
+
+	for (i = 0; i < n; i++)
+	{
+		e = current_level->k_dist->hash + i;
+
+		if (read_kb_data(fp, &e->hash, sizeof(UINT_64)) == 0) break;
+		if (read_kb_board(fp, e->b) == 0) break;
+		if (read_kb_board(fp, e->forced) == 0) break;
+		if (read_kb_board(fp, e->adj_4) == 0) break;
+		if (read_kb_board(fp, e->adj_9) == 0) break;
+	}
+
+	current_level->k_dist->hash_num = i;
+	return (i == n);
 }
 
 int find_in_k_dist_hash(UINT_64 hash)
 {
+	// entries below the published size are complete and are not changed
 	int i;
+	int n = ATOMIC_LOAD_ACQUIRE(&current_level->k_dist->hash_num);
 
-	for (i = 0; i < k_dist_hash_num; i++)
-		if (k_dist_hash[i].hash == hash)
+	for (i = 0; i < n; i++)
+		if (current_level->k_dist->hash[i].hash == hash)
 			return i;
 	return -1;
 }
@@ -52,9 +106,9 @@ void display_adj(board b, board value)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] == WALL)
 			{
@@ -77,51 +131,57 @@ pthread_mutex_t k_dist_insert_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 void insert_to_k_dist_hash(UINT_64 hash, board w, board forced, board adj_4, board adj_9)
 {
-	int i, j;
-	int n = k_dist_hash_num;
-
-	if (n >= MAX_K_DIST_HASH_SIZE)
-		return;
+	// several threads may insert (see speculate.h). The entry is written under the lock,
+	// and published to the lock-free readers only when it is complete.
+	int i, j, n;
+	k_dist_entry *e;
 
 #ifdef THREADS
-	if (cores_num > 1)
+	if (threads_share_level())
 		pthread_mutex_lock(&k_dist_insert_mutex);
 #endif
 
-	k_dist_hash[n].hash = hash;
-	copy_board(w, k_dist_hash[n].b);
-	copy_board(forced, k_dist_hash[n].forced);
-	copy_board(adj_4, k_dist_hash[n].adj_4);
-	copy_board(adj_9, k_dist_hash[n].adj_9);
+	n = current_level->k_dist->hash_num;
 
-	if (debug_k_dist_deadlock)
+	if ((n < MAX_K_DIST_HASH_SIZE) && (find_in_k_dist_hash(hash) == -1))
 	{
-		printf("forced is:\n");
-		show_on_initial_board(forced);
+		e = current_level->k_dist->hash + n;
 
-		printf("adj_4:\n");
-		display_adj(w, adj_4);
-		printf("adj_9:\n");
-		display_adj(w, adj_9);
-	}
+		e->hash = hash;
+		copy_board(w, e->b);
+		copy_board(forced, e->forced);
+		copy_board(adj_4, e->adj_4);
+		copy_board(adj_9, e->adj_9);
 
-	if ((board_popcnt(forced) > 0) && (verbose >= 4))
-	{
-		printf("\nAdded k-dist entry\n");
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
-				if (forced[i][j])
-					w[i][j] |= DEADLOCK_ZONE; // we don't use w later
-		print_board(w);
-	}
+		if (debug_k_dist_deadlock)
+		{
+			printf("forced is:\n");
+			show_on_initial_board(forced);
 
-	k_dist_hash_num++;
+			printf("adj_4:\n");
+			display_adj(w, adj_4);
+			printf("adj_9:\n");
+			display_adj(w, adj_9);
+		}
+
+		if ((board_popcnt(forced) > 0) && (verbose >= 4))
+		{
+			printf("\nAdded k-dist entry\n");
+			for (i = 0; i < current_level->height; i++)
+				for (j = 0; j < current_level->width; j++)
+					if (forced[i][j])
+						w[i][j] |= DEADLOCK_ZONE; // we don't use w later
+			print_board(w);
+		}
+
+		ATOMIC_STORE_RELEASE(&current_level->k_dist->hash_num, n + 1);
+		ATOMIC_ADD(&current_level->learned_deadlocks, 1);
+	}
 
 #ifdef THREADS
-	if (cores_num > 1)
+	if (threads_share_level())
 		pthread_mutex_unlock(&k_dist_insert_mutex);
 #endif
-
 }
 
 int sokoban_touches_a_filled_hole(board b)
@@ -137,7 +197,7 @@ int sokoban_touches_a_filled_hole(board b)
 		y = sok_y + delta_y[i];
 		x = sok_x + delta_x[i];
 		if (b[y][x] == WALL)
-			if (initial_board[y][x] != WALL)
+			if (current_level->initial_board[y][x] != WALL)
 				return 1;
 	}
 	return 0;
@@ -151,9 +211,9 @@ void count_adjacent_boxes(board b, board adj_4, board adj_9)
 	zero_board(adj_4);
 	zero_board(adj_9);
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -187,30 +247,7 @@ int is_better_k_dist_score(score_element* new_score, score_element* old_score)
 void get_k_dist_pos_and_son(position *positions, int pos_num, int *pos, int *son)
 {
 	// return the move with the best connectivity
-	int i, j;
-	*pos = -1;
-
-	score_element best_score;
-	
-
-	for (i = 0; i < pos_num; i++)
-	{
-		if (positions[i].position_deadlocked) continue;
-
-		for (j = 0; j < positions[i].moves_num; j++)
-		{
-			if (positions[i].move_deadlocked[j]) continue;
-			if (positions[i].place_in_positions[j]) continue;
-
-			if ((*pos == -1) || (is_better_score(positions[i].scores + j, &best_score, 1, K_DIST_SEARCH)))
-			{
-				best_score = positions[i].scores[j];
-
-				*pos = i;
-				*son = j;
-			}
-		}
-	}
+	*pos = best_frontier_move(positions, pos_num, son, is_better_k_dist_score);
 }
 
 int check_for_k_dist_moves(board b, move *moves, int moves_num, helper *h)
@@ -224,7 +261,7 @@ int check_for_k_dist_moves(board b, move *moves, int moves_num, helper *h)
 		from = moves[i].from;
 		to = moves[i].to;
 
-		if (bfs_distance_from_to[to][from] >= h->k_dist_value)
+		if (get_bfs_distance(to, from) >= h->k_dist_value)
 		{
 			// allow a killing move only if the player can return to the pulled box 
 			// (not in a corral)
@@ -283,7 +320,7 @@ int get_k_dist_forced_boxes(board b_in, board forced_boxes, board adj_4, board a
 	}
 
 	for (i = 0; i < pos_num; i++)
-		direct_other_sons_to_position(positions + i, positions, pos_num);
+		direct_other_sons_to_position(positions + i);
 
 	while (pos_num < K_DIST_MAX_POSITIONS)
 	{
@@ -334,12 +371,12 @@ int get_k_dist_forced_boxes(board b_in, board forced_boxes, board adj_4, board a
 
 	if (search_terminated || removed_all)
 	{
-		free_positions(positions, pos_num);
+		free_positions(positions);
 		return search_terminated;
 	}
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			forced_boxes[i][j] = 1;
 			adj_4[i][j] = 10;
@@ -352,8 +389,8 @@ int get_k_dist_forced_boxes(board b_in, board forced_boxes, board adj_4, board a
 		
 		count_adjacent_boxes(b, local_adj_4, local_adj_9);
 
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if ((b[i][j] & BOX) == 0)
 					forced_boxes[i][j] = 0;
@@ -367,7 +404,7 @@ int get_k_dist_forced_boxes(board b_in, board forced_boxes, board adj_4, board a
 
 	}
 
-	free_positions(positions, pos_num);
+	free_positions(positions);
 
 	return search_terminated;
 }
@@ -423,39 +460,39 @@ int check_deadlock_using_k_dist_cache(board b)
 
 	count_adjacent_boxes(b_wallified, adj_4, adj_9);
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (k_dist_hash[n].forced[i][j])
+			if (current_level->k_dist->hash[n].forced[i][j])
 				if ((b[i][j] & BOX) == 0)
 				{
 					if (debug_k_dist_deadlock)
 					{
 						printf("found deadlock in hash\n");
 						print_board(b);
-						show_on_initial_board(k_dist_hash[n].forced);
+						show_on_initial_board(current_level->k_dist->hash[n].forced);
 					}
 					return 1;
 				}
 
-			if (adj_4[i][j] < k_dist_hash[n].adj_4[i][j])
+			if (adj_4[i][j] < current_level->k_dist->hash[n].adj_4[i][j])
 			{
 				if (debug_k_dist_deadlock)
 				{
 					printf("\nfound adj-4 deadlock in hash\n");
-					display_adj(w, k_dist_hash[n].adj_4);
+					display_adj(w, current_level->k_dist->hash[n].adj_4);
 					print_board(b);
 				}
 				return 1;
 			}
 
-			if (adj_9[i][j] < k_dist_hash[n].adj_9[i][j])
+			if (adj_9[i][j] < current_level->k_dist->hash[n].adj_9[i][j])
 			{
 				if (debug_k_dist_deadlock)
 				{
 					printf("\nfound adj-9 deadlock in hash\n");
-					display_adj(w, k_dist_hash[n].adj_9);
+					display_adj(w, current_level->k_dist->hash[n].adj_9);
 					print_board(b);
 				}
 				return 1;
@@ -567,7 +604,7 @@ int actual_k_dist_search(board b, int pull_mode, int k_dist_val, int search_size
 
 	search_terminated = (pos_num >= search_size ? 1 : 0);
 
-	free_positions(positions, pos_num);
+	free_positions(positions);
 
 	if (solved) return 0;
 	if (search_terminated) return 2;
@@ -1,3 +1,5 @@
+#include <stdio.h>
+
 #include "board.h"
 #include "moves.h"
 #include "positions.h"
@@ -6,7 +8,10 @@ int check_for_k_dist_moves(board b, move *moves, int moves_num, helper *h);
 
 int is_k_dist_deadlock(board b); 
 
+void allocate_k_dist_data(level_context *l);
 void clear_k_dist_hash();
+int write_k_dist_hash(FILE *fp);
+int read_k_dist_hash(FILE *fp);
 
 int sokoban_touches_a_filled_hole(board b);
 
@@ -0,0 +1,261 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef LINUX
+#include <unistd.h>
+#else
+#include <process.h>
+#define getpid _getpid
+#endif
+
+#include "knowledge.h"
+#include "util.h"
+#include "stuck.h"
+#include "mpdb2.h"
+#include "k_dist_deadlock.h"
+#include "deadlock_cache.h"
+
+// A knowledge file starts with a header that identifies the level, followed by the tables
+// in a fixed order. Each module writes and reads its own tables (write_stuck_patterns etc.)
+// A file that does not match the level is ignored. The files are written to a temporary
+// name and renamed, so a crash or a parallel run never leaves a partial file.
+
+#define KB_MAGIC   0x31424B46 // "FKB1"
+#define KB_VERSION 1
+
+typedef struct
+{
+	int magic;
+	int version;
+	UINT_64 key;
+	int height;
+	int width;
+	int index_num;
+	int with_boxes;
+} kb_header;
+
+typedef struct knowledge_data
+{
+	int loaded[2]; // KB_MPDB, KB_PULL_MPDB
+
+	// set while preprocessing, because the search may change the initial board
+	kb_header headers[2]; // without boxes, with boxes
+} knowledge_data;
+
+void allocate_knowledge_data(level_context *l)
+{
+	l->knowledge = (knowledge_data*)calloc(1, sizeof(knowledge_data));
+	if (l->knowledge == 0) exit_with_error("can't allocate knowledge data\n");
+}
+
+int write_kb_data(FILE *fp, void *data, int size)
+{
+	if (size == 0) return 1;
+	return (fwrite(data, size, 1, fp) == 1);
+}
+
+int read_kb_data(FILE *fp, void *data, int size)
+{
+	if (size == 0) return 1;
+	return (fread(data, size, 1, fp) == 1);
+}
+
+int write_kb_board(FILE *fp, board b)
+{
+	int i;
+
+	for (i = 0; i < current_level->height; i++)
+		if (write_kb_data(fp, b[i], current_level->width) == 0)
+			return 0;
+	return 1;
+}
+
+int read_kb_board(FILE *fp, board b)
+{
+	int i;
+
+	zero_board(b);
+
+	for (i = 0; i < current_level->height; i++)
+		if (read_kb_data(fp, b[i], current_level->width) == 0)
+			return 0;
+	return 1;
+}
+
+UINT_64 get_level_key(int with_boxes)
+{
+	// FNV-1a of the initial board. Without boxes, only the walls, targets and inner
+	// squares are hashed, so variants of a level share their push patterns.
+	UINT_64 key = 0xCBF29CE484222325ULL;
+	int i, j;
+	int mask = WALL | TARGET;
+	UINT_8 c;
+
+	if (with_boxes)
+		mask |= BOX | SOKOBAN;
+
+	key = (key ^ current_level->height) * 0x100000001B3ULL;
+	key = (key ^ current_level->width) * 0x100000001B3ULL;
+
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+		{
+			c = current_level->initial_board[i][j] & mask;
+			if (current_level->inner[i][j]) c |= 0x80;
+
+			key = (key ^ c) * 0x100000001B3ULL;
+		}
+
+	return key;
+}
+
+void get_knowledge_filename(char *filename, int with_boxes)
+{
+#ifndef LINUX
+	sprintf(filename, "%s\\%c%016llx.kb", knowledge_dir, with_boxes ? 'l' : 'g', current_level->knowledge->headers[with_boxes].key);
+#else
+	sprintf(filename, "%s/%c%016llx.kb", knowledge_dir, with_boxes ? 'l' : 'g', current_level->knowledge->headers[with_boxes].key);
+#endif
+}
+
+void set_kb_header(kb_header *hd, int with_boxes)
+{
+	memset(hd, 0, sizeof(kb_header));
+
+	hd->magic = KB_MAGIC;
+	hd->version = KB_VERSION;
+	hd->key = get_level_key(with_boxes);
+	hd->height = current_level->height;
+	hd->width = current_level->width;
+	hd->index_num = current_level->index_num;
+	hd->with_boxes = with_boxes;
+}
+
+FILE *open_knowledge_file(int with_boxes)
+{
+	FILE *fp;
+	char filename[2000];
+	kb_header hd;
+	kb_header *headers = current_level->knowledge->headers;
+
+	get_knowledge_filename(filename, with_boxes);
+
+	fp = fopen(filename, "rb");
+	if (fp == NULL) return NULL;
+
+	if ((read_kb_data(fp, &hd, sizeof(kb_header)) == 0) ||
+		(memcmp(&hd, headers + with_boxes, sizeof(kb_header)) != 0))
+	{
+		if (verbose >= 4)
+			printf("ignoring knowledge file %s\n", filename);
+		fclose(fp);
+		return NULL;
+	}
+
+	return fp;
+}
+
+void load_knowledge()
+{
+	// called while preprocessing, after the tables were cleared
+	knowledge_data *k = current_level->knowledge;
+	FILE *fp;
+	int ok;
+
+	k->loaded[KB_MPDB] = 0;
+	k->loaded[KB_PULL_MPDB] = 0;
+
+	if (knowledge_dir[0] == 0) return;
+
+	set_kb_header(k->headers + 0, 0);
+	set_kb_header(k->headers + 1, 1);
+
+	fp = open_knowledge_file(0);
+	if (fp)
+	{
+		ok = read_stuck_patterns(fp, 0);
+		if (ok) k->loaded[KB_MPDB] = read_mpdb(fp, 0);
+
+		fclose(fp);
+	}
+
+	fp = open_knowledge_file(1);
+	if (fp)
+	{
+		ok = read_stuck_patterns(fp, 1);
+		if (ok) ok = k->loaded[KB_PULL_MPDB] = read_mpdb(fp, 1);
+		if (ok) ok = read_k_dist_hash(fp);
+		if (ok) ok = read_deadlock_cache(fp);
+
+		fclose(fp);
+	}
+
+	if (verbose >= 4)
+		printf("knowledge loaded. mpdb: %d pull mpdb: %d\n", k->loaded[KB_MPDB], k->loaded[KB_PULL_MPDB]);
+}
+
+int knowledge_was_loaded(int kind)
+{
+	return current_level->knowledge->loaded[kind];
+}
+
+void save_knowledge_file(int with_boxes)
+{
+	FILE *fp;
+	char filename[2000], tmp_filename[2100];
+	int ok;
+
+	get_knowledge_filename(filename, with_boxes);
+	sprintf(tmp_filename, "%s.%d", filename, (int)getpid());
+
+	fp = fopen(tmp_filename, "wb");
+	if (fp == NULL)
+	{
+		if (verbose >= 4)
+			printf("can't write knowledge file %s\n", tmp_filename);
+		return;
+	}
+
+	ok = write_kb_data(fp, current_level->knowledge->headers + with_boxes, sizeof(kb_header));
+
+	if (with_boxes == 0)
+	{
+		if (ok) ok = write_stuck_patterns(fp, 0);
+		if (ok) ok = write_mpdb(fp, 0);
+	}
+	else
+	{
+		if (ok) ok = write_stuck_patterns(fp, 1);
+		if (ok) ok = write_mpdb(fp, 1);
+		if (ok) ok = write_k_dist_hash(fp);
+		if (ok) ok = write_deadlock_cache(fp);
+	}
+
+	if (fclose(fp) != 0) ok = 0;
+
+	if (ok == 0)
+	{
+		remove(tmp_filename);
+		return;
+	}
+
+#ifndef LINUX
+	remove(filename); // rename does not replace an existing file
+#endif
+	rename(tmp_filename, filename);
+
+	if (verbose >= 4)
+		printf("knowledge saved to %s\n", filename);
+}
+
+void save_knowledge()
+{
+	if (knowledge_dir[0] == 0) return;
+
+	save_knowledge_file(0);
+	save_knowledge_file(1);
+}
@@ -0,0 +1,29 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#ifndef __KNOWLEDGE
+#define __KNOWLEDGE
+
+#include <stdio.h>
+
+#include "global.h"
+
+// Deadlock knowledge that is saved to -kb_dir and loaded when the same level is solved again.
+// Knowledge that depends only on the walls and targets (push patterns) is shared by all the
+// levels with that geometry. Knowledge that depends on the initial boxes (pull patterns, k-dist
+// entries, deadlock cache verdicts) is kept per level.
+
+#define KB_MPDB      0
+#define KB_PULL_MPDB 1
+
+void allocate_knowledge_data(level_context *l);
+void load_knowledge();
+void save_knowledge();
+int knowledge_was_loaded(int kind);
+
+int write_kb_data(FILE *fp, void *data, int size);
+int read_kb_data(FILE *fp, void *data, int size);
+int write_kb_board(FILE *fp, board b);
+int read_kb_board(FILE *fp, board b);
+
+#endif
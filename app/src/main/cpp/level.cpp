@@ -0,0 +1,261 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "level.h"
+#include "util.h"
+#include "tree.h"
+#include "helper.h"
+#include "hotspot.h"
+#include "rooms_deadlock.h"
+#include "mpdb2.h"
+#include "stuck.h"
+#include "k_dist_deadlock.h"
+#include "girl.h"
+#include "snail.h"
+#include "envelope.h"
+#include "deadlock_cache.h"
+#include "perimeter.h"
+#include "dragonfly.h"
+#include "advanced_deadlock.h"
+#include "knowledge.h"
+
+THREAD_LOCAL level_context *current_level;
+
+int get_tree_log_size()
+{
+	int log_size = 23; // about 1.5GB per core
+
+#ifdef VISUAL_STUDIO
+	log_size = 22; // should fit in a the 2GB memory limit...
+#endif
+
+	return log_size + extra_mem;
+}
+
+void allocate_search_trees(level_context *l)
+{
+	int i;
+
+	if (l->workers_num < 1)
+		exit_with_error("Number of cores should be positive");
+
+	// any core may run any strategy, so all trees have the same size
+	l->search_trees = (tree*)malloc(sizeof(tree) * l->workers_num);
+	if (l->search_trees == 0) exit_with_error("can't allocate search trees\n");
+
+	for (i = 0; i < l->workers_num; i++)
+	{
+		if (verbose >= 4) printf("Allocating search tree for core %d\n", i);
+		init_tree(&l->search_trees[i], l->tree_log_size);
+	}
+}
+
+void free_search_trees(level_context *l)
+{
+	int i;
+	for (i = 0; i < l->workers_num; i++)
+		free_tree(l->search_trees + i);
+	free(l->search_trees);
+}
+
+
+void allocate_helpers(level_context *l)
+{
+	int i;
+
+	l->helpers = (helper*)malloc(sizeof(helper) * l->workers_num);
+	if (l->helpers == 0) exit_with_error("can't allocate helpers\n");
+
+	for (i = 0; i < l->workers_num; i++)
+	{
+		init_helper(l->helpers + i);
+		init_helper_extra_fields(l->helpers + i);
+		l->helpers[i].my_core = i;
+	}
+}
+
+void free_helpers(level_context *l)
+{
+	int i;
+
+	for (i = 0; i < l->workers_num; i++)
+		free_helper(l->helpers + i);
+	free(l->helpers);
+}
+
+level_context *allocate_level_context()
+{
+	level_context *l;
+
+	l = (level_context*)calloc(1, sizeof(level_context));
+	if (l == 0) exit_with_error("can't allocate level context\n");
+
+	allocate_hotspot_data(l);
+	allocate_rooms_deadlock_data(l);
+	allocate_mpdb_data(l);
+	allocate_stuck_data(l);
+	allocate_k_dist_data(l);
+	allocate_girl_data(l);
+	allocate_snail_data(l);
+	allocate_envelope_data(l);
+	allocate_deadlock_stats_data(l);
+	allocate_knowledge_data(l);
+
+	return l;
+}
+
+// Under a memory budget (-mem), the tables keep the proportions of their default sizes.
+// All of them are scaled by the same power of two, and then each is doubled while the
+// budget allows. The rest of the solver (level data, helpers, thread stacks) is assumed
+// to fit in the reserve.
+
+#define RESERVED_MEMORY_MB 128
+#define RESERVED_MEMORY_MB_PER_CORE 16
+#define MIN_TABLE_LOG_SIZE 12
+#define MAX_TREE_LOG_SIZE 28
+
+#define TABLES_NUM 4
+
+UINT_64 get_tables_memory(level_context *l, int *logs)
+{
+	// logs: tree, perimeter, deadlock cache, dragonfly
+	return get_tree_memory(logs[0]) * l->workers_num +
+		get_perimeter_memory(logs[1]) +
+		get_deadlock_cache_memory(logs[2]) +
+		get_dragonfly_memory(logs[3]);
+}
+
+int clamp_table_log(int log_size, int table)
+{
+	int max_log = (table == 0 ? MAX_TREE_LOG_SIZE : MAX_TABLE_LOG_SIZE);
+
+	if (log_size < MIN_TABLE_LOG_SIZE) return MIN_TABLE_LOG_SIZE;
+	if (log_size > max_log) return max_log;
+	return log_size;
+}
+
+void fit_tables_to_budget(level_context *l, int *logs)
+{
+	UINT_64 reserved, available;
+	int defaults[TABLES_NUM], scaled[TABLES_NUM];
+	int i, shift, changed, fits = 0;
+	int fixed_cache = (deadlock_cache_mb != 0); // the user chose its size
+
+	reserved = ((UINT_64)RESERVED_MEMORY_MB + (UINT_64)RESERVED_MEMORY_MB_PER_CORE * l->workers_num) << 20;
+	if (memory_budget <= reserved)
+		exit_with_error("memory budget is too small");
+	available = memory_budget - reserved;
+
+	for (i = 0; i < TABLES_NUM; i++)
+		defaults[i] = logs[i];
+
+	// the largest common shift that fits
+	for (shift = -MAX_TABLE_LOG_SIZE; shift <= MAX_TABLE_LOG_SIZE; shift++)
+	{
+		for (i = 0; i < TABLES_NUM; i++)
+		{
+			if ((i == 2) && fixed_cache)
+				scaled[i] = defaults[i];
+			else
+				scaled[i] = clamp_table_log(defaults[i] + shift, i);
+		}
+
+		if (get_tables_memory(l, scaled) > available)
+			break;
+
+		for (i = 0; i < TABLES_NUM; i++)
+			logs[i] = scaled[i];
+		fits = 1;
+	}
+
+	if (fits == 0)
+		exit_with_error("memory budget is too small");
+
+	// use what is left
+	do
+	{
+		changed = 0;
+		for (i = 0; i < TABLES_NUM; i++)
+		{
+			if ((i == 2) && fixed_cache) continue;
+			if (logs[i] == clamp_table_log(logs[i] + 1, i)) continue;
+
+			logs[i]++;
+			if (get_tables_memory(l, logs) <= available)
+				changed = 1;
+			else
+				logs[i]--;
+		}
+	} while (changed);
+}
+
+void plan_table_sizes(level_context *l)
+{
+	int logs[TABLES_NUM];
+
+	logs[0] = get_tree_log_size();
+	logs[1] = get_perimeter_size();
+	logs[2] = get_log_deadlock_cache();
+	logs[3] = get_dragonfly_log_size();
+
+	if (memory_budget)
+	{
+		fit_tables_to_budget(l, logs);
+
+		if (verbose >= 3)
+		{
+			printf("memory budget %llu MB: trees %d x %llu MB, perimeter %llu MB, deadlock cache %llu MB, dragonfly %llu MB\n",
+				memory_budget >> 20, l->workers_num, get_tree_memory(logs[0]) >> 20,
+				get_perimeter_memory(logs[1]) >> 20, get_deadlock_cache_memory(logs[2]) >> 20,
+				get_dragonfly_memory(logs[3]) >> 20);
+		}
+	}
+
+	l->tree_log_size = logs[0];
+	l->perimeter_log_size = logs[1];
+	l->deadlock_cache_log_size = logs[2];
+	l->dragonfly_log_size = logs[3];
+}
+
+void allocate_search_tables(level_context *l, int workers_num)
+{
+	// the search tables are big, so they are allocated only by the context that solves levels
+	l->workers_num = workers_num;
+	plan_table_sizes(l);
+
+	allocate_perimeter(l);
+	allocate_deadlock_cache(l);
+	allocate_search_trees(l);
+	allocate_helpers(l);
+	init_dragonfly(l);
+}
+
+void free_level_context(level_context *l)
+{
+	free(l->hotspot);
+	free(l->rooms_deadlock);
+	free(l->mpdb);
+	free(l->stuck);
+	free(l->k_dist);
+	free(l->girl);
+	free(l->snail);
+	free(l->envelope);
+	free(l->deadlock_stats);
+	free(l->knowledge);
+	free(l->distance_from_to);
+	free(l->bfs_distance_from_to);
+
+	if (l->search_trees)
+	{
+		free_perimeter(l);
+		free_deadlock_cache(l);
+		free_search_trees(l);
+		free_helpers(l);
+		free_dragonfly(l);
+	}
+
+	free(l);
+}
@@ -0,0 +1,114 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#ifndef __LEVEL
+#define __LEVEL
+
+#include <stddef.h>
+
+#include "global.h"
+
+// The level context holds everything that belongs to one level: its geometry, the tables built by
+// preprocess_level() and the search tables that are reused from level to level.
+// Each thread that works on a level sets current_level, so several levels can be solved
+// at the same time in one process, each with its own context.
+
+struct hotspot_data;
+struct rooms_deadlock_data;
+struct mpdb_data;
+struct stuck_data;
+struct k_dist_data;
+struct girl_data;
+struct snail_data;
+struct envelope_data;
+struct deadlock_cache_data;
+struct deadlock_stats_data;
+struct knowledge_data;
+struct perimeter_data;
+struct dragonfly_data;
+struct tree;
+struct helper;
+
+// the largest search table (besides the trees) that plan_table_sizes allocates, as log2 of its entries
+#define MAX_TABLE_LOG_SIZE 30
+
+typedef struct level_context
+{
+	// level identity and results
+	int level_id;
+	char level_title[1000];
+	char fail_reason[50];
+	int start_time, end_time;
+	UINT_64 start_ms, end_ms; // monotonic, used for time control
+	int any_core_solved;
+	int level_sol_moves;
+	int level_sol_pushes;
+
+	// geometry
+	int height;
+	int width;
+	board initial_board;
+	board inner;
+	int_board y_x_to_index_table;
+	int index_to_x[MAX_INNER];
+	int index_to_y[MAX_INNER];
+	int index_num;
+	int initial_sokoban_y, initial_sokoban_x;
+	int boxes_in_level;
+
+	// distances (see distance.h)
+	UINT_16 *distance_from_to;
+	UINT_16 *bfs_distance_from_to;
+	size_t distance_table_size;
+	int impossible_place[MAX_INNER];
+
+	// deadlock tunnels and holes
+	board forbidden_push_tunnel;
+	board forbidden_pull_tunnel;
+	board target_holes;
+	board semi_holes;
+
+	// rooms
+	int_board rooms_board;
+	int rooms_num;
+	int base_graph[MAX_ROOMS][MAX_ROOMS];
+
+	int snail_level_detected;
+	int netlock_level_detected;
+
+	// bumped when a stuck pattern or a k-dist entry is learned (see move_is_deadlocked)
+	int learned_deadlocks;
+
+	// data that is private to a module
+	struct hotspot_data        *hotspot;
+	struct rooms_deadlock_data *rooms_deadlock;
+	struct mpdb_data           *mpdb;
+	struct stuck_data          *stuck;
+	struct k_dist_data         *k_dist;
+	struct girl_data           *girl;
+	struct snail_data          *snail;
+	struct envelope_data       *envelope;
+	struct deadlock_stats_data *deadlock_stats;
+	struct knowledge_data      *knowledge;
+
+	// search tables, and the log2 of their number of entries (see plan_table_sizes)
+	int workers_num; // one search tree and helper per worker
+	int tree_log_size;
+	int perimeter_log_size;
+	int deadlock_cache_log_size;
+	int dragonfly_log_size;
+
+	struct deadlock_cache_data *deadlock_cache;
+	struct perimeter_data      *perimeter;
+	struct dragonfly_data      *dragonfly;
+	struct tree                *search_trees;
+	struct helper              *helpers;
+} level_context;
+
+extern THREAD_LOCAL level_context *current_level;
+
+level_context *allocate_level_context();
+void allocate_search_tables(level_context *l, int workers_num);
+void free_level_context(level_context *l);
+
+#endif
@@ -17,7 +17,7 @@ void lurd_to_moves(char* lurd, move* moves)
 	score_element base_score;
 	score_element *scores = 0;
 
-	copy_board(initial_board, b);
+	copy_board(current_level->initial_board, b);
 
 	get_sokoban_position(b, &player_y, &player_x);
 
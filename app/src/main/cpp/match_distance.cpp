@@ -20,6 +20,7 @@ void compute_match_distance(board b,
 	box_mat mat;
 	box_mat mat2;
 	int from, to;
+	UINT_16 *row;
 	hungarian_cache *hc;
 
 	hc   = allocate_hungarian_cache();
@@ -30,8 +31,11 @@ void compute_match_distance(board b,
 	if (boxes_num != targets_num) exit_with_error("box num mismatch1");
 
 	for (i = 0; i < boxes_num; i++)
+	{
+		row = get_push_distance_row(boxes_indices[i]);
 		for (j = 0; j < targets_num; j++)
-			mat[i][j] = distance_from_to[boxes_indices[i]][targets_indices[j]];
+			mat[i][j] = unpack_distance(row[targets_indices[j]]);
+	}
 
 	solve_hungarian(boxes_num, mat, &sol, hc);
 
@@ -59,15 +63,16 @@ void compute_match_distance(board b,
 
 		if (i == boxes_num) exit_with_error("internal error");
 
+		row = get_push_distance_row(to);
 		for (j = 0; j < targets_num; j++)
-			mat2[i][j] = distance_from_to[to][targets_indices[j]];
+			mat2[i][j] = unpack_distance(row[targets_indices[j]]);
 
 		solve_hungarian(boxes_num, mat2, &sol, hc);
 
 		scores[t].dist_to_targets = sol.weight;
 	}
 
-	free(hc);
+	free_hungarian_cache(hc);
 }
 
 
@@ -84,6 +89,7 @@ void compute_imagine_distance(board b,
 	box_mat mat;
 	box_mat mat2;
 	int from, to;
+	UINT_16 *row;
 	int relevant_board;
 
 	hungarian_cache *hc;
@@ -107,8 +113,9 @@ void compute_imagine_distance(board b,
 	for (i = 0; i < boxes_num; i++)
 	{
 		from = boxes_indices[i];
+		row = get_push_distance_row(from);
 		for (j = 0; j < targets_num; j++)
-			mat[i][j] = distance_from_to[from][targets_indices[j]];
+			mat[i][j] = unpack_distance(row[targets_indices[j]]);
 
 		// add special treatment for frozen 2x2 boxes
 		if (is_box_2x2_frozen_at_index(b, from))
@@ -143,8 +150,9 @@ void compute_imagine_distance(board b,
 
 		if (i == boxes_num) exit_with_error("internal error");
 
+		row = get_push_distance_row(to);
 		for (j = 0; j < targets_num; j++)
-			mat2[i][j] = distance_from_to[to][targets_indices[j]];
+			mat2[i][j] = unpack_distance(row[targets_indices[j]]);
 
 		// add special treatment if the box becomes 2x2 frozen
 		if (is_box_2x2_frozen_after_move(b, moves + t))
@@ -158,7 +166,7 @@ void compute_imagine_distance(board b,
 		scores[t].dist_to_imagined = sol.weight;
 	}
 
-	free(hc);
+	free_hungarian_cache(hc);
 }
 
 
@@ -173,6 +181,7 @@ void compute_base_distance(board b,
 	box_mat *mat;
 	box_mat *mat2;
 	int from, to;
+	UINT_16 *row;
 	hungarian_cache *hc;
 
 	hc = allocate_hungarian_cache();
@@ -186,10 +195,13 @@ void compute_base_distance(board b,
 
 	if (boxes_num != bases_num) exit_with_error("box num mismatch3");
 
-	for (i = 0; i < boxes_num; i++)
-		for (j = 0; j < bases_num; j++)
-			(*mat)[i][j] = distance_from_to[bases_indices[j]][boxes_indices[i]];
+	for (j = 0; j < bases_num; j++)
+	{
+		row = get_push_distance_row(bases_indices[j]);
+		for (i = 0; i < boxes_num; i++)
+			(*mat)[i][j] = unpack_distance(row[boxes_indices[i]]);
 			// note reversed j,i . mat[i][j] is the distance from base j to box i
+	}
 
 	solve_hungarian(boxes_num, *mat, &sol, hc);
 
@@ -218,14 +230,14 @@ void compute_base_distance(board b,
 		if (i == boxes_num) exit_with_error("internal error");
 
 		for (j = 0; j < bases_num; j++)
-			(*mat2)[i][j] = distance_from_to[bases_indices[j]][to];
+			(*mat2)[i][j] = get_push_distance(bases_indices[j], to);
 
 		solve_hungarian(boxes_num, *mat2, &sol, hc);
 
 		scores[t].dist_to_targets = sol.weight;
 	}
 
-	free(hc);
+	free_hungarian_cache(hc);
 	free(mat);
 	free(mat2);
 }
@@ -234,7 +246,7 @@ void compute_base_distance(board b,
 
 void compute_rev_distance(board b,
 	score_element* base_score, int moves_num, move* moves, score_element* scores,
-	board base_board, int from_to_mat[MAX_INNER][MAX_INNER])
+	board base_board)
 {
 	/*
 	This is a similar code to "compute_base_distance" , but the base position
@@ -250,6 +262,7 @@ void compute_rev_distance(board b,
 	box_mat mat;
 	box_mat mat2;
 	int from, to;
+	UINT_16 *row;
 	hungarian_cache* hc;
 
 	hc = allocate_hungarian_cache();
@@ -259,9 +272,12 @@ void compute_rev_distance(board b,
 
 	if (boxes_num != bases_num) exit_with_error("box num mismatch4");
 
-	for (i = 0; i < boxes_num; i++)
-		for (j = 0; j < bases_num; j++)
-			mat[i][j] = from_to_mat[bases_indices[j]][boxes_indices[i]];
+	for (j = 0; j < bases_num; j++)
+	{
+		row = get_push_distance_row(bases_indices[j]);
+		for (i = 0; i < boxes_num; i++)
+			mat[i][j] = unpack_distance(row[boxes_indices[i]]);
+	}
 	// note reversed j,i . mat[i][j] is the distance from base j to box i
 
 	solve_hungarian(boxes_num, mat, &sol, hc);
@@ -291,12 +307,12 @@ void compute_rev_distance(board b,
 		if (i == boxes_num) exit_with_error("internal error");
 
 		for (j = 0; j < bases_num; j++)
-			mat2[i][j] = from_to_mat[bases_indices[j]][to];
+			mat2[i][j] = get_push_distance(bases_indices[j], to);
 
 		solve_hungarian(boxes_num, mat2, &sol, hc);
 
 		scores[t].dist_to_imagined = sol.weight;
 	}
 
-	free(hc);
+	free_hungarian_cache(hc);
 }
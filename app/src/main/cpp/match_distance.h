@@ -14,4 +14,4 @@ void compute_base_distance(board b,
 
 void compute_rev_distance(board b,
 	score_element* base_score, int moves_num, move* moves, score_element* scores,
-	board base_board, int from_to_mat[MAX_INNER][MAX_INNER]);
+	board base_board);
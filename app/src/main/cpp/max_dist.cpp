@@ -19,7 +19,7 @@ void set_max_dist_data_in_node(tree* t, expansion_data* e, helper* h)
 		moves[i] = mh[i].move;
 		get_score_of_hash(t, mh[i].hash, scores + i);
 	}
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 
 	compute_match_distance(b, &(e->node->score), e->moves_num, moves, scores);
 
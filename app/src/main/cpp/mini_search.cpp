@@ -8,48 +8,18 @@
 int debug_mini_search = 0;
 
 
-int get_move_with_most_packing(position *positions, int pos_num, int *son)
+int is_better_packing_score(score_element *new_score, score_element *old_score)
 {
-	int i, j;
-	position *p;
-	int max_boxes_on_targets = -1;
-	int best_pos = -1;
-	int best_connectivity = 1000000;
+	if (new_score->boxes_on_targets > old_score->boxes_on_targets) return 1;
+	if (new_score->boxes_on_targets < old_score->boxes_on_targets) return 0;
 
-	for (i = 0; i < pos_num; i++)
-	{
-		p = positions + i;
-		if (p->position_deadlocked) continue;
+	if (new_score->connectivity < old_score->connectivity) return 1;
+	return 0;
+}
 
-		for (j = 0; j < p->moves_num; j++)
-		{
-			if (p->move_deadlocked[j]) continue;
-			if (p->place_in_positions[j]) continue;
-
-			if (p->scores[j].boxes_on_targets < max_boxes_on_targets)
-				continue;
-
-			if (p->scores[j].boxes_on_targets > max_boxes_on_targets)
-			{
-				max_boxes_on_targets = p->scores[j].boxes_on_targets;
-				best_pos = i;
-				*son = j;
-				best_connectivity = p->scores[j].connectivity;
-				continue;
-			}
-
-			if (p->scores[j].boxes_on_targets != max_boxes_on_targets)
-				exit_with_error("bad flow");
-
-			if (p->scores[j].connectivity < best_connectivity)
-			{
-				best_pos = i;
-				*son = j;
-				best_connectivity = p->scores[j].connectivity;
-			}
-		}
-	}
-	return best_pos;
+int get_move_with_most_packing(position *positions, int pos_num, int *son)
+{
+	return best_frontier_move(positions, pos_num, son, is_better_packing_score);
 }
 
 int has_a_move_with_all_boxes_packed(position *p)
@@ -142,7 +112,7 @@ int can_put_all_on_targets(board b, int max_size)
 		
 	}
 
-	free_positions(positions, max_size);
+	free_positions(positions);
 
 	return res;
 }
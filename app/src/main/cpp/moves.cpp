@@ -106,9 +106,9 @@ void get_possible_places(board b, int pull_mode, int search_mode, board possible
 	// set situation-specific possible places for boxes
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			possible[i][j] = inner[i][j];
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			possible[i][j] = current_level->inner[i][j];
 
 	if (pull_mode == 0)
 	{
@@ -209,7 +209,7 @@ int find_possible_moves(board b_input, move *moves, int pull_mode,
 		if (pull_mode == 0)
 			*has_corral = detect_corral(b, corral_options);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 
@@ -247,13 +247,13 @@ int find_possible_moves(board b_input, move *moves, int pull_mode,
 		if (moves_num > (MAX_MOVES - MAX_SIZE * MAX_SIZE))
 		{
 			if (verbose >= 4) printf("too many moves: %d moves\n", moves_num);
-			sprintf(global_fail_reason, "Too many moves");
+			sprintf(current_level->fail_reason, "Too many moves");
 			break; // do not produce other moves
 		}
 
 	}
 
-	free(gd);
+	free_graph(gd);
 
 	if (search_mode == BASE_SEARCH)
 		moves_num = mark_sink_squares_moves(b, moves, moves_num);
@@ -310,6 +310,61 @@ void apply_move(board b, move *m, int search_type)
 		update_deadlock_zone(b, m->pull);
 }
 
+void prepare_move_parent(board b, UINT_64 hash, move_parent *parent)
+{
+	copy_board(b, parent->b);
+	copy_board(b, parent->without_sokoban);
+	parent->hash = hash;
+	parent->sokoban_hash = clear_sokoban_and_hash(parent->without_sokoban);
+}
+
+UINT_64 apply_move_and_hash(move_parent *parent, move *m, int search_type, board c)
+{
+	// same as applying the move to a copy of the parent, but also returns the hash of the new
+	// board. Only the squares that changed are rehashed, and the new cloud replaces the old one.
+
+	int y, x, p;
+	UINT_64 hash;
+
+	if ((m->kill) || (search_type == DEADLOCK_SEARCH))
+	{
+		// these moves change too many bits, rehash the board
+		copy_board(parent->b, c);
+		apply_move(c, m, search_type);
+		return get_board_hash(c);
+	}
+
+	copy_board(parent->without_sokoban, c);
+	hash = parent->hash ^ parent->sokoban_hash;
+
+	index_to_y_x(m->from, &y, &x); // box to push: initial position
+
+	if ((c[y][x] & BOX) == 0) exit_with_error("missing box2");
+	c[y][x] &= ~BOX;
+	hash ^= get_square_hash(y, x, BOX);
+
+	index_to_y_x(m->to, &y, &x); // box to push: final position
+
+	if (c[y][x] & OCCUPIED) exit_with_error("occupied place");
+
+	if (m->base == 1)
+	{
+		if ((c[y][x] & BASE) == 0) exit_with_error("no base in apply");
+		c[y][x] &= ~BASE;
+		hash ^= get_square_hash(y, x, BASE);
+	}
+	else
+	{
+		c[y][x] |= BOX;
+		hash ^= get_square_hash(y, x, BOX);
+	}
+
+	p = m->sokoban_position;
+	hash ^= expand_sokoban_cloud_from(c, y + delta_y[p], x + delta_x[p]);
+
+	return hash;
+}
+
 
 void print_move(move *m)
 {
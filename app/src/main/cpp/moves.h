@@ -11,6 +11,19 @@
 int find_possible_moves(board b, move *moves, int pull_mode, int *has_corral, int search_mode, helper *h);
 void apply_move(board b, move *m, int search_mode);
 
+// A board whose children are derived from it (see apply_move_and_hash). It is prepared once,
+// and each child starts from a copy of the board without its sokoban cloud.
+typedef struct
+{
+	board b;
+	board without_sokoban;
+	UINT_64 hash;
+	UINT_64 sokoban_hash; // the part of the hash that comes from the sokoban cloud
+} move_parent;
+
+void prepare_move_parent(board b, UINT_64 hash, move_parent *parent);
+UINT_64 apply_move_and_hash(move_parent *parent, move *m, int search_mode, board c);
+
 void print_move(move *m);
 
 int attr_to_weight(move_attr *a);
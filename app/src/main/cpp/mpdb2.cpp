@@ -13,34 +13,47 @@
 #include "deadlock.h"
 #include "mini_search.h"
 #include "xy_deadlock.h"
+#include "knowledge.h"
 
 #define MAX_MPDB_PATTERNS 50
 
-int mpdb_list[MAX_MPDB_PATTERNS][2];
-int mpdb_num = 0;
+typedef struct mpdb_data
+{
+	int mpdb_list[MAX_MPDB_PATTERNS][2];
+	int mpdb_num;
+	board mpdb_board;
+
+	int pull_mpdb_list[MAX_MPDB_PATTERNS][2];
+	int pull_mpdb_num;
+	board pull_mpdb_board;
+} mpdb_data;
 
-board mpdb_board;
+void allocate_mpdb_data(level_context *l)
+{
+	l->mpdb = (mpdb_data*)calloc(1, sizeof(mpdb_data));
+	if (l->mpdb == 0) exit_with_error("can't allocate mpdb data\n");
+}
 
 void add_to_mpdb(int index1, int index2)
 {
 	int y, x;
 
-	mpdb_list[mpdb_num][0] = index1;
-	mpdb_list[mpdb_num][1] = index2;
+	current_level->mpdb->mpdb_list[current_level->mpdb->mpdb_num][0] = index1;
+	current_level->mpdb->mpdb_list[current_level->mpdb->mpdb_num][1] = index2;
 
-	mpdb_num++;
+	current_level->mpdb->mpdb_num++;
 
 	index_to_y_x(index1, &y, &x); 
-	mpdb_board[y][x] = 1;
+	current_level->mpdb->mpdb_board[y][x] = 1;
 	index_to_y_x(index2, &y, &x);
-	mpdb_board[y][x] = 1;
+	current_level->mpdb->mpdb_board[y][x] = 1;
 
 
-	if (mpdb_num >= MAX_MPDB_PATTERNS)
+	if (current_level->mpdb->mpdb_num >= MAX_MPDB_PATTERNS)
 	{
 		if (verbose >= 4)
 			printf("mpdb overflow !\n");
-		mpdb_num--;
+		current_level->mpdb->mpdb_num--;
 	}
 }
 
@@ -53,12 +66,12 @@ int is_mpdb_deadlock(board b, int pull_mode)
 	if (pull_mode)
 		return is_pull_mpdb_deadlock(b);
 
-	for (i = 0; i < mpdb_num; i++)
+	for (i = 0; i < current_level->mpdb->mpdb_num; i++)
 	{
-		index_to_y_x(mpdb_list[i][0], &y, &x);
+		index_to_y_x(current_level->mpdb->mpdb_list[i][0], &y, &x);
 		if ((b[y][x] & BOX) == 0) continue;
 
-		index_to_y_x(mpdb_list[i][1], &y, &x);
+		index_to_y_x(current_level->mpdb->mpdb_list[i][1], &y, &x);
 		if ((b[y][x] & BOX) == 0) continue;
 
 		return 1;
@@ -72,8 +85,8 @@ int two_near_wall(board b_in)
 {
 	int i, j, a, b;
 	int n_box, n_wall;
-	for (i = 0; i < (height - 1); i++)
-		for (j = 0; j < (width - 1); j++)
+	for (i = 0; i < (current_level->height - 1); i++)
+		for (j = 0; j < (current_level->width - 1); j++)
 		{
 			n_box = 0;
 			n_wall = 0;
@@ -92,8 +105,8 @@ int two_near_wall(board b_in)
 int check_known_deadlock(board b)
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 			
@@ -108,25 +121,25 @@ void build_mpdb2()
 	int i, j,y,x;
 	board empty_board, b;
 
-	mpdb_num = 0;
-	zero_board(mpdb_board);
+	current_level->mpdb->mpdb_num = 0;
+	zero_board(current_level->mpdb->mpdb_board);
 
-	if (global_boxes_in_level == 1) return;
+	if (current_level->boxes_in_level == 1) return;
 
-	clear_boxes(initial_board, empty_board);
+	clear_boxes(current_level->initial_board, empty_board);
 	clear_sokoban_inplace(empty_board);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
-		if (impossible_place[i]) continue;
+		if (current_level->impossible_place[i]) continue;
 		index_to_y_x(i, &y, &x); 
-		if (forbidden_push_tunnel[y][x]) continue;
+		if (current_level->forbidden_push_tunnel[y][x]) continue;
 
-		for (j = i + 1; j < index_num; j++)
+		for (j = i + 1; j < current_level->index_num; j++)
 		{
-			if (impossible_place[j]) continue;
+			if (current_level->impossible_place[j]) continue;
 			index_to_y_x(j, &y, &x); 
-			if (forbidden_push_tunnel[y][x]) continue;
+			if (current_level->forbidden_push_tunnel[y][x]) continue;
 
 			if (double_blocking(i, j) == 0)
 				continue;
@@ -167,31 +180,26 @@ void build_mpdb2()
 
 
 
-int pull_mpdb_list[MAX_MPDB_PATTERNS][2];
-int pull_mpdb_num = 0;
-
-board pull_mpdb_board;
-
 void add_to_pull_mpdb(int index1, int index2)
 {
 	int y, x;
 
-	pull_mpdb_list[pull_mpdb_num][0] = index1;
-	pull_mpdb_list[pull_mpdb_num][1] = index2;
+	current_level->mpdb->pull_mpdb_list[current_level->mpdb->pull_mpdb_num][0] = index1;
+	current_level->mpdb->pull_mpdb_list[current_level->mpdb->pull_mpdb_num][1] = index2;
 
-	pull_mpdb_num++;
+	current_level->mpdb->pull_mpdb_num++;
 
 	index_to_y_x(index1, &y, &x);
-	pull_mpdb_board[y][x] = 1;
+	current_level->mpdb->pull_mpdb_board[y][x] = 1;
 	index_to_y_x(index2, &y, &x);
-	pull_mpdb_board[y][x] = 1;
+	current_level->mpdb->pull_mpdb_board[y][x] = 1;
 
 
-	if (pull_mpdb_num >= MAX_MPDB_PATTERNS)
+	if (current_level->mpdb->pull_mpdb_num >= MAX_MPDB_PATTERNS)
 	{
 		if (verbose >= 4)
 			printf("pull mpdb overflow !\n");
-		pull_mpdb_num--;
+		current_level->mpdb->pull_mpdb_num--;
 	}
 }
 
@@ -212,32 +220,32 @@ void build_pull_mpdb2()
 	int i, j, y1, x1, y2, x2, d;
 	board empty_board, b;
 
-	pull_mpdb_num = 0;
-	zero_board(pull_mpdb_board);
+	current_level->mpdb->pull_mpdb_num = 0;
+	zero_board(current_level->mpdb->pull_mpdb_board);
 
-	if (global_boxes_in_level == 1) return;
+	if (current_level->boxes_in_level == 1) return;
 
-	clear_boxes(initial_board, empty_board);
+	clear_boxes(current_level->initial_board, empty_board);
 	clear_sokoban_inplace(empty_board);
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
-		if (impossible_place[i]) continue;
+		if (current_level->impossible_place[i]) continue;
 		index_to_y_x(i, &y1, &x1);
-		if (forbidden_pull_tunnel[y1][x1]) continue;
+		if (current_level->forbidden_pull_tunnel[y1][x1]) continue;
 
-		for (j = i + 1; j < index_num; j++)
+		for (j = i + 1; j < current_level->index_num; j++)
 		{
-			if (impossible_place[j]) continue;
+			if (current_level->impossible_place[j]) continue;
 			index_to_y_x(j, &y2, &x2);
-			if (forbidden_pull_tunnel[y2][x2]) continue;
+			if (current_level->forbidden_pull_tunnel[y2][x2]) continue;
 
 			if ((y1 != y2) && (x1 != x2)) continue;
 
 			d = abs(y1 - y2) + abs(x1 - x2);
 			if (d == 1) continue;
 			if (d >= 10) continue;
-			if (bfs_distance_from_to[i][j] != d) continue;
+			if (get_bfs_distance(i, j) != d) continue;
 
 			copy_board(empty_board, b);
 			b[y1][x1] |= BOX;
@@ -270,15 +278,65 @@ int is_pull_mpdb_deadlock(board b)
 {
 	int i, y, x;
 
-	for (i = 0; i < pull_mpdb_num; i++)
+	for (i = 0; i < current_level->mpdb->pull_mpdb_num; i++)
 	{
-		index_to_y_x(pull_mpdb_list[i][0], &y, &x);
+		index_to_y_x(current_level->mpdb->pull_mpdb_list[i][0], &y, &x);
 		if ((b[y][x] & BOX) == 0) continue;
 
-		index_to_y_x(pull_mpdb_list[i][1], &y, &x);
+		index_to_y_x(current_level->mpdb->pull_mpdb_list[i][1], &y, &x);
 		if ((b[y][x] & BOX) == 0) continue;
 
 		return 1;
 	}
 	return 0;
-}
\ No newline at end of file
+}
+
+
+int write_mpdb(FILE *fp, int pull_mode)
+{
+	int n;
+	int (*list)[2];
+
+	n    = (pull_mode ? current_level->mpdb->pull_mpdb_num  : current_level->mpdb->mpdb_num);
+	list = (pull_mode ? current_level->mpdb->pull_mpdb_list : current_level->mpdb->mpdb_list);
+
+	if (current_level->boxes_in_level == 1)
+		n = -1; // the pairs were not computed
+
+	if (write_kb_data(fp, &n, sizeof(int)) == 0) return 0;
+	if (n <= 0) return 1;
+	return write_kb_data(fp, list, sizeof(int) * 2 * n);
+}
+
+int read_mpdb(FILE *fp, int pull_mode)
+{
+	// returns 1 if the pairs were loaded, and need not be computed
+	int list[MAX_MPDB_PATTERNS][2];
+	int n, i;
+
+	if (read_kb_data(fp, &n, sizeof(int)) == 0) return 0;
+	if ((n < 0) || (n >= MAX_MPDB_PATTERNS)) return 0;
+	if (read_kb_data(fp, list, sizeof(int) * 2 * n) == 0) return 0;
+
+	for (i = 0; i < n; i++)
+		if ((list[i][0] < 0) || (list[i][0] >= current_level->index_num) ||
+			(list[i][1] < 0) || (list[i][1] >= current_level->index_num))
+			return 0;
+
+	if (pull_mode)
+	{
+		current_level->mpdb->pull_mpdb_num = 0;
+		zero_board(current_level->mpdb->pull_mpdb_board);
+		for (i = 0; i < n; i++)
+			add_to_pull_mpdb(list[i][0], list[i][1]);
+	}
+	else
+	{
+		current_level->mpdb->mpdb_num = 0;
+		zero_board(current_level->mpdb->mpdb_board);
+		for (i = 0; i < n; i++)
+			add_to_mpdb(list[i][0], list[i][1]);
+	}
+
+	return 1;
+}
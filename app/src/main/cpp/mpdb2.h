@@ -1,10 +1,16 @@
 // Festival Sokoban Solver
 // Copyright 2018-2020 Yaron Shoham
 
+#include <stdio.h>
+
 #include "board.h"
 #include "moves.h"
 
+void allocate_mpdb_data(level_context *l);
 void build_mpdb2();
 int is_mpdb_deadlock(board b, int pull_mode);
 
 void build_pull_mpdb2();
+
+int write_mpdb(FILE *fp, int pull_mode);
+int read_mpdb(FILE *fp, int pull_mode);
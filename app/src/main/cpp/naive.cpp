@@ -18,7 +18,7 @@ void set_naive_data_in_node(tree *t, expansion_data *e, helper *h)
 		moves[i] = mh[i].move;
 		get_score_of_hash(t, mh[i].hash, scores + i);
 	}
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 
 	if (t->pull_mode) 
 		compute_base_distance(b, &(e->node->score), e->moves_num, moves, scores);
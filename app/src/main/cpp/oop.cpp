@@ -1,4 +1,6 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "graph.h"
 #include "distance.h"
@@ -63,9 +65,9 @@ void get_oop_zone_for_step(int step, board oop, helper *h)
 		next_targets[y][x] = 1;
 	}
 
-	clear_boxes(initial_board, b);
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	clear_boxes(current_level->initial_board, b);
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (parked_boxes[i][j])
 				b[i][j] = WALL;
 
@@ -73,12 +75,12 @@ void get_oop_zone_for_step(int step, board oop, helper *h)
 
 	zero_board(oop);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if (b[i][j] == WALL) continue;
-			if (impossible_place[y_x_to_index(i, j)] == 1) continue;
+			if (current_level->impossible_place[y_x_to_index(i, j)] == 1) continue;
 			if (sources[i][j]) continue;
 
 			oop[i][j] = 1;
@@ -92,109 +94,176 @@ void get_oop_zone_for_step(int step, board oop, helper *h)
 int temp_val = 0;
 
 
-void set_oop_zones_range(board val, int from, int to, helper *h)
+void allocate_oop_zones(helper *h)
+{
+	oop_data *o = h->oop;
+	int steps_num;
+
+	if (o == 0) exit_with_error("missing oop");
+
+	// scores may ask for any number of packed boxes, so cover them all
+	steps_num = h->parking_order_num;
+	if (steps_num < current_level->boxes_in_level + 1)
+		steps_num = current_level->boxes_in_level + 1;
+
+	if ((steps_num > o->steps_num) || (current_level->index_num != o->index_num))
+	{
+		free(o->zone);
+		free(o->distance);
+
+		o->zone = (UINT_8*)malloc(steps_num * current_level->index_num);
+		o->distance = (int*)malloc(sizeof(int) * steps_num * current_level->index_num);
+		if ((o->zone == 0) || (o->distance == 0))
+			exit_with_error("can't alloc oop zones");
+
+		o->steps_num = steps_num;
+		o->index_num = current_level->index_num;
+	}
+
+	memset(o->zone, 0, o->steps_num * o->index_num);
+	memset(o->distance, 0, sizeof(int) * o->steps_num * o->index_num);
+}
+
+UINT_8 *get_oop_zone(int step, helper *h)
+{
+	return h->oop->zone + step * h->oop->index_num;
+}
+
+void board_to_oop_zone(board b, UINT_8 *zone)
+{
+	int i, y, x;
+
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		zone[i] = b[y][x];
+	}
+}
+
+void oop_zone_to_board(UINT_8 *zone, board b)
+{
+	int i, y, x;
+
+	zero_board(b);
+
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		b[y][x] = zone[i];
+	}
+}
+
+
+void set_oop_zones_range(UINT_8 *val, int from, int to, helper *h)
 {
 	int i;
 
 	if (h->oop == 0) exit_with_error("missing oop");
-	board *oop_zone_for_step = h->oop->oop_zone_for_step;
-	int_board *oop_zone_distance_for_step = h->oop->oop_zone_distance_for_step;
 
 	for (i = from; i < to; i++)
-		copy_board(val, oop_zone_for_step[i]);
+		memcpy(get_oop_zone(i, h), val, current_level->index_num);
 }
 
 
 
-void get_oop_distance_for_step(int_board dist, int step, helper *h)
+void set_oop_distance_for_step(int step, helper *h)
 {
-	board parked, empty_board;
-	int i, j;
+	board parked, empty_board, zone;
+	int_board dist;
+	int i, j, y, x;
+	int *distance;
 
 	if (h->oop == 0) exit_with_error("missing oop1");
-	board *oop_zone_for_step = h->oop->oop_zone_for_step;
-	int_board *oop_zone_distance_for_step = h->oop->oop_zone_distance_for_step;
-
 
 	get_parked_boxes(parked, step, h); // 0: initial boxes are optional
 
-	clear_boxes(initial_board, empty_board);
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	clear_boxes(current_level->initial_board, empty_board);
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (parked[i][j])
 				empty_board[i][j] = WALL;
 
-	find_distance_from_a_group(empty_board, oop_zone_for_step[step], dist, 0); // 0 - push mode
+	oop_zone_to_board(get_oop_zone(step, h), zone);
+	find_distance_from_a_group(empty_board, zone, dist, 0); // 0 - push mode
+
+	distance = h->oop->distance + step * current_level->index_num;
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		distance[i] = dist[y][x];
+	}
 }
 
 
 void prepare_oop_zones(helper *h)
 {
 	int i;
-	int_board dist;
+	board zone;
+	UINT_8 current_zone[MAX_INNER];
 
-	if (h->oop == 0) exit_with_error("missing oop2");
-	board *oop_zone_for_step = h->oop->oop_zone_for_step;
-	int_board *oop_zone_distance_for_step = h->oop->oop_zone_distance_for_step;
+	allocate_oop_zones(h);
 
 	for (i = 0; i < (h->parking_order_num - 1); i++)
-		get_oop_zone_for_step(i, oop_zone_for_step[i], h);
+	{
+		get_oop_zone_for_step(i, zone, h);
+		board_to_oop_zone(zone, get_oop_zone(i, h));
+	}
 
-	// oop_zone_for_step shows the impossible places after putting the box in step i
+	// the oop zone for step i shows the impossible places after putting the box in step i
 	// since we want to clear boxes before that happens, we will look at the next change
 
-	board current_board;
-	zero_board(current_board);
+	memset(current_zone, 0, current_level->index_num);
 	int last_modified = 0;
 
 	for (i = 0; i < (h->parking_order_num - 1); i++)
 	{
 		// we want to clear boxes away from OOP areas as soon as possible.
-		// at this point oop_zone_for_step[i] is the last minute
+		// at this point the oop zone for step i is the last minute
 
-		if (is_same_board(oop_zone_for_step[i], current_board))
+		if (memcmp(get_oop_zone(i, h), current_zone, current_level->index_num) == 0)
 			continue;
 
-		copy_board(oop_zone_for_step[i], current_board);
-//		get_oop_distance_for_step(dist, i, h);
+		memcpy(current_zone, get_oop_zone(i, h), current_level->index_num);
 
 		if (verbose >= 5)
 		{
 			printf("modifying board at step %d last=%d\n", i, last_modified);
-			show_on_initial_board(current_board);
-			show_ints_on_initial_board(dist);
+			oop_zone_to_board(current_zone, zone);
+			show_on_initial_board(zone);
 		}
 
-//		set_oop_zones_range(current_board, dist, last_modified, i + 1, h);
-		set_oop_zones_range(current_board, last_modified, i + 1, h);
+		set_oop_zones_range(current_zone, last_modified, i + 1, h);
 
 		last_modified = i;
 	}
 
 	for (i = 0; i < (h->parking_order_num - 1); i++)
-		get_oop_distance_for_step(oop_zone_distance_for_step[i], i, h);
+		set_oop_distance_for_step(i, h);
 
 	/*
 	for (i = 0; i < (h->parking_order_num - 1); i++)
 	{
 		printf("oop for step %d:\n", i);
-		show_on_initial_board(oop_zone_for_step[i]);
+		oop_zone_to_board(get_oop_zone(i, h), zone);
+		show_on_initial_board(zone);
 	}
 	my_getch();
 	*/
 }
 
 
-int count_boxes_in_oop_zone(board b, board oop)
+int count_boxes_in_oop_zone(board b, UINT_8 *zone)
 {
-	int i, j;
+	int i, y, x;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (oop[i][j])
-				if (b[i][j] & BOX)
-					sum++;
+	for (i = 0; i < current_level->index_num; i++)
+		if (zone[i])
+		{
+			index_to_y_x(i, &y, &x);
+			if (b[y][x] & BOX)
+				sum++;
+		}
 
 	return sum;
 }
@@ -204,11 +273,11 @@ int get_out_of_plan_score(board b, int parked_num, helper *h)
 	int res;
 
 	if (h->oop == 0) exit_with_error("missing oop3");
-	board *oop_zone_for_step = h->oop->oop_zone_for_step;
-	int_board *oop_zone_distance_for_step = h->oop->oop_zone_distance_for_step;
 
+	if (parked_num >= h->oop->steps_num)
+		return 0; // no zones were prepared
 
-	res = count_boxes_in_oop_zone(b, oop_zone_for_step[parked_num]);
+	res = count_boxes_in_oop_zone(b, get_oop_zone(parked_num, h));
 	return res;
 }
 
@@ -217,7 +286,7 @@ int new_oop_advisor(board b, score_element *base_score,
 	int moves_num, move *moves, score_element *scores, int pull_mode, helper *h)
 {
 	int i;
-	int from, to, y, x;
+	int from, to;
 	int best_move = -1;
 	int min_from = 1000000;
 	int max_to = -1;
@@ -225,15 +294,18 @@ int new_oop_advisor(board b, score_element *base_score,
 	int min_rooms = 1000000;
 	int min_connect = 1000000;
 	int step = base_score->packed_boxes;
+	int *distance;
 
 	if (h->oop == 0) exit_with_error("missing oop");
-	board *oop_zone_for_step = h->oop->oop_zone_for_step;
-	int_board *oop_zone_distance_for_step = h->oop->oop_zone_distance_for_step;
-
 
 	if (base_score->out_of_plan == 0)
 		return -1;
 
+	if (step >= h->oop->steps_num)
+		return -1;
+
+	distance = h->oop->distance + step * h->oop->index_num;
+
 	min_connect = base_score->connectivity;
 	min_rooms = base_score->rooms_score;
 
@@ -248,13 +320,10 @@ int new_oop_advisor(board b, score_element *base_score,
 		to = moves[i].to;
 
 		// require reversible
-		if (distance_from_to[to][from] == 1000000) continue;
-
-		index_to_y_x(from, &y, &x);
-		from_dist = oop_zone_distance_for_step[step][y][x];
+		if (get_push_distance(to, from) == 1000000) continue;
 
-		index_to_y_x(to, &y, &x);
-		to_dist = oop_zone_distance_for_step[step][y][x];
+		from_dist = distance[from];
+		to_dist = distance[to];
 
 		if (from_dist == 1000000) continue;
 		if (to_dist == 1000000) continue;
@@ -16,9 +16,9 @@ int are_new_moves(board b, board c, int pull_mode)
 	int val;
 	int sok_y, sok_x;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			// a box should be in (i,j) on both boards
 			if ((b[i][j] & BOX) == 0) continue;
@@ -61,7 +61,7 @@ int explorer(board b, score_element *base_score,
 	int best_move = -1;
 
 	zero_board(blocked_area);
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 	{
 		index_to_y_x(i, &y, &x);
 		if ((b[y][x] == 0) || (b[y][x] == TARGET)) // without SOKOABN
@@ -73,7 +73,7 @@ int explorer(board b, score_element *base_score,
 		if (scores[i].packed_boxes < base_score->packed_boxes) continue;
 
 		if (pull_mode == 0)
-		if (distance_from_to[moves[i].to][moves[i].from] == 1000000)
+		if (get_push_distance(moves[i].to, moves[i].from) == 1000000)
 			continue; // reject irreversible moves
 
 		copy_board(b, c);
@@ -141,8 +141,8 @@ int pick_opener(board b, score_element *base_score,
 		if (scores[i].connectivity > connectivity) continue;
 		if (scores[i].rooms_score  > rooms_score) continue;
 
-		dist1 = bfs_distance_from_to[blocker_index][moves[i].from];
-		dist2 = bfs_distance_from_to[blocker_index][moves[i].to];
+		dist1 = get_bfs_distance(blocker_index, moves[i].from);
+		dist2 = get_bfs_distance(blocker_index, moves[i].to);
 		if (dist2 < dist1) continue;
 
 		if (dist1 > min_dist_from) continue;
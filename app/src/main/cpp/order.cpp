@@ -89,8 +89,8 @@ int collect_remaining_boxes(board b)
 	int i, j;
 	int n = 0;
 
-	for (i = 0 ; i < height ; i++)
-		for (j = 0 ; j < width ; j++)
+	for (i = 0 ; i < current_level->height ; i++)
+		for (j = 0 ; j < current_level->width ; j++)
 			if (b[i][j] & BOX)
 				order_level[current][n++] = y_x_to_index(i, j);
 	return n;
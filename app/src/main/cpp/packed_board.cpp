@@ -0,0 +1,220 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#include <string.h>
+
+#include "packed_board.h"
+#include "util.h"
+
+#define VARIABLE_BITS (BOX | SOKOBAN | BASE | DEADLOCK_ZONE)
+
+// flags in the first byte of a packed board
+#define PACKED_RAW            1 // the board does not match the fixed board, stored byte per square
+#define PACKED_BASES          2
+#define PACKED_DEADLOCK_ZONE  4
+#define PACKED_SOKOBAN_PLANE  8 // the sokoban squares are not closed regions, stored as a plane
+
+void set_fixed_board(board b, board fixed)
+{
+	int i, j;
+
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
+	{
+		fixed[i][j] = b[i][j];
+		if (current_level->inner[i][j])
+			fixed[i][j] &= ~VARIABLE_BITS;
+	}
+}
+
+int get_plane_size()
+{
+	return (current_level->index_num + 7) / 8;
+}
+
+int get_max_packed_board_size()
+{
+	return 1 + current_level->height * current_level->width;
+}
+
+int pack_plane(board b, int bit, UINT_8 *data)
+{
+	int i, y, x;
+	int size = get_plane_size();
+
+	memset(data, 0, size);
+
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		if (b[y][x] & bit)
+			data[i >> 3] |= (1 << (i & 7));
+	}
+	return size;
+}
+
+int unpack_plane(UINT_8 *data, int bit, board b)
+{
+	int i, y, x;
+	int size = get_plane_size();
+
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		if (data[i >> 3] & (1 << (i & 7)))
+		{
+			index_to_y_x(i, &y, &x);
+			b[y][x] |= bit;
+		}
+	}
+	return size;
+}
+
+int get_sokoban_regions(board b, UINT_16 *regions, int max_regions)
+{
+	// returns one square per sokoban region, or -1 if a region is not closed
+	// (a free square next to it is not marked) or there are too many regions.
+
+	int queue[MAX_INNER];
+	int queue_len, queue_pos;
+	board seen;
+	int i, j, y, x, next_y, next_x;
+	int regions_num = 0;
+
+	zero_board(seen);
+
+	for (i = 0; i < current_level->index_num; i++)
+	{
+		index_to_y_x(i, &y, &x);
+		if ((b[y][x] & SOKOBAN) == 0) continue;
+		if (seen[y][x]) continue;
+
+		if (regions_num == max_regions) return -1;
+		regions[regions_num++] = (UINT_16)i;
+
+		seen[y][x] = 1;
+		queue[0] = i;
+		queue_len = 1;
+		queue_pos = 0;
+
+		while (queue_pos < queue_len)
+		{
+			index_to_y_x(queue[queue_pos++], &y, &x);
+
+			for (j = 0; j < 4; j++)
+			{
+				next_y = y + delta_y[j];
+				next_x = x + delta_x[j];
+
+				if (b[next_y][next_x] & OCCUPIED) continue;
+				if ((b[next_y][next_x] & SOKOBAN) == 0) return -1;
+				if (seen[next_y][next_x]) continue;
+
+				seen[next_y][next_x] = 1;
+				queue[queue_len++] = y_x_to_index(next_y, next_x);
+			}
+		}
+	}
+	return regions_num;
+}
+
+int pack_board(board b, board fixed, UINT_8 *data)
+{
+	int i, j;
+	int pos = 1;
+	int any_bases = 0, any_deadlock_zone = 0;
+	int regions_num, max_regions;
+	UINT_16 regions[MAX_INNER];
+
+	for (i = 0; i < current_level->height; i++)
+	for (j = 0; j < current_level->width; j++)
+	{
+		if (current_level->inner[i][j] == 0)
+		{
+			if (b[i][j] != fixed[i][j]) break;
+			continue;
+		}
+		if ((b[i][j] & ~VARIABLE_BITS) != fixed[i][j]) break;
+		if (b[i][j] & BASE) any_bases = 1;
+		if (b[i][j] & DEADLOCK_ZONE) any_deadlock_zone = 1;
+	}
+
+	if (i < current_level->height)
+	{
+		data[0] = PACKED_RAW;
+		board_to_bytes(b, data + 1);
+		return 1 + current_level->height * current_level->width;
+	}
+
+	data[0] = 0;
+	pos += pack_plane(b, BOX, data + pos);
+
+	if (any_bases)
+	{
+		data[0] |= PACKED_BASES;
+		pos += pack_plane(b, BASE, data + pos);
+	}
+
+	if (any_deadlock_zone)
+	{
+		data[0] |= PACKED_DEADLOCK_ZONE;
+		pos += pack_plane(b, DEADLOCK_ZONE, data + pos);
+	}
+
+	// a region costs two bytes, use a plane when it is smaller
+	max_regions = (get_plane_size() - 1) / 2;
+	if (max_regions > 255) max_regions = 255;
+
+	regions_num = get_sokoban_regions(b, regions, max_regions);
+
+	if (regions_num == -1)
+	{
+		data[0] |= PACKED_SOKOBAN_PLANE;
+		pos += pack_plane(b, SOKOBAN, data + pos);
+		return pos;
+	}
+
+	data[pos++] = (UINT_8)regions_num;
+	for (i = 0; i < regions_num; i++)
+	{
+		data[pos++] = (UINT_8)(regions[i] & 0xff);
+		data[pos++] = (UINT_8)(regions[i] >> 8);
+	}
+	return pos;
+}
+
+void unpack_board(UINT_8 *data, board fixed, board b)
+{
+	int i, y, x;
+	int pos = 1;
+	int regions_num;
+
+	if (data[0] & PACKED_RAW)
+	{
+		bytes_to_board(data + 1, b);
+		return;
+	}
+
+	copy_board(fixed, b);
+
+	pos += unpack_plane(data + pos, BOX, b);
+
+	if (data[0] & PACKED_BASES)
+		pos += unpack_plane(data + pos, BASE, b);
+
+	if (data[0] & PACKED_DEADLOCK_ZONE)
+		pos += unpack_plane(data + pos, DEADLOCK_ZONE, b);
+
+	if (data[0] & PACKED_SOKOBAN_PLANE)
+	{
+		unpack_plane(data + pos, SOKOBAN, b);
+		return;
+	}
+
+	regions_num = data[pos++];
+	for (i = 0; i < regions_num; i++)
+	{
+		index_to_y_x(data[pos] | (data[pos + 1] << 8), &y, &x);
+		pos += 2;
+		expand_sokoban_cloud_from(b, y, x);
+	}
+}
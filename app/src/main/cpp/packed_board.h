@@ -0,0 +1,19 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#ifndef __PACKED_BOARD
+#define __PACKED_BOARD
+
+#include "board.h"
+
+// A packed board keeps only the bits that change during a search: one bit per inner square
+// for boxes (and for bases and deadlock zones, when present), plus one square per
+// sokoban region. Walls and targets are taken from a "fixed" board that is shared by all
+// the packed boards of a tree.
+
+void set_fixed_board(board b, board fixed);
+int get_max_packed_board_size();
+int pack_board(board b, board fixed, UINT_8 *data);
+void unpack_board(UINT_8 *data, board fixed, board b);
+
+#endif
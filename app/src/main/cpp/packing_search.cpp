@@ -38,7 +38,7 @@ int compute_start_zones(int_board start_zones)
 	board b;
 	int zones_num;
 
-	clear_boxes(initial_board, b);
+	clear_boxes(current_level->initial_board, b);
 	turn_targets_into_walls(b);
 
 	zones_num = mark_connectivities(b, start_zones);
@@ -78,7 +78,7 @@ void packing_search(board b_in, int time_allocation, int search_mode, tree *t, h
 	int iter_num = 0;
 	int i,res;
 	int cleared_all_targets = -1;
-	int local_start_time;
+	UINT_64 local_start_ms;
 	pack_request req;
 	int failed_cell = 0;
 	expansion_data *best_so_far = 0;
@@ -104,7 +104,7 @@ void packing_search(board b_in, int time_allocation, int search_mode, tree *t, h
 	t->pull_mode = 1;
 	t->search_mode = search_mode;
 
-	local_start_time = (int)time(0);
+	local_start_ms = get_time_in_ms();
 
 	h->perimeter_found = 0; // when perimeter is found, inefficent moves are allowed
 	h->enable_inefficient_moves = 0;
@@ -171,8 +171,8 @@ void packing_search(board b_in, int time_allocation, int search_mode, tree *t, h
 	{
 		iter_num++;
 
-		if (time_limit_exceeded(time_allocation, local_start_time)) break;
-		if (any_core_solved) break;
+		if (time_limit_exceeded(time_allocation, local_start_ms)) break;
+		if (current_level->any_core_solved) break;
 
 		testing_best = 0;
 
@@ -234,7 +234,7 @@ void packing_search(board b_in, int time_allocation, int search_mode, tree *t, h
 			printf("\n");
 		}
 
-		bytes_to_board(expanded_node->b, b);
+		get_expansion_board(expanded_node, b);
 
 		if (move_is_deadlocked(b, move_to_play, 1, search_mode)) // 1 - pull mode
 		{
@@ -335,11 +335,12 @@ void packing_search(board b_in, int time_allocation, int search_mode, tree *t, h
 			break;
 		}
 
-		if (tree_nearly_full(t))
+		if (tree_nearly_full(t, &best_so_far))
 		{
-			strcpy(global_fail_reason, "Max nodes reached");
+			strcpy(current_level->fail_reason, "Max nodes reached");
 			break;
 		}
+		new_node = last_expansion(t); // moved if the tree was compacted
 
 		prev_perimeter = h->perimeter_found;
 		if (check_if_perimeter_reached(t, h))
@@ -375,12 +376,15 @@ void packing_search(board b_in, int time_allocation, int search_mode, tree *t, h
 		best_so_far = t->expansions;
 	}
 
-	bytes_to_board(best_so_far->b, c);
+	get_expansion_board(best_so_far, c);
 	set_imagined_hf_board(c, h);
 
 
 	if (verbose >= 4)
+	{
 		printf("perimeter entries: %d\n", perimeter_entries);
+		print_request_stats(h);
+	}
 
 	conclude_parking(t, best_so_far, h);
 	
@@ -394,7 +398,7 @@ void packing_search(board b_in, int time_allocation, int search_mode, tree *t, h
 	if (verbose >= 4)
 	{
 		printf("\n");
-		printf("time=        %12d\n", (int)time(0) - local_start_time);
+		printf("time (ms)=   %12d\n", get_elapsed_ms(local_start_ms));
 		printf("expansions=  %12d\n", t->expansions_num);
 		printf("nodes=       %12d\n", t->nodes_num);
 		printf("move_hashes= %12d\n", t->move_hashes_num);
@@ -21,14 +21,14 @@ void show_parking_order_on_board(helper *h)
 	int i, j, k, index;
 	board b;
 
-	copy_board(initial_board, b);
+	copy_board(current_level->initial_board, b);
 
 	printf("parking order:\n\n");
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0)
+			if (current_level->inner[i][j] == 0)
 			{
 				if (b[i][j] == WALL)
 					printf("#");
@@ -116,14 +116,14 @@ void verify_parking_order(helper *h)
 
 	for (i = 0; i < parking_order_num; i++)
 	{
-		if ((parking_order[i].to >= index_num) || (parking_order[i].to < 0))
+		if ((parking_order[i].to >= current_level->index_num) || (parking_order[i].to < 0))
 		{
-			printf("parking order %d (to) is %d. index_num is:%d\n", i, parking_order[i].to, index_num);
+			printf("parking order %d (to) is %d. index_num is:%d\n", i, parking_order[i].to, current_level->index_num);
 			exit(0);
 		}
-		if (parking_order[i].from >= index_num)
+		if (parking_order[i].from >= current_level->index_num)
 		{
-			printf("parking order %d (from) is %d. index_num is:%d\n", i, parking_order[i].from, index_num);
+			printf("parking order %d (from) is %d. index_num is:%d\n", i, parking_order[i].from, current_level->index_num);
 			exit(0);
 		}
 	}
@@ -233,11 +233,11 @@ void get_parking_plan(tree *t, expansion_data *e, helper *h)
 	park_order_data *parking_order = h->parking_order;
 
 	// add initial boxes
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 
-	for (i = height - 1; i >= 0; i--)
+	for (i = current_level->height - 1; i >= 0; i--)
 	{
-		for (j = width - 1; j >= 0; j--)
+		for (j = current_level->width - 1; j >= 0; j--)
 			if (b[i][j] & BOX)
 			{
 				parking_order[n].from = -2;
@@ -330,7 +330,7 @@ void reduce_parking_order(helper *h)
 		if (parking_order[i].from == -2)
 			init_num++;
 
-	h->boxes_were_removed = (init_num == global_boxes_in_level ? 0 : 1);
+	h->boxes_were_removed = (init_num == current_level->boxes_in_level ? 0 : 1);
 
 	if (h->boxes_were_removed == 0)
 		keep_only_perm(h);
@@ -353,7 +353,7 @@ void conclude_parking(tree *t, expansion_data *e, helper *h)
 		return;
 	}
 
-	if (e->depth >= (MAX_SOL_LEN - global_boxes_in_level - 2))
+	if (e->depth >= (MAX_SOL_LEN - current_level->boxes_in_level - 2))
 	{
 		if (verbose >= 4)
 			printf("plan is too long\n");
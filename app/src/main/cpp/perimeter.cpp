@@ -4,67 +4,92 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#ifdef THREADS
-#include <pthread.h>
-#endif
-
 #include "global.h"
 #include "util.h"
 #include "perimeter.h"
 #include "io.h"
 
-typedef struct
+// The perimeter is shared by all the search threads without a lock.
+// A thread claims a free entry by a compare-and-swap of its hash from 0, and then
+// updates the entry's depth, side and alg, which are packed in one word, with another
+// compare-and-swap. An entry that was claimed but not updated yet has the empty info,
+// so readers see it as not in the perimeter.
+
+typedef struct // 16 bytes
 {
-	UINT_64 hash;
-	UINT_16 depth;
-	UINT_8  side;
-	UINT_8  alg;
+	volatile UINT_64 hash;
+	volatile unsigned int info; // depth | side << 16 | alg << 24
 } perimeter_entry;
 
-perimeter_entry *perimeter;
-int log_perimeter_size;
-unsigned int perimeter_mask;
-int total_perimeter_entries;
+#define PERIMETER_INFO(depth, side, alg) ((unsigned int)(depth) | ((unsigned int)(side) << 16) | ((unsigned int)(alg) << 24))
+#define INFO_DEPTH(info) ((info) & 0xffff)
+#define INFO_SIDE(info)  (((info) >> 16) & 0xff)
+#define INFO_ALG(info)   ((info) >> 24)
 
+#define EMPTY_INFO PERIMETER_INFO(0, 2, 255)
 
-void set_perimeter_size()
+typedef struct perimeter_data
 {
-	if (cores_num == 1) log_perimeter_size = 25;
-	if (cores_num == 2) log_perimeter_size = 26;
-	if (cores_num == 4) log_perimeter_size = 27;
-	if (cores_num == 8) log_perimeter_size = 28;
+	perimeter_entry *entries;
+	int log_size;
+	unsigned int mask;
+	int total_entries;
+
+	// statistics of claimed entries, for tuning the size
+	UINT_64 total_probes;
+	int max_probe;
+} perimeter_data;
+
+
+UINT_64 get_perimeter_memory(int log_size)
+{
+	return (UINT_64)sizeof(perimeter_entry) << log_size;
+}
+
+int get_perimeter_size()
+{
+	int log_size = 25 + get_cores_log();
 
 #ifdef VISUAL_STUDIO
-	log_perimeter_size = 24;
+	log_size = 24;
 #endif
 
-	log_perimeter_size += extra_mem;
+	return log_size + extra_mem;
 }
 
-void allocate_perimeter()
+void allocate_perimeter(level_context *l)
 {
+	perimeter_data *p;
 	size_t size;
 
-	set_perimeter_size();
+	p = (perimeter_data*)malloc(sizeof(perimeter_data));
+	if (p == 0)
+		exit_with_error("can't allocate perimeter");
+
+	p->log_size = l->perimeter_log_size;
 
-	size = sizeof(perimeter_entry) * (1ULL << log_perimeter_size);
+	size = sizeof(perimeter_entry) * (1ULL << p->log_size);
 
 	if (verbose >= 4)
 	{
 		printf("Allocating %12llu bytes for perimeter. ", (UINT_64)size);
-		printf("%d entries\n", 1 << log_perimeter_size);
+		printf("%d entries\n", 1 << p->log_size);
 	}
-	perimeter = (perimeter_entry *)malloc((size_t)size);
+	p->entries = (perimeter_entry *)malloc((size_t)size);
 
-	perimeter_mask = (1 << log_perimeter_size) - 1;
+	p->mask = (1 << p->log_size) - 1;
+	p->total_entries = 0;
 
-	if (perimeter == 0)
+	if (p->entries == 0)
 		exit_with_error("can't allocate perimeter");
+
+	l->perimeter = p;
 }
 
-void free_perimeter()
+void free_perimeter(level_context *l)
 {
-	free(perimeter);
+	free(l->perimeter->entries);
+	free(l->perimeter);
 }
 
 
@@ -73,54 +98,97 @@ void clear_perimeter()
 	int i;
 	perimeter_entry* p;
 
-	for (i = 0; i < (1 << log_perimeter_size); i++)
+	for (i = 0; i < (1 << current_level->perimeter->log_size); i++)
 	{
-		p = perimeter + i;
+		p = current_level->perimeter->entries + i;
 		p->hash = 0;
-		p->depth = 0;
-		p->side = 2;
-		p->alg = 255;
+		p->info = EMPTY_INFO;
 	}
-	total_perimeter_entries = 0;
+	current_level->perimeter->total_entries = 0;
+	current_level->perimeter->total_probes = 0;
+	current_level->perimeter->max_probe = 0;
+}
+
+void print_perimeter_stats()
+{
+	perimeter_data *p = current_level->perimeter;
+
+	printf("perimeter: %d/%d entries (%.2f%%), average probe %.2f, max probe %d\n",
+		p->total_entries, 1 << p->log_size, p->total_entries * 100.0 / (1 << p->log_size),
+		(p->total_entries ? (double)p->total_probes / p->total_entries : 0.0), p->max_probe);
 }
 
 perimeter_entry* get_entry_for_hash(UINT_64 hash)
 {
+	// returns the entry of the hash, or the free entry where it would be inserted
 	UINT_64 index;
 
-	index = hash >> (64 - log_perimeter_size);
+	index = hash >> (64 - current_level->perimeter->log_size);
 
-	while (perimeter[index].hash != 0)
+	while (current_level->perimeter->entries[index].hash != 0)
 	{
-		if (perimeter[index].hash == hash) break;
-		index = (index + 1) & perimeter_mask;
+		if (current_level->perimeter->entries[index].hash == hash) break;
+		index = (index + 1) & current_level->perimeter->mask;
 	}
-	return perimeter + index;
+	return current_level->perimeter->entries + index;
 }
 
+perimeter_entry* claim_entry_for_hash(UINT_64 hash)
+{
+	// returns the entry of the hash, inserting it if needed
+	UINT_64 index;
+	UINT_64 h;
+	int probe = 0;
+	int max_probe;
+	perimeter_data *pd = current_level->perimeter;
 
+	index = hash >> (64 - pd->log_size);
+
+	while (1)
+	{
+		h = pd->entries[index].hash;
+
+		if (h == hash)
+			return pd->entries + index;
+
+		if (h == 0)
+		{
+			if (ATOMIC_CAS_64(&pd->entries[index].hash, (UINT_64)0, hash))
+				break;
+			continue; // another thread took the entry, check it again
+		}
+
+		index = (index + 1) & pd->mask;
+		probe++;
+	}
+
+	ATOMIC_ADD(&pd->total_entries, 1);
+	ATOMIC_ADD_64(&pd->total_probes, (UINT_64)probe);
+
+	max_probe = pd->max_probe;
+	while ((probe > max_probe) && (ATOMIC_CAS_32(&pd->max_probe, max_probe, probe) == 0))
+		max_probe = pd->max_probe;
+
+	return pd->entries + index;
+}
 
-#ifdef THREADS
-pthread_mutex_t perimeter_mutex = PTHREAD_MUTEX_INITIALIZER;
-#endif
 
 UINT_64 get_hash_without_bases(tree* t, expansion_data* e, int son)
 {
 	// use son=-1 for the node itself
 	board b;
-	int place;
+	int place, y, x;
+	UINT_64 hash;
 	move_hash_data* mh;
 	node_element* node;
 
-	if (e->node->score.boxes_in_level != global_boxes_in_level)
+	if (e->node->score.boxes_in_level != current_level->boxes_in_level)
 		return 0xffffffff;
 
+	get_expansion_board(e, b);
+
 	if (son == -1)
-	{
-		bytes_to_board(e->b, b);
-		clear_bases_inplace(b);
-		return get_board_hash(b);
-	}
+		return e->node->hash ^ get_bases_hash(b);
 
 	mh = t->move_hashes + e->move_hash_place;
 
@@ -128,52 +196,69 @@ UINT_64 get_hash_without_bases(tree* t, expansion_data* e, int son)
 	if (place == -1) exit_with_error("missing node");
 	node = t->nodes + place;
 
-	if (node->score.boxes_in_level != global_boxes_in_level)
+	if (node->score.boxes_in_level != current_level->boxes_in_level)
 		return 0xffffffff;
 
-	bytes_to_board(e->b, b);
-	apply_move(b, &(mh[son].move), NORMAL);
+	if (t->search_mode == DEADLOCK_SEARCH)
+	{
+		apply_move(b, &(mh[son].move), NORMAL);
+		clear_bases_inplace(b);
+		return get_board_hash(b);
+	}
 
-	clear_bases_inplace(b);
-	return get_board_hash(b);
+	// the son has the father's bases, except for a base that was filled by the move
+	hash = mh[son].hash ^ get_bases_hash(b);
+	if ((mh[son].move.kill == 0) && (mh[son].move.base == 1))
+	{
+		index_to_y_x(mh[son].move.to, &y, &x);
+		hash ^= get_square_hash(y, x, BASE);
+	}
+	return hash;
 }
 
-void update_perimeter(perimeter_entry* p, int depth, int pull_mode, int alg)
+unsigned int get_updated_info(unsigned int info, int depth, int pull_mode, int alg)
 {
-	// update perimeter hash with a better (usually shallower) entry
+	// update perimeter info with a better (usually shallower) entry
 
 	// dragonfly nodes must not be explored twice. depth can be updated.
-	if (p->alg == DRAGONFLY)
+	if (INFO_ALG(info) == DRAGONFLY)
 	{
-		if (pull_mode && (depth < p->depth))
-			p->depth = depth;
-		return;
+		if (pull_mode && (depth < (int)INFO_DEPTH(info)))
+			return PERIMETER_INFO(depth, INFO_SIDE(info), DRAGONFLY);
+		return info;
 	}
 
-	if (p->side == pull_mode) // same direction
+	if (INFO_SIDE(info) == (unsigned int)pull_mode) // same direction
 	{
-		if (depth < p->depth)
-		{
-			p->depth = depth;
-			p->alg = alg;
-		}
-		return;
+		if (depth < (int)INFO_DEPTH(info))
+			return PERIMETER_INFO(depth, pull_mode, alg);
+		return info;
 	}
 
-	// so different directions. prioritize pull positions
+	// so different directions (or a new entry). prioritize pull positions
 
-	if (p->side == 1) return;
+	if (INFO_SIDE(info) == 1) return info;
 
-	p->side = pull_mode;
-	p->depth = depth;
-	p->alg = alg;
+	return PERIMETER_INFO(depth, pull_mode, alg);
+}
+
+void update_perimeter(perimeter_entry* p, int depth, int pull_mode, int alg)
+{
+	unsigned int info, new_info;
+
+	do
+	{
+		info = p->info;
+		new_info = get_updated_info(info, depth, pull_mode, alg);
+		if (new_info == info) return;
+	} while (ATOMIC_CAS_32(&p->info, info, new_info) == 0);
 }
 
 
 int perimeter_is_full()
 {
-	int limit = 1 << (log_perimeter_size - 1);
-	if (total_perimeter_entries < limit) return 0;
+	int limit = 1 << (current_level->perimeter->log_size - 1);
+	if (current_level->perimeter->total_entries < limit) return 0;
 	if (verbose >= 4) exit_with_error("perimeter is full\n");
 	return 1;
 }
@@ -184,7 +269,6 @@ int insert_node_into_perimeter(tree *t, expansion_data *e, int with_sons)
 	move_hash_data *mh;
 	int j;
 	int perimeter_entries = 0;
-	perimeter_entry *p;
 
 
 	if (perimeter_is_full()) return 0;
@@ -194,39 +278,14 @@ int insert_node_into_perimeter(tree *t, expansion_data *e, int with_sons)
 	else
 		hash = e->node->hash;
 
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&perimeter_mutex);
-#endif
-
-	p = get_entry_for_hash(hash);
-
-	if (p->hash != hash)
-	{
-		p->hash = hash;
-		p->depth = e->depth;
-		p->side = t->pull_mode;
-		p->alg = t->search_mode;
-		perimeter_entries++;
-		total_perimeter_entries++;
-	}
-	else // already in perimeter - check if depth can be improved
-	{
-		update_perimeter(p, e->depth, t->pull_mode, t->search_mode);
-		perimeter_entries++;
-	}
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&perimeter_mutex);
-#endif
+	update_perimeter(claim_entry_for_hash(hash), e->depth, t->pull_mode, t->search_mode);
+	perimeter_entries++;
 
 	if (with_sons == 0) 
 		return perimeter_entries;
 
 	mh = t->move_hashes + e->move_hash_place;
 
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&perimeter_mutex);
-#endif
-
 	for (j = 0; j < e->moves_num; j++)
 	{
 		if (t->search_mode == BASE_SEARCH)
@@ -234,28 +293,10 @@ int insert_node_into_perimeter(tree *t, expansion_data *e, int with_sons)
 		else
 			hash = mh[j].hash;
 
-		p = get_entry_for_hash(hash);
-
-		if (p->hash != hash)
-		{
-			p->hash  = hash;
-			p->depth = e->depth + 1;
-			p->side  = t->pull_mode;
-			p->alg   = t->search_mode;
-			perimeter_entries++;
-			total_perimeter_entries++;
-		}
-		else // already in perimeter - check if depth can be improved
-		{
-			update_perimeter(p, e->depth + 1, t->pull_mode, t->search_mode);
-			perimeter_entries++;
-		}
+		update_perimeter(claim_entry_for_hash(hash), e->depth + 1, t->pull_mode, t->search_mode);
+		perimeter_entries++;
 	}
 
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&perimeter_mutex);
-#endif
-
 	return perimeter_entries;
 }
 
@@ -264,29 +305,17 @@ int insert_node_into_perimeter(tree *t, expansion_data *e, int with_sons)
 int is_in_perimeter(UINT_64 hash, UINT_16 *depth, UINT_8 side)
 {
 	perimeter_entry *p;
-	int res = 0;
-
-
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&perimeter_mutex);
-#endif
+	unsigned int info;
 
 	p = get_entry_for_hash(hash);
 
-	if (p->hash == hash)
-	{
-		if (p->side == side)
-		{
-			*depth = p->depth;
-			res = 1;
-		}
-	}
+	if (p->hash != hash) return 0;
 
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&perimeter_mutex);
-#endif
+	info = p->info;
+	if (INFO_SIDE(info) != side) return 0;
 
-	return res;
+	*depth = INFO_DEPTH(info);
+	return 1;
 }
 
 int cyclic_level_exception(tree *t)
@@ -389,29 +418,31 @@ int check_if_perimeter_reached(tree *t, helper *h)
 void dragonfly_mark_visited_hashes(UINT_64 *hashes, int n, int *visited)
 {
 	int i;
+	unsigned int info;
 
 	perimeter_entry* p;
 
 	for (i = 0; i < n; i++)
 	{
+		visited[i] = 0;
+
 		p = get_entry_for_hash(hashes[i]);
+		if (p->hash != hashes[i]) continue;
 
-		if ((p->hash == hashes[i]) && (p->alg == DRAGONFLY))
+		info = p->info;
+
+		if (INFO_ALG(info) == DRAGONFLY)
 		{
 			visited[i] = 1;
 			continue;
 		}
 
-		
-		if ((p->hash == hashes[i]) && (p->side == 0))
+		if (INFO_SIDE(info) == 0)
 		{
 			// a perimeter hit with a forward search
-			visited[i] = -2000 + p->depth;
+			visited[i] = -2000 + INFO_DEPTH(info);
 			continue;
 		}
-		
-
-		visited[i] = 0;
 	}
 }
 
@@ -419,35 +450,23 @@ void dragonfly_update_perimeter(UINT_64* hashes, int* visited, int n, int depth)
 {
 	int i;
 	perimeter_entry* p;
-
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_lock(&perimeter_mutex);
-#endif
+	unsigned int info, new_info;
 
 	for (i = 0; i < n; i++)
 	{
 		if (visited[i] == 1) continue;
 
-		p = get_entry_for_hash(hashes[i]);
+		p = claim_entry_for_hash(hashes[i]);
 
-		if ((p->hash == hashes[i]) && (p->side == 1)) // already in perimeter by another alg
+		do
 		{
-			if (depth < p->depth)
-				p->depth = depth;
-
-			p->alg = DRAGONFLY;
-			continue;
-		}
+			info = p->info;
 
-		p->hash = hashes[i];
-		p->side = 1;
-		p->depth = depth;
-		p->alg = DRAGONFLY;
+			if ((INFO_SIDE(info) == 1) && ((int)INFO_DEPTH(info) < depth)) // already in perimeter by another alg
+				new_info = PERIMETER_INFO(INFO_DEPTH(info), 1, DRAGONFLY);
+			else
+				new_info = PERIMETER_INFO(depth, 1, DRAGONFLY);
 
-		total_perimeter_entries++;
+		} while (ATOMIC_CAS_32(&p->info, info, new_info) == 0);
 	}
-
-#ifdef THREADS
-	if (cores_num > 1) pthread_mutex_unlock(&perimeter_mutex);
-#endif
-}
\ No newline at end of file
+}
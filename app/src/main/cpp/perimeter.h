@@ -4,8 +4,10 @@
 #include "tree.h"
 #include "helper.h"
 
-void allocate_perimeter();
-void free_perimeter();
+int get_perimeter_size();
+UINT_64 get_perimeter_memory(int log_size);
+void allocate_perimeter(level_context *l);
+void free_perimeter(level_context *l);
 
 int insert_node_into_perimeter(tree *t, expansion_data *e, int with_sons);
 
@@ -14,6 +16,7 @@ int is_in_perimeter(UINT_64 hash, UINT_16 *depth, UINT_8 side);
 int check_if_perimeter_reached(tree *t, helper *h);
 
 void clear_perimeter();
+void print_perimeter_stats();
 
 int perimeter_is_full();
 
@@ -9,24 +9,209 @@
 #include "deadlock_utils.h"
 
 
+// All the positions of a search share an engine: an arena for the per-position arrays,
+// a hash index from board hashes to positions and to the moves that lead to them,
+// and a priority queue of the frontier moves. The engine is freed with the positions.
+
+#define ARENA_BLOCK_SIZE (1 << 16)
+
+typedef struct arena_block
+{
+	struct arena_block *next;
+	int size;
+	int used;
+} arena_block;
+
+typedef struct hash_link
+{
+	UINT_64 hash;
+	position *pos;
+	int son; // -1 for the position itself
+	struct hash_link *next;
+} hash_link;
+
+typedef struct
+{
+	int pos;
+	int son;
+} frontier_move;
+
+typedef struct positions_engine
+{
+	position *positions;
+	int capacity;
+
+	arena_block *arena;
+
+	hash_link **buckets;
+	UINT_64 buckets_mask;
+
+	frontier_move *frontier;
+	int frontier_num;
+	int frontier_size;
+	int queued_pos_num; // positions whose moves were added to the frontier
+	position_order is_better;
+
+	position **deadlock_stack;
+
+	int uniqe_hash[1024];
+	int uniqe_num;
+	int uniqe_pos_num;
+} positions_engine;
+
+void *arena_alloc(positions_engine *e, int size)
+{
+	arena_block *a;
+	int block_size;
+	void *res;
+
+	size = (size + 7) & ~7;
+
+	a = e->arena;
+
+	if ((a == 0) || (a->used + size > a->size))
+	{
+		block_size = (size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+
+		a = (arena_block*)malloc(sizeof(arena_block) + block_size);
+		if (a == 0)
+			exit_with_error("could not allocate positions arena");
+
+		a->size = block_size;
+		a->used = 0;
+		a->next = e->arena;
+		e->arena = a;
+	}
+
+	res = (char*)(a + 1) + a->used;
+	a->used += size;
+	return res;
+}
+
+positions_engine *allocate_positions_engine(position *positions, int pos_num)
+{
+	positions_engine *e;
+	int buckets_num = 256;
+	int i;
+
+	e = (positions_engine*)malloc(sizeof(positions_engine));
+	if (e == 0)
+		exit_with_error("could not allocate positions engine");
+
+	e->positions = positions;
+	e->capacity = pos_num;
+	e->arena = 0;
+
+	while (buckets_num < pos_num * 8)
+		buckets_num *= 2;
+
+	e->buckets = (hash_link**)malloc(sizeof(hash_link*) * buckets_num);
+	e->deadlock_stack = (position**)malloc(sizeof(position*) * pos_num);
+
+	if ((e->buckets == 0) || (e->deadlock_stack == 0))
+		exit_with_error("could not allocate positions engine");
+
+	for (i = 0; i < buckets_num; i++)
+		e->buckets[i] = 0;
+	e->buckets_mask = buckets_num - 1;
+
+	e->frontier = 0;
+	e->frontier_num = 0;
+	e->frontier_size = 0;
+	e->queued_pos_num = 0;
+	e->is_better = 0;
+
+	for (i = 0; i < 1024; i++)
+		e->uniqe_hash[i] = 0;
+	e->uniqe_num = 0;
+	e->uniqe_pos_num = 0;
+
+	return e;
+}
+
+void free_positions_engine(positions_engine *e)
+{
+	arena_block *a, *next;
+
+	for (a = e->arena; a; a = next)
+	{
+		next = a->next;
+		free(a);
+	}
+
+	free(e->buckets);
+	free(e->deadlock_stack);
+	if (e->frontier)
+		free(e->frontier);
+	free(e);
+}
+
 position *allocate_positions(int pos_num)
 {
 	position *p;
+	positions_engine *e;
+	int i;
+
 	p = (position*)malloc(sizeof(position)* pos_num);
 
 	if (p == 0)
 		exit_with_error("could not allocate positions");
 
+	e = allocate_positions_engine(p, pos_num);
 	
-	for (int i = 0; i < pos_num; i++)
+	for (i = 0; i < pos_num; i++)
 	{
 		p[i].board = 0;
-		p[i].moves_num = 0; // so we can free it later with no problems
+		p[i].moves_num = 0;
+		p[i].engine = e;
 	}
 
 	return p;
 }
 
+void add_hash_link(positions_engine *e, UINT_64 hash, position *p, int son)
+{
+	hash_link *l;
+	hash_link **bucket = e->buckets + (hash & e->buckets_mask);
+
+	l = (hash_link*)arena_alloc(e, sizeof(hash_link));
+	l->hash = hash;
+	l->pos = p;
+	l->son = son;
+	l->next = *bucket;
+	*bucket = l;
+}
+
+hash_link *first_hash_link(positions_engine *e, UINT_64 hash)
+{
+	return e->buckets[hash & e->buckets_mask];
+}
+
+void index_position(position *p)
+{
+	// make the position and its moves reachable from their hashes
+	int i;
+
+	if (p - p->engine->positions >= p->engine->capacity)
+		exit_with_error("position out of range");
+
+	add_hash_link(p->engine, p->position_hash, p, -1);
+
+	for (i = 0; i < p->moves_num; i++)
+		add_hash_link(p->engine, p->hashes[i], p, i);
+}
+
+position *find_position(positions_engine *e, UINT_64 hash)
+{
+	hash_link *l;
+
+	for (l = first_hash_link(e, hash); l; l = l->next)
+		if ((l->hash == hash) && (l->son == -1))
+			return l->pos;
+
+	return 0;
+}
+
 
 int position_is_solved(position *p)
 {
@@ -44,68 +229,68 @@ int position_is_solved(position *p)
 	return board_is_solved(b, p->pull_mode);
 }
 
-void mark_deadlocks(position *positions, int pos_num)
+int set_move_deadlocked(position *p, int son)
 {
-	int changed;
-	int i, j;
-	position *t;
+	// returns 1 if the position became deadlocked
+	if (p->move_deadlocked[son]) return 0;
 
-	do
+	p->move_deadlocked[son] = 1;
+	p->live_moves--;
+
+	if (p->live_moves > 0) return 0;
+	if (p->position_deadlocked) return 0;
+
+	if (verbose >= 6)
 	{
-		changed = 0;
+		printf("all sons became deadlocked\n");
+		print_position(p, 1);
+	}
 
-		// a son became deadlocked ?
-		for (i = 0; i < pos_num; i++)
-		{
+	if (position_is_solved(p)) return 0;
 
-			if (positions[i].position_deadlocked) // already detected
-				continue;
+	p->position_deadlocked = 1;
+	return 1;
+}
 
-			// a son became deadlocked?
-			for (j = 0; j < positions[i].moves_num; j++)
-			{
-				t = positions[i].place_in_positions[j];
-				if (t != 0)
-				if (positions[i].move_deadlocked[j] == 0)
-				if (t->position_deadlocked)
-				{
-					positions[i].move_deadlocked[j] = 1;
-					changed = 1;
-
-					if (verbose >= 6)
-					{
-						printf("discovered a deadlocked son (%d)\n", j);
-						print_position(positions + i, 1);
-					}					
-				}
-			}
+void propagate_deadlock(position *p)
+{
+	// p became deadlocked. Mark the moves that lead to it, and continue with
+	// the fathers that have no other moves.
+	position **stack = p->engine->deadlock_stack;
+	int stack_num = 0;
+	position *q, *father;
+	hash_link *l;
 
-			// all sons became deadlocked?
-			for (j = 0; j < positions[i].moves_num; j++)
-			if (positions[i].move_deadlocked[j] == 0)
-				break;
+	stack[stack_num++] = p;
 
-			if (j == positions[i].moves_num)
+	while (stack_num > 0)
+	{
+		q = stack[--stack_num];
+
+		for (l = first_hash_link(q->engine, q->position_hash); l; l = l->next)
+		{
+			if (l->son == -1) continue;
+			if (l->hash != q->position_hash) continue;
+
+			father = l->pos;
+
+			if (father->place_in_positions[l->son] != q) continue;
+			if (father->position_deadlocked) continue;
+			if (father->move_deadlocked[l->son]) continue;
+
+			if (verbose >= 6)
 			{
-				if (verbose >= 6)
-				{
-					printf("all sons became deadlocked\n");
-					print_position(positions + i, 1);
-				}
-
-				if (position_is_solved(positions + i) == 0)
-				{
-					positions[i].position_deadlocked = 1;
-					changed = 1;
-				}
+				printf("discovered a deadlocked son (%d)\n", l->son);
+				print_position(father, 1);
 			}
-		}
 
-	} while (changed == 1);
+			if (set_move_deadlocked(father, l->son))
+				stack[stack_num++] = father;
+		}
+	}
 }
 
 
-
 void print_position(position *p, int print_moves)
 {
 	board c;
@@ -162,15 +347,14 @@ void print_position(position *p, int print_moves)
 	}
 }
 
-int find_hash_in_positions(UINT_64 hash, position *positions, int pos_num)
+int find_hash_in_positions(UINT_64 hash, position *positions)
 {
-	int i;
+	position *p = find_position(positions->engine, hash);
 
-	for (i = 0; i < pos_num; i++)
-	if (positions[i].position_hash == hash)
-		return i;
+	if (p == 0)
+		return -1;
 
-	return -1;
+	return (int)(p - positions);
 }
 
 void assert_board_after_move(position *p, int move_index, position *next)
@@ -182,52 +366,28 @@ void assert_board_after_move(position *p, int move_index, position *next)
 	apply_move(b, p->moves + move_index, p->search_mode);
 	board_to_bytes(b, data);
 
-	if (is_same_seq(data, next->board, height*width) == 0)
+	if (is_same_seq(data, next->board, current_level->height*current_level->width) == 0)
 		exit_with_error("hash error");
 }
 
-void set_place_in_positions(position *p, position *positions, int pos_num)
+void set_place_in_positions(position *p)
 {
 	// direct new children to existing nodes
-	int i, j;
-	unsigned int upper;	
-	UINT_64 hash_indicators[256];
-	// use a 14 bit map hash of hashes...
-
-	for (i = 0; i < 256; i++)
-		hash_indicators[i] = 0;
+	int i;
+	position *q;
 
-	// project hashes of new moves
 	for (i = 0; i < p->moves_num; i++)
 	{
-		upper = p->hashes[i] >> 50;
-		hash_indicators[upper >> 6] |= (1ULL << (upper & 0x3f));
-	}
+		q = find_position(p->engine, p->hashes[i]);
+		p->place_in_positions[i] = q;
 
-	for (i = 0; i < p->moves_num; i++)
-		p->place_in_positions[i] = 0;
+		if (q == 0) continue;
 
-	for (i = 0; i < pos_num; i++)
-	{
-		upper = positions[i].position_hash >> 50;
-
-		if (((hash_indicators[upper >> 6] >> (upper & 0x3f)) & 1) == 0)
-			continue;
-
-		for (j = 0; j < p->moves_num; j++)
-		{
-			if (p->hashes[j] == positions[i].position_hash)
-			{
-				p->place_in_positions[j] = positions + i;
-				assert_board_after_move(p, j, positions + i);
-
-				if (positions[i].position_deadlocked)
-					p->move_deadlocked[j] = 1;
-			}
-		}
+		assert_board_after_move(p, i, q);
 
+		if (q->position_deadlocked)
+			p->move_deadlocked[i] = 1;
 	}
-
 }
 
 
@@ -235,6 +395,7 @@ void set_place_in_positions(position *p, position *positions, int pos_num)
 void allocate_position_structures(position *p)
 {
 	int moves_num = p->moves_num;
+	positions_engine *e = p->engine;
 
 	if (p->moves_num == 0)
 	{
@@ -246,78 +407,33 @@ void allocate_position_structures(position *p)
 		return;
 	}
 
-
-	p->moves = (move*)malloc(sizeof(move)* moves_num);
-	if (p->moves == 0) exit_with_error("can't alloc moves\n");
-
-	p->hashes = (UINT_64*)malloc(8 * moves_num);
-	if (p->hashes == 0) exit_with_error("can't alloc hashes");
-
-	p->scores = (score_element *)malloc(sizeof(score_element)* moves_num);
-	if (p->scores == 0) exit_with_error("can't alloc scores");
-
-	p->place_in_positions = (position **)malloc(sizeof(position *)* moves_num);
-	if (p->place_in_positions == 0) exit_with_error("can't alloc places");
-
-	p->move_deadlocked = (int *)malloc(sizeof(int)* moves_num);
-	if (p->move_deadlocked == 0) exit_with_error("can't alloc deadlocks");
-
-}
-
-void free_position_structures(position *p)
-{
-	if (p->board)
-		free(p->board);
-
-	if (p->moves_num == 0) return;
-	free(p->moves);
-	free(p->hashes);
-	free(p->scores);
-	free(p->place_in_positions);
-	free(p->move_deadlocked);
+	p->moves = (move*)arena_alloc(e, sizeof(move)* moves_num);
+	p->hashes = (UINT_64*)arena_alloc(e, 8 * moves_num);
+	p->scores = (score_element *)arena_alloc(e, sizeof(score_element)* moves_num);
+	p->place_in_positions = (position **)arena_alloc(e, sizeof(position *)* moves_num);
+	p->move_deadlocked = (int *)arena_alloc(e, sizeof(int)* moves_num);
 }
 
-void free_positions(position *p, int pos_num)
+void free_positions(position *p)
 {
-	int i;
-	for (i = 0; i < pos_num; i++)
-		free_position_structures(p + i);
+	free_positions_engine(p->engine);
 	free(p);
 }
 
 
-
-void set_hash_indicators(position* p)
-{
-	int i;
-	unsigned int upper;
-
-	// prepare a bitmap showing which hashes are possible
-
-	for (i = 0; i < 64; i++)
-		p->hash_indicators[i] = 0;
-
-	for (i = 0; i < p->moves_num; i++)
-	{
-		upper = p->hashes[i] >> 52;
-		p->hash_indicators[upper >> 6] |= (1ULL << (upper & 0x3f));
-	}
-}
-
-
 void set_scores_to_moves(board b, move *moves, int moves_num, score_element *scores,
 	UINT_64 *hashes,
 	int pull_mode, int search_mode, helper *h)
 {
 	int i;
 	board c;
+	move_parent parent;
+
+	prepare_move_parent(b, get_board_hash(b), &parent);
 
 	for (i = 0; i < moves_num; i++)
 	{
-		copy_board(b, c);
-		apply_move(c, moves + i, search_mode);
-
-		hashes[i] = get_board_hash(c);
+		hashes[i] = apply_move_and_hash(&parent, moves + i, search_mode, c);
 
 		score_board(c, scores + i, pull_mode, search_mode, h);
 	}
@@ -325,34 +441,28 @@ void set_scores_to_moves(board b, move *moves, int moves_num, score_element *sco
 
 
 void fill_position_structures(position *p, board b, move *moves, int pull_mode,
-		position *positions, int pos_num, helper *h)
+		int pos_num, helper *h)
 {
 	int i;
 	int moves_num = p->moves_num;
-	position *q;
 
 	for (i = 0; i < moves_num; i++)
 	{
 		p->moves[i] = moves[i];
 		p->move_deadlocked[i] = 0;
+		p->place_in_positions[i] = 0;
 	}
 
 	set_scores_to_moves(b, moves, moves_num, p->scores, p->hashes, pull_mode, p->search_mode, h);
 
-	set_hash_indicators(p);
-
-	set_place_in_positions(p, positions, pos_num);
+	// direct sons to existing positions. If a son points to a deadlocked node, mark it now
+	if (pos_num > 0)
+		set_place_in_positions(p);
 
-	// if a son points to a deadlocked node, mark it now
+	p->live_moves = 0;
 	for (i = 0; i < moves_num; i++)
-	{
-		q = p->place_in_positions[i];
-		if (q)
-		{ 
-			if (q->position_deadlocked)
-				p->move_deadlocked[i] = 1;
-		}
-	}
+		if (p->move_deadlocked[i] == 0)
+			p->live_moves++;
 }
 
 
@@ -379,7 +489,7 @@ void set_first_position(board input_board, int pull_mode, position *positions, i
 	p->pull_mode = pull_mode;
 	p->search_mode = search_mode;
 
-	p->board = (UINT_8*)malloc(width*height);
+	p->board = (UINT_8*)arena_alloc(p->engine, current_level->width*current_level->height);
 	board_to_bytes(b, p->board);
 
 	moves_num = find_possible_moves(b, moves, pull_mode, &(p->has_corral), search_mode, h);
@@ -388,12 +498,14 @@ void set_first_position(board input_board, int pull_mode, position *positions, i
 	score_board(b, &p->position_score, pull_mode, search_mode, h);
 
 	allocate_position_structures(p);
-	fill_position_structures(p, b, moves, pull_mode, positions, 0, h);
+	fill_position_structures(p, b, moves, pull_mode, 0, h);
 
 	p->position_hash = get_board_hash(b);
 
 	p->position_deadlocked = 0;
 
+	index_position(p);
+
 	if (p->moves_num == 0)
 	{
 		if (position_is_solved(p) == 0)
@@ -417,60 +529,33 @@ void son_to_seq(position *p, int son, UINT_8 *seq)
 }
 
 
-void direct_other_sons_to_position(position *pos, position *positions, int pos_num)
+void direct_other_sons_to_position(position *pos)
 {
-	UINT_64 hash;
-	int i, j;
+	hash_link *l;
 	position *p;
-	unsigned int upper, lower;
-
-	hash = pos->position_hash;
-
-	upper = hash >> 52;
-	lower = upper & 0x3f;
-	upper >>= 6;
+	UINT_64 hash = pos->position_hash;
 
-	for (i = 0; i < pos_num; i++)
+	for (l = first_hash_link(pos->engine, hash); l; l = l->next)
 	{
-		p = positions + i;
+		if (l->son == -1) continue;
+		if (l->hash != hash) continue;
 
-		if (((p->hash_indicators[upper] >> lower) & 1) == 0) continue;
+		p = l->pos;
 
-		for (j = 0; j < p->moves_num; j++)
-		{
-			if (p->hashes[j] != hash) continue;
+		if (p->place_in_positions[l->son] != NULL)
+			continue; // son already directed
 
-			if (p->place_in_positions[j] != NULL)
-				continue; // son already directed
+		p->place_in_positions[l->son] = pos;
 
-			p->place_in_positions[j] = pos;
+		assert_board_after_move(p, l->son, pos);
 
-			assert_board_after_move(p, j, pos);
-		}
+		if (pos->position_deadlocked)
+			if (p->position_deadlocked == 0)
+				if (set_move_deadlocked(p, l->son))
+					propagate_deadlock(p);
 	}
 }
 
-int all_sons_are_deadlocked(position *p)
-{
-	int i;
-	position *q;
-
-	for (i = 0; i < p->moves_num; i++)
-	{
-		if (p->move_deadlocked[i]) continue;
-
-		q = p->place_in_positions[i];
-		if (q == 0) return 0; // move not explored yet
-
-		if (q->position_deadlocked)
-			exit_with_error("move_deadlocked error");
-
-		if (q->position_deadlocked == 0)
-			return 0;
-	}
-	return 1;
-}
-
 void expand_position(position *node, int son, int pull_mode, position *positions, int pos_num, helper *h)
 {
 	board b;
@@ -479,10 +564,9 @@ void expand_position(position *node, int son, int pull_mode, position *positions
 	int moves_num;
 	UINT_64 hash;
 
-	if (find_hash_in_positions(node->hashes[son], positions, pos_num) != -1)
+	if (find_hash_in_positions(node->hashes[son], positions) != -1)
 	{
 		printf("trying to expand known position\n");
-		find_hash_in_positions(node->hashes[son], positions, pos_num);
 		exit_with_error("exiting");
 	}
 
@@ -493,9 +577,6 @@ void expand_position(position *node, int son, int pull_mode, position *positions
 	hash = get_board_hash(b);
 	if (hash != node->hashes[son])
 		exit_with_error("different hash than expected");
-	if (find_hash_in_positions(hash, positions, pos_num) != -1)
-		exit_with_error("position already exists?!");
-
 
 	p = &positions[pos_num];
 
@@ -503,7 +584,7 @@ void expand_position(position *node, int son, int pull_mode, position *positions
 	p->pull_mode = pull_mode;
 	p->search_mode = node->search_mode;
 
-	p->board = (UINT_8*)malloc(width*height);
+	p->board = (UINT_8*)arena_alloc(p->engine, current_level->width*current_level->height);
 	board_to_bytes(b, p->board);
 
 	moves_num = find_possible_moves(b, moves, pull_mode, &(p->has_corral), node->search_mode, h);
@@ -512,80 +593,58 @@ void expand_position(position *node, int son, int pull_mode, position *positions
 	p->position_score = node->scores[son];
 
 	allocate_position_structures(p);
-	fill_position_structures(p, b, moves, pull_mode, positions, pos_num, h);
+	fill_position_structures(p, b, moves, pull_mode, pos_num, h);
 
 	p->weight = node->weight + node->moves[son].attr.weight;
 
-
-	p->position_hash = get_board_hash(b);
+	p->position_hash = hash;
 	p->depth = node->depth + 1;
+	p->position_deadlocked = 0;
 	node->place_in_positions[son] = p;
 
-	direct_other_sons_to_position(p, positions, pos_num);
+	index_position(p);
 
-	p->position_deadlocked = 0;
+	direct_other_sons_to_position(p);
 
-	if (all_sons_are_deadlocked(p))
-//	if (p->moves_num == 0)
+	if (p->live_moves == 0)
 	{ 
 		if (position_is_solved(p) == 0)
 		{
+			if (verbose >= 6)
 			{
-				if (verbose >= 6)
-				{
-					printf("position has no moves... marking as deadlock\n");
-					print_board(b);
-				}
-				p->position_deadlocked = 1;
-				mark_deadlocks(positions, pos_num + 1);
+				printf("position has no moves... marking as deadlock\n");
+				print_board(b);
 			}
+			p->position_deadlocked = 1;
+			propagate_deadlock(p);
 		}
 	}
 }
 
-void set_leaf_as_deadlock(position *positions, int pos_num, int pos, int son)
+void set_leaf_as_deadlock(position *positions, int pos, int son)
 {
-	int i, j, n,k;	
+	hash_link *l;
+	position *p;
 	UINT_64 hash;
-	int node_changed = 0;
-	unsigned int upper, lower;
 
 	hash = positions[pos].hashes[son];
-	upper = hash >> 52;
-	lower = upper & 0x3f;
-	upper >>= 6;
 
-	for (i = 0; i < pos_num; i++)
+	for (l = first_hash_link(positions->engine, hash); l; l = l->next)
 	{
-		if (positions[i].position_deadlocked) continue;
-
-		if (((positions[i].hash_indicators[upper] >> lower) & 1) == 0) continue;
-
-		n = positions[i].moves_num;
-		for (j = 0; j < n; j++)
-		{
-			if (positions[i].hashes[j] != hash) continue;
+		if (l->son == -1) continue;
+		if (l->hash != hash) continue;
 
-			// we should very rarely be here
+		p = l->pos;
 
-			positions[i].move_deadlocked[j] = 1;
+		if (p->position_deadlocked) continue;
 
-			if (i != pos)
-				if (positions[i].place_in_positions[j])
-					exit_with_error("leaf should not be expanded");
+		if (p != positions + pos)
+			if (p->place_in_positions[l->son])
+				exit_with_error("leaf should not be expanded");
 
-			// did all sons become deadlock?
-			for (k = 0; k < n; k++)
-				if (positions[i].move_deadlocked[k] == 0)
-					break;
-
-			if (k == n)
-				node_changed = 1;
-		}
+		if (set_move_deadlocked(p, l->son))
+			propagate_deadlock(p);
 	}
-
-	if (node_changed)
-		mark_deadlocks(positions, pos_num);
 }
 
 int all_moves_deadlocked(position *p)
@@ -601,21 +660,33 @@ int all_moves_deadlocked(position *p)
 
 int estimate_uniqe_moves(position *positions, int pos_num)
 {
-	int hash[1024];
-	int i,j;
-	int sum = 0;
+	// counted incrementally, as positions are only added during a search
+	positions_engine *e = positions->engine;
+	int i, j, k;
 
-	for (i = 0; i < 1024; i++)
-		hash[i] = 0;
+	if (pos_num < e->uniqe_pos_num)
+	{
+		for (i = 0; i < 1024; i++)
+			e->uniqe_hash[i] = 0;
+		e->uniqe_num = 0;
+		e->uniqe_pos_num = 0;
+	}
 
-	for (i = 0; i < pos_num; i++)
+	for (i = e->uniqe_pos_num; i < pos_num; i++)
 		for (j = 0; j < positions[i].moves_num; j++)
-			hash[positions[i].hashes[j] & 0x3ff] = 1;
+		{
+			k = positions[i].hashes[j] & 0x3ff;
 
-	for (i = 0; i < 1024; i++)
-		sum += hash[i];
+			if (e->uniqe_hash[k] == 0)
+			{
+				e->uniqe_hash[k] = 1;
+				e->uniqe_num++;
+			}
+		}
+
+	e->uniqe_pos_num = pos_num;
 
-	return sum;
+	return e->uniqe_num;
 }
 
 void show_position_path(position* p)
@@ -628,31 +699,128 @@ void show_position_path(position* p)
 	//	my_getch();
 }
 
-void best_pos_and_son(position* positions, int pos_num, int* pos, int* son, 
-	int pull_mode, int search_mode)
+int frontier_move_is_better(positions_engine *e, frontier_move *a, frontier_move *b)
+{
+	// ties are broken by position and move index, as in a linear scan
+	score_element *score_a = e->positions[a->pos].scores + a->son;
+	score_element *score_b = e->positions[b->pos].scores + b->son;
+
+	if (e->is_better(score_a, score_b)) return 1;
+	if (e->is_better(score_b, score_a)) return 0;
+
+	if (a->pos != b->pos)
+		return (a->pos < b->pos);
+
+	return (a->son < b->son);
+}
+
+void push_frontier_move(positions_engine *e, int pos, int son)
+{
+	frontier_move tmp;
+	int i, father;
+
+	if (e->frontier_num == e->frontier_size)
+	{
+		e->frontier_size = (e->frontier_size == 0 ? 1024 : e->frontier_size * 2);
+		e->frontier = (frontier_move*)realloc(e->frontier, sizeof(frontier_move) * e->frontier_size);
+		if (e->frontier == 0)
+			exit_with_error("could not allocate frontier");
+	}
+
+	i = e->frontier_num++;
+	e->frontier[i].pos = pos;
+	e->frontier[i].son = son;
+
+	while (i > 0)
+	{
+		father = (i - 1) / 2;
+		if (frontier_move_is_better(e, e->frontier + i, e->frontier + father) == 0)
+			break;
+
+		tmp = e->frontier[i];
+		e->frontier[i] = e->frontier[father];
+		e->frontier[father] = tmp;
+		i = father;
+	}
+}
+
+void pop_frontier_move(positions_engine *e)
 {
+	frontier_move tmp;
+	int i = 0, best, son;
+
+	e->frontier[0] = e->frontier[--e->frontier_num];
+
+	while (1)
+	{
+		best = i;
+
+		for (son = 2 * i + 1; son <= 2 * i + 2; son++)
+			if (son < e->frontier_num)
+				if (frontier_move_is_better(e, e->frontier + son, e->frontier + best))
+					best = son;
+
+		if (best == i)
+			break;
+
+		tmp = e->frontier[i];
+		e->frontier[i] = e->frontier[best];
+		e->frontier[best] = tmp;
+		i = best;
+	}
+}
+
+int frontier_move_is_open(positions_engine *e, frontier_move *m)
+{
+	position *p = e->positions + m->pos;
+
+	if (p->position_deadlocked) return 0;
+	if (p->move_deadlocked[m->son]) return 0;
+	if (p->place_in_positions[m->son]) return 0;
+	return 1;
+}
+
+int best_frontier_move(position *positions, int pos_num, int *son, position_order is_better)
+{
+	// returns the position of the best move that was not expanded and is not deadlocked,
+	// or -1. Moves are added to the frontier when their position is first seen here.
+	// Closed moves never reopen, so they are removed only when they reach the top.
+	positions_engine *e = positions->engine;
+	frontier_move m;
 	int i, j;
-	*pos = -1;
 
-	score_element best_score;
+	if (positions != e->positions)
+		exit_with_error("frontier of partial positions");
 
-	for (i = 0; i < pos_num; i++)
+	if (e->is_better != is_better)
 	{
-		if (positions[i].position_deadlocked) continue;
+		e->frontier_num = 0;
+		e->queued_pos_num = 0;
+		e->is_better = is_better;
+	}
 
+	for (i = e->queued_pos_num; i < pos_num; i++)
 		for (j = 0; j < positions[i].moves_num; j++)
 		{
-			if (positions[i].move_deadlocked[j]) continue;
-			if (positions[i].place_in_positions[j]) continue;
+			m.pos = i;
+			m.son = j;
+			if (frontier_move_is_open(e, &m))
+				push_frontier_move(e, i, j);
+		}
 
-			if ((*pos == -1) || (is_better_score(positions[i].scores + j, 
-				&best_score, pull_mode, search_mode)))
-			{
-				best_score = positions[i].scores[j];
+	if (pos_num > e->queued_pos_num)
+		e->queued_pos_num = pos_num;
 
-				*pos = i;
-				*son = j;
-			}
+	while (e->frontier_num > 0)
+	{
+		if (frontier_move_is_open(e, e->frontier))
+		{
+			*son = e->frontier[0].son;
+			return e->frontier[0].pos;
 		}
+
+		pop_frontier_move(e);
 	}
+
+	return -1;
 }
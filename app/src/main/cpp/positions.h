@@ -9,6 +9,8 @@
 #include "global.h"
 #include "helper.h"
 
+struct positions_engine;
+
 typedef struct position
 {
 	int moves_num;
@@ -21,6 +23,7 @@ typedef struct position
 	struct position **place_in_positions;
 	int *move_deadlocked;
 	UINT_64 *hashes;
+	int live_moves; // moves that are not deadlocked
 
 	struct position *father;
 
@@ -36,10 +39,10 @@ typedef struct position
 
 	int has_corral;
 
-	UINT_64 hash_indicators[64];
-	
 	int search_mode;
 
+	struct positions_engine *engine; // shared by all the positions of a search
+
 } position;
 
 position *allocate_positions(int pos_num);
@@ -48,21 +51,20 @@ void print_position(position *p, int print_moves);
 void set_first_position(board input_board, int pull_mode, position *positions, int search_mode, helper *h);
 void expand_position(position *node, int son, int pull_mode, position *positions, int pos_num, helper *h);
 
-void free_positions(position *p, int pos_num);
+void free_positions(position *p);
 
-void mark_deadlocks(position *positions, int pos_num);
-
-void direct_other_sons_to_position(position *pos, position *positions, int pos_num);
+void direct_other_sons_to_position(position *pos);
 
 int position_is_solved(position *p);
-void set_leaf_as_deadlock(position *positions, int pos_num, int pos, int son);
+void set_leaf_as_deadlock(position *positions, int pos, int son);
 
 int estimate_uniqe_moves(position *positions, int pos_num);
 
 void show_position_path(position* p);
 
-void best_pos_and_son(position* positions, int pos_num, int* pos, int* son,
-	int pull_mode, int search_mode);
+typedef int(*position_order)(score_element *new_score, score_element *old_score);
+
+int best_frontier_move(position *positions, int pos_num, int *son, position_order is_better);
 
 
 #endif
\ No newline at end of file
@@ -18,8 +18,8 @@ int player_can_leave_board(board b_in)
 	clear_boxes_inplace(b);
 
 	// init queue from existing sokoban positions
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & SOKOBAN)
 			{
 				queue_y[queue_len] = i;
@@ -39,8 +39,8 @@ int player_can_leave_board(board b_in)
 
 			if (next_y < 0) return 1;
 			if (next_x < 0) return 1;
-			if (next_y >= height) return 1;
-			if (next_x >= width) return 1;
+			if (next_y >= current_level->height) return 1;
+			if (next_x >= current_level->width) return 1;
 
 			if (b[next_y][next_x] & SOKOBAN) continue;
 			if (b[next_y][next_x] & OCCUPIED) continue;
@@ -62,7 +62,7 @@ int sanity_checks(board b)
 	if (player_can_leave_board(b))
 	{
 		printf("Invalid board\n");
-		sprintf(global_fail_reason, "Invalid board");
+		sprintf(current_level->fail_reason, "Invalid board");
 		return 0;
 	}
 
@@ -71,7 +71,7 @@ int sanity_checks(board b)
 	if (box_num >= MAX_BOXES)
 	{
 		printf("Too many boxes\n");
-		sprintf(global_fail_reason, "Too many boxes");
+		sprintf(current_level->fail_reason, "Too many boxes");
 		return 0;
 	}
 	return 1;
@@ -86,8 +86,8 @@ void close_holes_in_board(board b)
 	{
 		changed = 0;
 
-		for (i = 1; i < (height - 1); i++)
-			for (j = 1; j < (width - 1); j++)
+		for (i = 1; i < (current_level->height - 1); i++)
+			for (j = 1; j < (current_level->width - 1); j++)
 			{
 				if (b[i][j] != 0) continue;
 
@@ -108,16 +108,16 @@ void close_holes_in_board(board b)
 
 void remove_boxes_out_of_inner(board b)
 {
-	board inner;
+	board cloud;
 	int i, j;
 
 	// mark inner and boxes in inner
-	clear_boxes(b, inner);
-	expand_sokoban_cloud(inner);
+	clear_boxes(b, cloud);
+	expand_sokoban_cloud(cloud);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if ((inner[i][j] & SOKOBAN) == 0)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if ((cloud[i][j] & SOKOBAN) == 0)
 			{
 				b[i][j] &= ~BOX;
 				b[i][j] &= ~TARGET;
@@ -136,8 +136,8 @@ void turn_decorative_boxes_to_walls(board b)
 
 	// eliminate pullable boxes
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (c[i][j] & TARGET)
 				c[i][j] = BOX;
 
@@ -145,8 +145,8 @@ void turn_decorative_boxes_to_walls(board b)
 	{
 		changed = 0;
 
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if ((c[i][j] & BOX) == 0) continue;
 				for (k = 0; k < 4; k++)
@@ -160,8 +160,8 @@ void turn_decorative_boxes_to_walls(board b)
 			}
 	}
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (c[i][j] & BOX)
 				b[i][j] = WALL;
 
@@ -175,8 +175,8 @@ void turn_decorative_boxes_to_walls(board b)
 	{
 		changed = 0;
 
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if ((c[i][j] & BOX) == 0) continue;
 				for (k = 0; k < 4; k++)
@@ -190,8 +190,8 @@ void turn_decorative_boxes_to_walls(board b)
 			}
 	}
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (c[i][j] & BOX)
 				b[i][j] = WALL;
 }
@@ -10,6 +10,9 @@
 #define Q_RIGHT(i) (((i)* 2) + 2)
 #define Q_PARENT(i) (((i) - 1) / 2)
 
+// The elements are expansion indexes. Each expansion remembers its place in the heap
+// (heap_pos), so it can be removed without searching for it.
+
 void init_queue(queue *q, tree *t)
 {
 	q->max_size = 64;
@@ -32,13 +35,26 @@ int is_better_element(queue *q, int first, int second)
 	if (e1->best_weight < e2->best_weight) return 1;
 	if (e1->best_weight > e2->best_weight) return 0;
 
-	if (is_better_score(&(e1->best_score), &(e2->best_score), pull_mode, search_mode)) return 1;
-	if (is_better_score(&(e2->best_score), &(e1->best_score), pull_mode, search_mode)) return 0;
+	if (e1->has_score_key && e2->has_score_key)
+	{
+		if (e1->best_score_key > e2->best_score_key) return 1;
+		if (e1->best_score_key < e2->best_score_key) return 0;
+	}
+	else
+	{
+		if (is_better_score(&(e1->best_score), &(e2->best_score), pull_mode, search_mode)) return 1;
+		if (is_better_score(&(e2->best_score), &(e1->best_score), pull_mode, search_mode)) return 0;
+	}
 
 	if (first < second) return 1;
 	return 0;
 }
 
+void set_heap_element(queue *q, int i, int val)
+{
+	q->elements[i] = val;
+	q->t->expansions[val].heap_pos = i;
+}
 
 void heapify(queue *q, int i)
 {
@@ -66,8 +82,8 @@ void heapify(queue *q, int i)
 	if (largest != i)
 	{
 		tmp = elements[i];
-		elements[i] = elements[largest];
-		elements[largest] = tmp;
+		set_heap_element(q, i, elements[largest]);
+		set_heap_element(q, largest, tmp);
 
 		heapify(q, largest);
 	}	
@@ -102,9 +118,11 @@ int extarct_max(queue *q)
 		return -1;
 
 	res = q->elements[0];
+	q->t->expansions[res].heap_pos = -1;
 
-	q->elements[0] = q->elements[q->heap_size - 1];
 	(q->heap_size)--;
+	if (q->heap_size > 0)
+		set_heap_element(q, 0, q->elements[q->heap_size]);
 
 	heapify(q, 0);
 	
@@ -123,10 +141,10 @@ void heap_insert(queue *q, int val)
 
 	while ((i > 0) && (is_better_element(q, val, q->elements[Q_PARENT(i)])))
 	{
-		q->elements[i] = q->elements[Q_PARENT(i)];
+		set_heap_element(q, i, q->elements[Q_PARENT(i)]);
 		i = Q_PARENT(i);
 	}
-	q->elements[i] = val;
+	set_heap_element(q, i, val);
 }
 
 void reset_heap(queue *q)
@@ -153,6 +171,9 @@ void verify_heap(queue *q)
 		l = Q_LEFT(i);
 		r = Q_RIGHT(i);
 
+		if (q->t->expansions[q->elements[i]].heap_pos != i)
+			printf("heap failed 3\n");
+
 		if (l < q->heap_size)
 		{
 			if (is_better_element(q, q->elements[l], q->elements[i]))
@@ -181,19 +202,16 @@ void remove_value_from_queue(queue *q, int val)
 {
 	// make the value the best item - and remove it
 	
-	int i;
-
-	for (i = 0; i < q->heap_size; i++)
-		if (q->elements[i] == val)
-			break;
+	int i = q->t->expansions[val].heap_pos;
 
-	if (i == q->heap_size)
+	if ((i < 0) || (i >= q->heap_size) || (q->elements[i] != val))
 		exit_with_error("can't find element");
 
 	while (i > 0)
 	{
-		q->elements[i] = q->elements[Q_PARENT(i)];
+		set_heap_element(q, i, q->elements[Q_PARENT(i)]);
 		i = Q_PARENT(i);
 	}
+	set_heap_element(q, 0, val);
 	extarct_max(q);
 }
\ No newline at end of file
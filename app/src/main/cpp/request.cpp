@@ -2,22 +2,76 @@
 // Copyright 2018-2020 Yaron Shoham
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "request.h"
 #include "util.h"
 
 
 
+void free_request_data(request_data *r)
+{
+	if (r == 0) return;
+
+	free(r->pack_requests);
+	free(r->pack_index);
+	free(r->requests);
+	free(r->index);
+	free(r);
+}
+
 void init_pack_requets(helper *h)
 {
 	h->request->pack_requests_num = 0;
 	h->request->pack_requests_pos = 0;
+
+	if (h->request->pack_index)
+		memset(h->request->pack_index, 0xff, sizeof(int) * h->request->pack_index_size);
+
+	h->request->lookups = 0;
+	h->request->lookup_time = 0;
 }
 
 void init_requests(helper *h)
 {
 	h->request->requests_num = 0;
 	h->request->requests_pos = 0;
+
+	if (h->request->index)
+		memset(h->request->index, 0xff, sizeof(int) * h->request->index_size);
+
+	h->request->lookups = 0;
+	h->request->lookup_time = 0;
+}
+
+void print_request_stats(helper *h)
+{
+	printf("cells: %d pack cells: %d lookups: %llu lookup time: %llu us\n",
+		h->request->requests_num, h->request->pack_requests_num,
+		h->request->lookups, h->request->lookup_time);
+}
+
+unsigned int get_cell_hash(int a, int b, int c, int d)
+{
+	unsigned int hash = 2166136261u;
+
+	hash = (hash ^ (unsigned int)a) * 16777619u;
+	hash = (hash ^ (unsigned int)b) * 16777619u;
+	hash = (hash ^ (unsigned int)c) * 16777619u;
+	hash = (hash ^ (unsigned int)d) * 16777619u;
+
+	return hash ^ (hash >> 15);
+}
+
+unsigned int get_pack_request_hash(int boxes_in_level, int boxes_on_targets, int connectivity, int room)
+{
+	return get_cell_hash(boxes_in_level, boxes_on_targets, connectivity, room);
+}
+
+unsigned int get_request_hash(int packed_boxes, int connectivity, int out_of_plan, int imagine)
+{
+	return get_cell_hash(packed_boxes, connectivity, out_of_plan, imagine);
 }
 
 int pack_request_matches_score(pack_request *req, score_element *s)
@@ -40,22 +94,132 @@ int request_matches_score(request *req, score_element *s)
 	return 1;
 }
 
-int find_score_in_pack_requests(pack_request *req, int n, score_element *s)
+int find_pack_index_slot(request_data *r, score_element *s)
+{
+	// returns the index slot of the score's cell, or the free slot where it belongs
+	int mask = r->pack_index_size - 1;
+	int slot = get_pack_request_hash(s->boxes_in_level, s->boxes_on_targets,
+		s->connectivity, s->rooms_score) & mask;
+
+	while (r->pack_index[slot] != -1)
+	{
+		if (pack_request_matches_score(r->pack_requests + r->pack_index[slot], s))
+			break;
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+int find_index_slot(request_data *r, score_element *s)
 {
+	int mask = r->index_size - 1;
+	int slot = get_request_hash(s->packed_boxes, s->connectivity,
+		s->out_of_plan, s->imagine) & mask;
+
+	while (r->index[slot] != -1)
+	{
+		if (request_matches_score(r->requests + r->index[slot], s))
+			break;
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+int find_score_in_pack_requests(helper *h, score_element *s)
+{
+	request_data *r = h->request;
+	UINT_64 start = 0;
+	int res;
+
+	if (r->pack_requests_num == 0) return -1;
+
+	if (verbose >= 4) start = get_time_in_us();
+
+	res = r->pack_index[find_pack_index_slot(r, s)];
+
+	r->lookups++;
+	if (verbose >= 4) r->lookup_time += get_time_in_us() - start;
+
+	return res;
+}
+
+int find_score_in_requests(helper *h, score_element *s)
+{
+	request_data *r = h->request;
+	UINT_64 start = 0;
+	int res;
+
+	if (r->requests_num == 0) return -1;
+
+	if (verbose >= 4) start = get_time_in_us();
+
+	res = r->index[find_index_slot(r, s)];
+
+	r->lookups++;
+	if (verbose >= 4) r->lookup_time += get_time_in_us() - start;
+
+	return res;
+}
+
+void grow_pack_requests(request_data *r)
+{
+	// called before adding a cell. Keeps the index at most half full.
+	score_element s;
 	int i;
-	for (i = 0; i < n; i++)
-		if (pack_request_matches_score(req + i, s))
-			return i;
-	return -1;
+
+	if (r->pack_requests_num == r->max_pack_requests)
+	{
+		r->max_pack_requests = (r->max_pack_requests ? r->max_pack_requests * 2 : 256);
+		r->pack_requests = (pack_request*)realloc(r->pack_requests, sizeof(pack_request) * r->max_pack_requests);
+		if (r->pack_requests == 0) exit_with_error("can't grow pack requests");
+	}
+
+	if ((r->pack_requests_num + 1) * 2 <= r->pack_index_size) return;
+
+	free(r->pack_index);
+	r->pack_index_size = (r->pack_index_size ? r->pack_index_size * 2 : 512);
+	r->pack_index = (int*)malloc(sizeof(int) * r->pack_index_size);
+	if (r->pack_index == 0) exit_with_error("can't grow pack requests index");
+	memset(r->pack_index, 0xff, sizeof(int) * r->pack_index_size);
+
+	for (i = 0; i < r->pack_requests_num; i++)
+	{
+		s.boxes_in_level   = r->pack_requests[i].boxes_in_level;
+		s.boxes_on_targets = r->pack_requests[i].boxes_on_targets;
+		s.connectivity     = r->pack_requests[i].connectivity;
+		s.rooms_score      = r->pack_requests[i].room_connectivity;
+		r->pack_index[find_pack_index_slot(r, &s)] = i;
+	}
 }
 
-int find_score_in_requests(request *req, int n, score_element *s)
+void grow_requests(request_data *r)
 {
+	score_element s;
 	int i;
-	for (i = 0; i < n; i++)
-		if (request_matches_score(req + i, s))
-			return i;
-	return -1;
+
+	if (r->requests_num == r->max_requests)
+	{
+		r->max_requests = (r->max_requests ? r->max_requests * 2 : 256);
+		r->requests = (request*)realloc(r->requests, sizeof(request) * r->max_requests);
+		if (r->requests == 0) exit_with_error("can't grow requests");
+	}
+
+	if ((r->requests_num + 1) * 2 <= r->index_size) return;
+
+	free(r->index);
+	r->index_size = (r->index_size ? r->index_size * 2 : 512);
+	r->index = (int*)malloc(sizeof(int) * r->index_size);
+	if (r->index == 0) exit_with_error("can't grow requests index");
+	memset(r->index, 0xff, sizeof(int) * r->index_size);
+
+	for (i = 0; i < r->requests_num; i++)
+	{
+		s.packed_boxes = r->requests[i].packed_boxes;
+		s.connectivity = r->requests[i].connectivity;
+		s.out_of_plan  = r->requests[i].out_of_plan;
+		s.imagine      = r->requests[i].imagine;
+		r->index[find_index_slot(r, &s)] = i;
+	}
 }
 
 
@@ -80,30 +244,31 @@ void add_pack_request(score_element *s, helper *h)
 {
 	int i;
 
-	i = find_score_in_pack_requests(h->request->pack_requests, h->request->pack_requests_num, s);
+	i = find_score_in_pack_requests(h, s);
 	if (i != -1) return;
 
+	grow_pack_requests(h->request);
+
 	if (verbose >= 5)
 	printf("Adding pack cell: lvl: %2d tgts: %2d connectivity: %2d room: %2d\n",
 		s->boxes_in_level, s->boxes_on_targets, s->connectivity, s->rooms_score);
 
 	set_pack_request_from_score(h->request->pack_requests + h->request->pack_requests_num, s);
+	h->request->pack_index[find_pack_index_slot(h->request, s)] = h->request->pack_requests_num;
 
 	h->request->pack_requests_pos = h->request->pack_requests_num;
 	h->request->pack_requests_num++;
-
-	if (h->request->pack_requests_num >= MAX_REQUESTS)
-		exit_with_error("max requests");
-
 }
 
 void add_request(score_element *s, helper *h)
 {
 	int i;
 
-	i = find_score_in_requests(h->request->requests, h->request->requests_num, s);
+	i = find_score_in_requests(h, s);
 	if (i != -1) return;
 
+	grow_requests(h->request);
+
 	if (verbose >= 5)
 	printf("Adding cell: imagine: %2d connect: %2d OOP: %2d packed: %2d\n",
 		s->imagine,
@@ -112,12 +277,10 @@ void add_request(score_element *s, helper *h)
 		s->packed_boxes);
 
 	set_request_from_score(h->request->requests + h->request->requests_num, s);
+	h->request->index[find_index_slot(h->request, s)] = h->request->requests_num;
 
 	h->request->requests_pos = h->request->requests_num;
 	h->request->requests_num++;
-
-	if (h->request->requests_num >= MAX_REQUESTS)
-		exit_with_error("max requests");
 }
 
 void get_next_pack_request(pack_request *p, helper *h)
@@ -141,7 +304,7 @@ void get_next_request(request *p, helper *h)
 void get_pack_request_of_score(pack_request *p, score_element *s, helper *h)
 {
 	int i;
-	i = find_score_in_pack_requests(h->request->pack_requests, h->request->pack_requests_num, s);
+	i = find_score_in_pack_requests(h, s);
 	if (i == -1) exit_with_error("can't find pack request");
 	*p = h->request->pack_requests[i];
 }
@@ -149,7 +312,7 @@ void get_pack_request_of_score(pack_request *p, score_element *s, helper *h)
 void get_request_of_score(request *p, score_element *s, helper *h)
 {
 	int i;
-	i = find_score_in_requests(h->request->requests, h->request->requests_num, s);
+	i = find_score_in_requests(h, s);
 	if (i == -1) exit_with_error("can't find request");
 	*p = h->request->requests[i];
 }
@@ -158,7 +321,7 @@ void set_next_pack_request_to_score(score_element *s, helper *h)
 {
 	int i;
 
-	i = find_score_in_pack_requests(h->request->pack_requests, h->request->pack_requests_num, s);
+	i = find_score_in_pack_requests(h, s);
 	if (i == -1) exit_with_error("can't find pack request");
 
 	h->request->pack_requests_pos = i;	
@@ -167,7 +330,7 @@ void set_next_pack_request_to_score(score_element *s, helper *h)
 void set_next_request_to_score(score_element *s, helper *h)
 {
 	int i;
-	i = find_score_in_requests(h->request->requests, h->request->requests_num, s);
+	i = find_score_in_requests(h, s);
 	if (i == -1) exit_with_error("can't find request");
 
 	h->request->requests_pos = i;
@@ -187,9 +350,9 @@ void print_request(request *req)
 int get_label_of_score(score_element *s, int pull_mode, helper *h)
 {
 	if (pull_mode == 0)
-		return find_score_in_requests(h->request->requests, h->request->requests_num, s);
+		return find_score_in_requests(h, s);
 
-	return find_score_in_pack_requests(h->request->pack_requests, h->request->pack_requests_num, s);
+	return find_score_in_pack_requests(h, s);
 }
 
 int get_label_of_request(request *p, helper *h)
@@ -7,6 +7,9 @@
 #include "score.h"
 #include "helper.h"
 
+void free_request_data(request_data *r);
+void print_request_stats(helper *h);
+
 void init_pack_requets(helper *h);
 void add_pack_request(score_element *s, helper *h);
 void get_next_pack_request(pack_request *p, helper *h);
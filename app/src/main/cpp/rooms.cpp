@@ -8,11 +8,6 @@
 #include "bfs.h"
 #include "util.h"
 
-int_board rooms_board;
-int rooms_num;
-
-int base_graph[MAX_ROOMS][MAX_ROOMS];
-
 void rooms_bfs(board b, int start_y, int start_x, int color, 
 	int seen_during_bfs[MAX_ROOMS], board visited)
 {
@@ -30,7 +25,7 @@ void rooms_bfs(board b, int start_y, int start_x, int color,
 
 	zero_board(bfs_visited);
 
-	for (i = 0; i < rooms_num; i++)
+	for (i = 0; i < current_level->rooms_num; i++)
 		seen_during_bfs[i] = 0;
 
 	current_x[0] = start_x;
@@ -49,7 +44,7 @@ void rooms_bfs(board b, int start_y, int start_x, int color,
 				x = current_x[i] + delta_x[j];
 				y = current_y[i] + delta_y[j];
 
-				seen_color = rooms_board[y][x];
+				seen_color = current_level->rooms_board[y][x];
 				if ((seen_color != 1000000) && (seen_color != color))
 				{
 					seen_during_bfs[seen_color] = 1;
@@ -98,33 +93,33 @@ void get_current_graph(board b, int current_graph[MAX_ROOMS][MAX_ROOMS])
 	zero_board(visited);
 	// visited are the color rooms seen in previous BFSs
 
-	for (i = 0; i < rooms_num; i++)
-		for (j = 0; j < rooms_num; j++)
+	for (i = 0; i < current_level->rooms_num; i++)
+		for (j = 0; j < current_level->rooms_num; j++)
 			current_graph[i][j] = 1;
 
-	for (i = 0; i < rooms_num; i++)
+	for (i = 0; i < current_level->rooms_num; i++)
 		current_graph[i][i] = 0;
 
-	for (i = 0; i < rooms_num; i++)
+	for (i = 0; i < current_level->rooms_num; i++)
 		color_processed[i] = 0;
 
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (inner[i][j] == 0) continue;
+			if (current_level->inner[i][j] == 0) continue;
 			if (b[i][j] & OCCUPIED) continue;
 			if (visited[i][j]) continue;
 
-			color = rooms_board[i][j];
+			color = current_level->rooms_board[i][j];
 			if (color == 1000000) continue;
 
 			color_processed[color] = 1;
 
             rooms_bfs(b, i, j, color, seen_during_bfs, visited);
 
-			for (k = 0; k < rooms_num; k++)
+			for (k = 0; k < current_level->rooms_num; k++)
 			if (seen_during_bfs[k] == 0)
 			{
 				current_graph[color][k] = 0;
@@ -134,10 +129,10 @@ void get_current_graph(board b, int current_graph[MAX_ROOMS][MAX_ROOMS])
 	}
 
 	// apply correction for rooms full of boxes
-	for (i = 0 ; i < rooms_num ; i++)
+	for (i = 0 ; i < current_level->rooms_num ; i++)
 		if (color_processed[i] == 0)
 		{
-			for (j = 0; j < rooms_num; j++)
+			for (j = 0; j < current_level->rooms_num; j++)
 			{
 				current_graph[i][j] = 0;
 				current_graph[j][i] = 0;
@@ -150,9 +145,9 @@ void print_current_graph(int current_graph[MAX_ROOMS][MAX_ROOMS])
 {
 	int i, j;
 
-	for (i = 0; i < rooms_num; i++)
+	for (i = 0; i < current_level->rooms_num; i++)
 	{
-		for (j = 0; j < rooms_num; j++)
+		for (j = 0; j < current_level->rooms_num; j++)
 			printf("%d", current_graph[i][j]);
 		printf("\n");
 	}
@@ -168,8 +163,8 @@ void new_mark_rooms(board b)
 
 	zero_board(squares);
 
-	for (i = 0; i < (height - 1); i++)
-		for (j = 0; j < (width - 1); j++)
+	for (i = 0; i < (current_level->height - 1); i++)
+		for (j = 0; j < (current_level->width - 1); j++)
 		{
 			if (b[i][j] == 0)
 				if (b[i][j + 1] == 0)
@@ -180,8 +175,8 @@ void new_mark_rooms(board b)
 
 	// remove stand-alone squares - too small to be considered rooms
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (squares[i][j] == 1)
 				if (squares[i - 1][j] == 0)
@@ -194,34 +189,34 @@ void new_mark_rooms(board b)
 	// look for connected components
 	negate_board(squares);
 
-	rooms_num = mark_connectivities(squares, tmp_rooms_board);
+	current_level->rooms_num = mark_connectivities(squares, tmp_rooms_board);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			rooms_board[i][j] = 1000000;
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			current_level->rooms_board[i][j] = 1000000;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{ 
 			v = tmp_rooms_board[i][j];
 			if (v == 1000000) continue;
 
-			rooms_board[i][j] = v;
-			rooms_board[i][j+1] = v;
-			rooms_board[i+1][j] = v;
-			rooms_board[i+1][j+1] = v;
+			current_level->rooms_board[i][j] = v;
+			current_level->rooms_board[i][j+1] = v;
+			current_level->rooms_board[i+1][j] = v;
+			current_level->rooms_board[i+1][j+1] = v;
 		}
 
 	// remove cells shared between rooms
 	
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (squares[i][j] == squares[i + 1][j + 1])
 				if (squares[i + 1][j] == squares[i][j + 1])
 					if (squares[i][j] != squares[i + 1][j])
 					{
-						rooms_board[i + 1][j + 1] = 1000000;
+						current_level->rooms_board[i + 1][j + 1] = 1000000;
 					}
 		}
 		
@@ -240,25 +235,25 @@ int analyse_rooms(board b_inp)
     new_mark_rooms(b);
 
 	if (verbose >= 5)
-		printf("%d rooms\n", rooms_num);
+		printf("%d rooms\n", current_level->rooms_num);
 
-	if (rooms_num > MAX_ROOMS)
+	if (current_level->rooms_num > MAX_ROOMS)
 	{
-		strcpy(global_fail_reason, "too many rooms");
-		rooms_num = 0;
+		strcpy(current_level->fail_reason, "too many rooms");
+		current_level->rooms_num = 0;
 		return 1;
 	}
 
 	if (verbose >= 5)
-		print_board_with_zones(b, rooms_board);
+		print_board_with_zones(b, current_level->rooms_board);
 
 	clear_boxes(b, c);
 	get_current_graph(c, current_graph);
 //	print_current_graph(current_graph);
 
-	for (i = 0; i < rooms_num; i++)
-		for (j = 0; j < rooms_num; j++)
-			base_graph[i][j] = current_graph[i][j];
+	for (i = 0; i < current_level->rooms_num; i++)
+		for (j = 0; j < current_level->rooms_num; j++)
+			current_level->base_graph[i][j] = current_graph[i][j];
 
 	return 1;
 }
@@ -270,13 +265,13 @@ int score_rooms(board b)
 	int sum = 0;
 	int current_graph[MAX_ROOMS][MAX_ROOMS];
 
-	if (rooms_num <= 1)	return 0;
+	if (current_level->rooms_num <= 1)	return 0;
 
 	get_current_graph(b, current_graph);
 
-	for (i = 0; i < rooms_num;i++)
-		for (j = 0; j < rooms_num; j++)
-			sum += base_graph[i][j] - current_graph[i][j];
+	for (i = 0; i < current_level->rooms_num;i++)
+		for (j = 0; j < current_level->rooms_num; j++)
+			sum += current_level->base_graph[i][j] - current_graph[i][j];
 
 	if (sum % 2) exit_with_error("odd");
 
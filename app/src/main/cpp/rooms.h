@@ -6,5 +6,3 @@
 int analyse_rooms(board b_inp);
 int score_rooms(board b);
 
-extern int_board rooms_board;
-extern int rooms_num;
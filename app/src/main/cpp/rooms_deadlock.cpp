@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "rooms_deadlock.h"
 #include "rooms.h"
@@ -9,8 +10,17 @@
 #include "deadlock_cache.h"
 #include "bfs.h"
 
-board room_with_corridors[MAX_ROOMS];
-int room_size[MAX_ROOMS];
+typedef struct rooms_deadlock_data
+{
+	board room_with_corridors[MAX_ROOMS];
+	int room_size[MAX_ROOMS];
+} rooms_deadlock_data;
+
+void allocate_rooms_deadlock_data(level_context *l)
+{
+	l->rooms_deadlock = (rooms_deadlock_data*)calloc(1, sizeof(rooms_deadlock_data));
+	if (l->rooms_deadlock == 0) exit_with_error("can't allocate rooms deadlock data\n");
+}
 
 int debug_rooms_deadlock = 0;
 
@@ -19,29 +29,29 @@ void init_rooms_deadlock()
 	int t, i, j, k;
 	board b;
 
-	copy_board(initial_board, b);
+	copy_board(current_level->initial_board, b);
 	clear_boxes_inplace(b);
 
-	for (t = 0; t < rooms_num; t++)
+	for (t = 0; t < current_level->rooms_num; t++)
 	{
-		zero_board(room_with_corridors[t]);
+		zero_board(current_level->rooms_deadlock->room_with_corridors[t]);
 
-		for (i = 0; i < height; i++)
-			for (j = 0; j < width; j++)
+		for (i = 0; i < current_level->height; i++)
+			for (j = 0; j < current_level->width; j++)
 			{
-				if (rooms_board[i][j] == t)
+				if (current_level->rooms_board[i][j] == t)
 				{
-					room_with_corridors[t][i][j] = 1;
+					current_level->rooms_deadlock->room_with_corridors[t][i][j] = 1;
 
 					for (k = 0; k < 4; k++)
 					{
 						if ((b[i + delta_y[k]][j + delta_x[k]] & OCCUPIED) == 0)
-							room_with_corridors[t][i + delta_y[k]][j+delta_x[k]] = 1;
+							current_level->rooms_deadlock->room_with_corridors[t][i + delta_y[k]][j+delta_x[k]] = 1;
 					}
 				}
 			}
 
-		room_size[t] = board_popcnt(room_with_corridors[t]);
+		current_level->rooms_deadlock->room_size[t] = board_popcnt(current_level->rooms_deadlock->room_with_corridors[t]);
 	}
 }
 
@@ -62,9 +72,9 @@ int reduce_moves_in_rooms_deadlock_search(move *moves, int moves_num, helper *h)
 	{
 		index_to_y_x(moves[i].to, &y, &x);
 
-		if (rooms_board[y][x] == 1000000) continue;
+		if (current_level->rooms_board[y][x] == 1000000) continue;
 
-		if (rooms_board[y][x] != h->tested_deadlock_room)
+		if (current_level->rooms_board[y][x] != h->tested_deadlock_room)
 		{
 			moves[0] = moves[i];
 			moves[0].kill = 1;
@@ -80,9 +90,9 @@ int boxes_in_room(board b, int r)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (room_with_corridors[r][i][j])
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->rooms_deadlock->room_with_corridors[r][i][j])
 				if (b[i][j] & BOX)
 					sum++;
 	return sum;
@@ -107,31 +117,7 @@ int is_better_rooms_deadlock_score(score_element *new_score, score_element *old_
 
 int get_best_rooms_deadlock_move(position *positions, int pos_num, int *son)
 {
-	int i, j;
-	position *p;
-	int best_pos = -1;
-	score_element best_score;
-
-	for (i = 0; i < pos_num; i++)
-	{
-		p = positions + i;
-		if (p->position_deadlocked) continue;
-
-		for (j = 0; j < p->moves_num; j++)
-		{
-			if (p->move_deadlocked[j]) continue;
-			if (p->place_in_positions[j]) continue;
-
-			if ((best_pos == -1) || (is_better_rooms_deadlock_score(p->scores + j, &best_score)))
-			{
-				best_pos = i;
-				*son = j;
-				best_score = p->scores[j];
-			}
-		}
-	}
-
-	return best_pos;
+	return best_frontier_move(positions, pos_num, son, is_better_rooms_deadlock_score);
 }
 
 
@@ -204,7 +190,7 @@ int rooms_deadlock_search_actual(board b, int pull_mode, int tested_deadlock_roo
 		}
 	}
 
-	free_positions(positions, MAX_ROOMS_DEADLOCK_SEARCH);
+	free_positions(positions);
 
 	return res;
 }
@@ -253,9 +239,9 @@ void keep_boxes_in_room(board b, int r)
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (room_with_corridors[r][i][j] == 0)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->rooms_deadlock->room_with_corridors[r][i][j] == 0)
 				b[i][j] &= ~BOX;
 
 	expand_sokoban_cloud(b);
@@ -270,7 +256,7 @@ int is_rooms_deadlock(board b_in, int pull_mode, move *last_move)
 
 	if (last_move->base || last_move->kill) return 0;
 
-	if (rooms_num == 1) return 0;
+	if (current_level->rooms_num == 1) return 0;
 
 	index_to_y_x(last_move->to, &y, &x);
 
@@ -284,18 +270,18 @@ int is_rooms_deadlock(board b_in, int pull_mode, move *last_move)
 	if (pull_mode)
 		clear_bases_inplace(b);
 
-	for (t = 0; t < rooms_num; t++)
+	for (t = 0; t < current_level->rooms_num; t++)
 	{
 		// check if the box was moved to room t
-		if (room_with_corridors[t][y][x] == 0) continue;
+		if (current_level->rooms_deadlock->room_with_corridors[t][y][x] == 0) continue;
 
-		if (room_size[t] >= 25) continue;
+		if (current_level->rooms_deadlock->room_size[t] >= 25) continue;
 
 		n = boxes_in_room(b, t);
 		if ((n <= 1) || (n > 5)) continue;
 
-		if ((n == 5) && (room_size[t] > 17)) continue;
-		if ((n == 4) && (room_size[t] > 20)) continue;
+		if ((n == 5) && (current_level->rooms_deadlock->room_size[t] > 17)) continue;
+		if ((n == 4) && (current_level->rooms_deadlock->room_size[t] > 20)) continue;
 
 		tested_deadlock_room = t;
 
@@ -312,5 +298,5 @@ int is_rooms_deadlock(board b_in, int pull_mode, move *last_move)
 
 int is_in_room_with_corridor(int r, int y, int x)
 {
-	return room_with_corridors[r][y][x];
+	return current_level->rooms_deadlock->room_with_corridors[r][y][x];
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "moves.h"
 #include "helper.h"
 
+void allocate_rooms_deadlock_data(level_context *l);
 void init_rooms_deadlock();
 int reduce_moves_in_rooms_deadlock_search(move *moves, int moves_num, helper *h);
 
@@ -41,17 +41,17 @@ void init_scored_distance(board b, int pull_mode, helper *h)
 
 	zero_int_board(h->scored_distance);
 
-	for (from = 0; from < index_num; from++)
+	for (from = 0; from < current_level->index_num; from++)
 	{
 		index_to_y_x(from, &from_y, &from_x);
 
-		for (to = 0; to < index_num; to++)
+		for (to = 0; to < current_level->index_num; to++)
 		{
 			index_to_y_x(to, &to_y, &to_x);
 
 			if (b[to_y][to_x] & TARGET)
-				if (distance_from_to[from][to] != 1000000)
-					(h->scored_distance)[from_y][from_x] += distance_from_to[from][to];
+				if (get_push_distance(from, to) != 1000000)
+					(h->scored_distance)[from_y][from_x] += get_push_distance(from, to);
 		}
 	}
 }
@@ -62,8 +62,8 @@ int get_scored_distance(board b, helper *h)
 	int sum = 0;
 	int i, j;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				sum += (h->scored_distance)[i][j];
 	return sum;
@@ -227,12 +227,62 @@ int is_better_score(score_element *new_score, score_element* old_score, int pull
 }
 
 
+int add_key_field(UINT_64 *key, int bits, int value, int smaller_is_better)
+{
+	// appends a field to the key, so that a larger key is a better score
+	if ((value < 0) || (value >= (1 << bits))) return 0;
+
+	if (smaller_is_better)
+		value = (1 << bits) - 1 - value;
+
+	*key = (*key << bits) | (UINT_64)value;
+	return 1;
+}
+
+int get_score_key(score_element *s, int pull_mode, int search_mode, UINT_64 *key)
+{
+	// Packs the fields that is_better_score compares into one integer, so the tree queues
+	// can compare two scores without dispatching on the search mode.
+	// For modes with a key, a has a larger key than b iff is_better_score(a, b).
+	// Returns 0 if the mode has no key or a field is out of range; then the caller
+	// should fall back to is_better_score.
+
+	*key = 0;
+
+	if (search_mode == K_DIST_SEARCH)
+	{
+		return add_key_field(key, 16, s->boxes_in_level, 1) &&
+			add_key_field(key, 16, s->connectivity, 1);
+	}
+
+	if ((search_mode != NORMAL) && (search_mode != BASE_SEARCH) && (search_mode != FORWARD_WITH_BASES))
+		return 0;
+
+	if (pull_mode == 0)
+	{
+		return add_key_field(key, 8, s->boxes_in_level, 1) &&
+			add_key_field(key, 8, s->packed_boxes, 0) &&
+			add_key_field(key, 8, s->connectivity, 1) &&
+			add_key_field(key, 8, s->rooms_score, 1) &&
+			add_key_field(key, 8, s->out_of_plan, 1) &&
+			add_key_field(key, 8, s->hotspots, 1) &&
+			add_key_field(key, 16, s->dist_to_targets, 0);
+	}
+
+	return add_key_field(key, 8, s->boxes_in_level, 1) &&
+		add_key_field(key, 12, s->connectivity, 1) &&
+		add_key_field(key, 8, s->boxes_on_targets, 1) &&
+		add_key_field(key, 12, s->rooms_score, 1) &&
+		add_key_field(key, 24, s->dist_to_targets, 0);
+}
+
+
 void score_board(board b, score_element *s, int pull_mode, int search_mode, helper *h)
 {
 	s->boxes_on_targets = 0; 
 	s->dist_to_targets = 0;
 	s->dist_to_imagined = 0;
-	s->boxes_in_level = global_boxes_in_level;
+	s->boxes_in_level = current_level->boxes_in_level;
 	s->connectivity = 0;
 	s->rooms_score = 0;
 	s->packed_boxes = 0;
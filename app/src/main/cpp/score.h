@@ -30,6 +30,7 @@ typedef struct
 void init_scored_distance(board b, int pull_mode, helper *h);
 void print_score(score_element *s, int pull_mode, int search_mode);
 int is_better_score(score_element *new_score, score_element* old_score, int pull_mode, int search_mode);
+int get_score_key(score_element *s, int pull_mode, int search_mode, UINT_64 *key);
 void score_board(board b, score_element *s, int pull_mode, int search_mode, helper *h);
 int get_scored_distance(board b, helper* h);
 
@@ -0,0 +1,71 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#include <stdlib.h>
+
+#include "scratch.h"
+#include "global.h"
+#include "util.h"
+
+// Released buffers are kept per type. Calls may nest (a graph routine that calls another
+// graph routine), so a few buffers of each type are kept.
+
+#define MAX_FREE_SCRATCH 8
+
+typedef struct scratch_header // keeps the data 16 bytes aligned
+{
+	size_t size;
+	size_t pad;
+} scratch_header;
+
+THREAD_LOCAL scratch_header *free_scratch[SCRATCH_TYPES][MAX_FREE_SCRATCH];
+THREAD_LOCAL int free_scratch_num[SCRATCH_TYPES];
+
+
+void *get_scratch(int type, size_t size)
+{
+	scratch_header *s = 0;
+
+	if (free_scratch_num[type] > 0)
+	{
+		s = free_scratch[type][--free_scratch_num[type]];
+
+		if (s->size < size) // left from a smaller level
+		{
+			free(s);
+			s = 0;
+		}
+	}
+
+	if (s == 0)
+	{
+		s = (scratch_header*)malloc(sizeof(scratch_header) + size);
+		if (s == 0) exit_with_error("can't allocate scratch buffer");
+		s->size = size;
+	}
+
+	return s + 1;
+}
+
+void release_scratch(int type, void *p)
+{
+	scratch_header *s = ((scratch_header*)p) - 1;
+
+	if (free_scratch_num[type] == MAX_FREE_SCRATCH)
+	{
+		free(s);
+		return;
+	}
+
+	free_scratch[type][free_scratch_num[type]++] = s;
+}
+
+void free_thread_scratch()
+{
+	// called by a thread before it exits
+	int i;
+
+	for (i = 0; i < SCRATCH_TYPES; i++)
+		while (free_scratch_num[i] > 0)
+			free(free_scratch[i][--free_scratch_num[i]]);
+}
@@ -0,0 +1,22 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#ifndef __SCRATCH
+#define __SCRATCH
+
+#include <stddef.h>
+
+// Scratch buffers that are needed for the duration of one call (graphs, hungarian matrices).
+// Each thread keeps the buffers it released and hands them out again, so the hot paths
+// don't call malloc or touch fresh pages on every expansion.
+
+#define SCRATCH_GRAPH           0
+#define SCRATCH_HUNGARIAN       1
+#define SCRATCH_HUNGARIAN_CACHE 2
+#define SCRATCH_TYPES           3
+
+void *get_scratch(int type, size_t size);
+void release_scratch(int type, void *p);
+void free_thread_scratch();
+
+#endif
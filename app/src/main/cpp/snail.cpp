@@ -6,31 +6,37 @@
 #include "bfs.h"
 #include "snail.h"
 
-int snail_level_detected;
-int snail_target_y, snail_target_x;
+typedef struct snail_data
+{
+	int snail_target_y, snail_target_x;
+	board netlock_grid;
 
-int netlock_level_detected;
-board netlock_grid;
+	int_board snail_dist; // from snail target
+	board snail_chain;
+	int snail_chain_len;
+} snail_data;
 
-int_board snail_dist; // from snail target
-board snail_chain;
-int snail_chain_len;
+void allocate_snail_data(level_context *l)
+{
+	l->snail = (snail_data*)calloc(1, sizeof(snail_data));
+	if (l->snail == 0) exit_with_error("can't allocate snail data\n");
+}
 
 void set_netlock_grid()
 {
 	int i, j;
 	int sum = 0;
 
-	zero_board(netlock_grid);
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (inner[i][j])
-				if (((i ^ snail_target_y) & 1) == 0)
-					if (((j ^ snail_target_x) & 1) == 0)
-						netlock_grid[i][j] = 1;
+	zero_board(current_level->snail->netlock_grid);
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->inner[i][j])
+				if (((i ^ current_level->snail->snail_target_y) & 1) == 0)
+					if (((j ^ current_level->snail->snail_target_x) & 1) == 0)
+						current_level->snail->netlock_grid[i][j] = 1;
 
 	if (verbose >= 5)
-		show_on_initial_board(netlock_grid);
+		show_on_initial_board(current_level->snail->netlock_grid);
 }
 
 int simple_box_can_be_pulled(board b, int y, int x)
@@ -50,8 +56,8 @@ int pullable_boxes(board b)
 {
 	int i, j, res = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				res += simple_box_can_be_pulled(b, i, j);
 	return res;
@@ -71,13 +77,13 @@ void compute_pull_order(board b_in, int_board order)
 	copy_board(b_in, b);
 	zero_board(visited);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			order[i][j] = -1;
 
 	// initialize the first layer of pullable boxes
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 				if (simple_box_can_be_pulled(b, i, j))
 				{
@@ -152,29 +158,29 @@ void analyze_chain(board b)
 	int peel_from_y, peel_from_x;
 
 	board not_targets;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			not_targets[i][j] = (b[i][j] & TARGET ? 0 : 1);
 
 
 	// find the connected chain
-	init_dist(snail_dist);
-	bfs_from_place(not_targets, snail_dist, snail_target_y, snail_target_x, 1);
+	init_dist(current_level->snail->snail_dist);
+	bfs_from_place(not_targets, current_level->snail->snail_dist, current_level->snail->snail_target_y, current_level->snail->snail_target_x, 1);
 
 	// determine where the chain starts (which box must be pulled first)
 
-	snail_chain_len = -1;
-	zero_board(snail_chain);
+	current_level->snail->snail_chain_len = -1;
+	zero_board(current_level->snail->snail_chain);
 
-	for (i = 0 ; i < height ; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0 ; i < current_level->height ; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (snail_dist[i][j] == 1000000) continue;
+			if (current_level->snail->snail_dist[i][j] == 1000000) continue;
 
-			snail_chain[i][j] = 1;
-			if (snail_dist[i][j] > snail_chain_len)
+			current_level->snail->snail_chain[i][j] = 1;
+			if (current_level->snail->snail_dist[i][j] > current_level->snail->snail_chain_len)
 			{
-				snail_chain_len = snail_dist[i][j];
+				current_level->snail->snail_chain_len = current_level->snail->snail_dist[i][j];
 				peel_from_y = i;
 				peel_from_x = j;
 			}
@@ -182,25 +188,25 @@ void analyze_chain(board b)
 
 //	printf("%d %d %d\n", peel_from_y, peel_from_x, snail_chain_len);
 
-	init_dist(snail_dist);
-	bfs_from_place(not_targets, snail_dist, peel_from_y, peel_from_x, 1);
+	init_dist(current_level->snail->snail_dist);
+	bfs_from_place(not_targets, current_level->snail->snail_dist, peel_from_y, peel_from_x, 1);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (snail_dist[i][j] != 1000000)
-				snail_dist[i][j] = snail_chain_len - snail_dist[i][j];
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->snail->snail_dist[i][j] != 1000000)
+				current_level->snail->snail_dist[i][j] = current_level->snail->snail_chain_len - current_level->snail->snail_dist[i][j];
 
 
 //	print_int_board(snail_dist, 1);
 //	my_getch();
 
 
-	snail_chain_len++;
+	current_level->snail->snail_chain_len++;
 
 	if (verbose >= 4)
 	{
-		print_int_board(snail_dist, 1);
-		printf("snail chain len: %d\n", snail_chain_len);
+		print_int_board(current_level->snail->snail_dist, 1);
+		printf("snail chain len: %d\n", current_level->snail->snail_chain_len);
 	}
 }
 
@@ -213,23 +219,23 @@ void detect_snail_level(board b_in)
 	int_board order;
 	int max_difficulty = -1;
 
-	snail_level_detected = 0;
-	netlock_level_detected = 0;
+	current_level->snail_level_detected = 0;
+	current_level->netlock_level_detected = 0;
 
 	copy_board(b_in, b);
 	enter_reverse_mode(b, 0);
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if ((initial_board[i][j] & BOX) == 0)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if ((current_level->initial_board[i][j] & BOX) == 0)
 				b[i][j] &= ~BOX;
 
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & TARGET) == 0) continue;
-			if ((initial_board[i][j] & BOX)) continue;
+			if ((current_level->initial_board[i][j] & BOX)) continue;
 
 
 			b[i][j] |= BOX;
@@ -239,8 +245,8 @@ void detect_snail_level(board b_in)
 			if (order[i][j] > max_difficulty)
 			{
 				max_difficulty = order[i][j];
-				snail_target_y = i;
-				snail_target_x = j;
+				current_level->snail->snail_target_y = i;
+				current_level->snail->snail_target_x = j;
 			}
 		}
 
@@ -248,10 +254,10 @@ void detect_snail_level(board b_in)
 
 	if (max_difficulty >= 20)
 	{ 
-		snail_level_detected = 1;
+		current_level->snail_level_detected = 1;
 
 		if (verbose >= 4)
-			printf("snail target= %d %d. len= %d\n", snail_target_y, snail_target_x, max_difficulty);
+			printf("snail target= %d %d. len= %d\n", current_level->snail->snail_target_y, current_level->snail->snail_target_x, max_difficulty);
 		analyze_chain(b);
 		return;
 	}
@@ -259,9 +265,9 @@ void detect_snail_level(board b_in)
 	if (max_difficulty >= 10)
 	{
 		if (verbose >= 4)
-			printf("netlock target= %d %d. len= %d\n", snail_target_y, snail_target_x, max_difficulty);
+			printf("netlock target= %d %d. len= %d\n", current_level->snail->snail_target_y, current_level->snail->snail_target_x, max_difficulty);
 
-		netlock_level_detected = 1;
+		current_level->netlock_level_detected = 1;
 	}
 }
 
@@ -274,8 +280,8 @@ int touched_boxes(board b)
 
 	int i, j, k;
 
-	for (i= 0; i < height ; i++)
-		for (j = 0; j < width; j++)
+	for (i= 0; i < current_level->height ; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -292,8 +298,8 @@ int count_101(board b)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 			if (b[i][j] & BOX)
 			{
 				if ((b[i][j + 1] & OCCUPIED) == 0)
@@ -315,8 +321,8 @@ int unlikely_pattern(board b)
 	int i, j, k;
 	int res = 0, sum = 0;
 
-	for (i = 0 ; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0 ; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -335,17 +341,17 @@ int snail_packed(board b)
 	int i, j;
 	int seq[1000];
 
-	for (i = 0; i < snail_chain_len; i++)
+	for (i = 0; i < current_level->snail->snail_chain_len; i++)
 		seq[i] = 1;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (snail_chain[i][j])
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->snail->snail_chain[i][j])
 				if ((b[i][j] & BOX) == 0)
-					seq[snail_dist[i][j]] = 0;
+					seq[current_level->snail->snail_dist[i][j]] = 0;
 
 
-	for (i = 1; i < snail_chain_len; i++)
+	for (i = 1; i < current_level->snail->snail_chain_len; i++)
 		if (seq[i] == 0)
 			return i;
 
@@ -359,7 +365,7 @@ int boxes_on_grid(board b);
 
 void fill_snail_scores(board b, score_element* s, int alg_type)
 {
-	if (b[snail_target_y][snail_target_x] & BOX)
+	if (b[current_level->snail->snail_target_y][current_level->snail->snail_target_x] & BOX)
 		s->out_of_plan = 1; // not solved yet
 	else
 		s->out_of_plan = 0;
@@ -367,7 +373,7 @@ void fill_snail_scores(board b, score_element* s, int alg_type)
 	if (alg_type == 0) 
 		s->dist_to_imagined = unlikely_pattern(b);
 
-	s->biconnect = global_boxes_in_level - touched_boxes(b);
+	s->biconnect = current_level->boxes_in_level - touched_boxes(b);
 
 	if (s->out_of_plan == 1) // did not solve yet
 	{
@@ -421,7 +427,7 @@ void print_score_in_snail_mode(score_element* s, int pull_mode)
 
 int set_snail_parameters(int search_type, int pull_mode, helper* h)
 {
-	if (snail_level_detected == 0) return search_type;
+	if (current_level->snail_level_detected == 0) return search_type;
 
 	if (pull_mode == 0)
 	{
@@ -470,16 +476,16 @@ int netlock_score(board b)
 	int res;
 	int_board order;
 
-	if ((b[snail_target_y][snail_target_x] & BOX) == 0)
+	if ((b[current_level->snail->snail_target_y][current_level->snail->snail_target_x] & BOX) == 0)
 		return 0;
 			
 	copy_board(b, c);
 
 	compute_pull_order(c, order);
 
-	res = order[snail_target_y][snail_target_x];
+	res = order[current_level->snail->snail_target_y][current_level->snail->snail_target_x];
 
-	if (b[snail_target_y][snail_target_x] & BOX)
+	if (b[current_level->snail->snail_target_y][current_level->snail->snail_target_x] & BOX)
 		if (res == -1)
 			return 1000;
 
@@ -491,9 +497,9 @@ int boxes_on_grid(board b)
 	int i, j;
 	int sum = 0;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
-			if (netlock_grid[i][j])
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
+			if (current_level->snail->netlock_grid[i][j])
 				if (b[i][j] & BOX)
 					sum++;
 
@@ -561,7 +567,7 @@ void print_score_in_netlock_mode(score_element* s)
 
 int set_netlock_parameters(int search_type, int pull_mode, helper* h)
 {
-	if (netlock_level_detected == 0) return search_type;
+	if (current_level->netlock_level_detected == 0) return search_type;
 
 	if (pull_mode == 0)
 	{
@@ -10,6 +10,12 @@
 #include <pthread.h>
 #endif
 
+#ifdef LINUX
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+
 #include "global.h"
 #include "board.h"
 #include "distance.h"
@@ -39,73 +45,31 @@
 #include "stuck.h"
 #include "dragonfly.h"
 #include "snail.h"
-
-tree search_trees[8];
-helper helpers[8];
+#include "scratch.h"
+#include "knowledge.h"
+#include "speculate.h"
 
 int forced_alg = -1;
 //int forced_alg = 0;
 
-#define FROM_LEVEL 1
-
-void allocate_search_trees()
-{
-	int log_size = 23; // about 1.5GB per core
-	int i;
-
-	if ((cores_num != 1) && (cores_num != 2) && (cores_num != 4) && (cores_num != 8))
-		exit_with_error("Number of cores should be 1/2/4/8");
-
-#ifdef VISUAL_STUDIO
-	log_size = 22; // should fit in a the 2GB memory limit...
-#endif
-
-	log_size += extra_mem;
-
-	for (i = 0; i < cores_num; i++)
-	{
-		if (i == 7) log_size -= 3; // dragonfly does not need the tree
-
-		if (verbose >= 4) printf("Allocating search tree for core %d\n", i);
-		init_tree(&search_trees[i], log_size);
-	}
-}
-
-void free_search_trees()
-{
-	int i;
-	for (i = 0; i < cores_num; i++)
-		free_tree(search_trees + i);
-}
-
-
-void allocate_helpers()
-{
-	int i;
-
-	for (i = 0; i < cores_num; i++)
-	{
-		init_helper(helpers + i);
-		init_helper_extra_fields(helpers + i);
-		helpers[i].my_core = i;
-	}
-}
+#define MAX_BATCH_WORKERS 256
+int batch_size = 1; // number of levels that are solved at the same time
 
-void free_helpers()
-{
-	int i;
+#define FROM_LEVEL 1
 
-	for (i = 0; i < cores_num; i++)
-		free_helper(helpers + i);
-}
+// longer limits are taken as "unlimited". About six days, so that the strategies can still
+// multiply their share of the time in an int.
+#define MAX_TIME_LIMIT_MS (1 << 29)
 
-int preprocess_level(board b)
+int preprocess_level(level_context *l, board b)
 {
 	int res;
 
-	strcpy(global_fail_reason, "Unknown reason");
+	current_level = l;
 
-	if ((height == 0) || (width == 0)) return 0;
+	strcpy(current_level->fail_reason, "Unknown reason");
+
+	if ((current_level->height == 0) || (current_level->width == 0)) return 0;
 
 	if (sanity_checks(b) == 0)
 		return 0;
@@ -113,6 +77,7 @@ int preprocess_level(board b)
 	clear_deadlock_cache();
 	clear_k_dist_hash();
 	clear_perimeter();
+	clear_deadlock_stats();
 
 	turn_decorative_boxes_to_walls(b);
 	close_holes_in_board(b);
@@ -129,7 +94,7 @@ int preprocess_level(board b)
 
 	if (verbose >= 3)
 	{
-		printf("\nLevel %d:\n", level_id);
+		printf("\nLevel %d:\n", current_level->level_id);
 		print_board(b);
 	}
 
@@ -142,13 +107,15 @@ int preprocess_level(board b)
 
 	init_hotspots(b);
 
-	build_mpdb2();
-	build_pull_mpdb2();
+	init_stuck_patterns();
+	load_knowledge();
+
+	if (knowledge_was_loaded(KB_MPDB) == 0)      build_mpdb2();
+	if (knowledge_was_loaded(KB_PULL_MPDB) == 0) build_pull_mpdb2();
 
 	init_envelope_patterns();
 	
 	init_girl_variables(b);
-	init_stuck_patterns();
 
 	detect_snail_level(b);
 
@@ -169,7 +136,7 @@ int setup_plan_features(int search_type, helper *h)
 	{
 		if (verbose >= 4)
 			printf("No packing order\n");
-		strcpy(global_fail_reason, "Could not find packing order");
+		strcpy(current_level->fail_reason, "Could not find packing order");
 		return 0;
 	}
 
@@ -188,8 +155,6 @@ int setup_plan_features(int search_type, helper *h)
 
 void packing_search_control(board b, int time_allocation, int search_type, tree* t, helper* h)
 {
-	int end_time = (int)time(0) + time_allocation;
-
 	if (time_allocation <= 0) return;
 
 	h->weighted_search = 1;
@@ -216,13 +181,13 @@ void packing_search_control(board b, int time_allocation, int search_type, tree*
 	packing_search(b, time_allocation, search_type, t, h);
 }
 
-void forward_search_control(board b, int time_allocation, int search_type, tree* t, helper* h)
+void forward_search_control(board b, int time_allocation, int search_type, int weighted, tree* t, helper* h)
 {
-	int end_time = (int)time(0) + time_allocation;
+	UINT_64 local_end_ms = get_time_in_ms() + time_allocation;
 
 	if (time_allocation <= 0) return;
 
-	h->weighted_search = 1;
+	h->weighted_search = weighted;
 
 	search_type = set_snail_parameters(search_type, 0, h);
 	search_type = set_netlock_parameters(search_type, 0, h);
@@ -233,8 +198,8 @@ void forward_search_control(board b, int time_allocation, int search_type, tree*
 		FESS(b, time_allocation * 3 / 4, search_type, t, h);
 		if (h->level_solved) return;
 
-		h->weighted_search = 1;
-		time_allocation = end_time - (int)time(0);
+		h->weighted_search = weighted;
+		time_allocation = (int)(local_end_ms - get_time_in_ms());
 		FESS(b, time_allocation, search_type, t, h);
 
 		return;
@@ -245,7 +210,7 @@ void forward_search_control(board b, int time_allocation, int search_type, tree*
 	{
 		packing_search(b, time_allocation, search_type, t, h);
 		if (h->perimeter_found == 0) return;
-		time_allocation = end_time - (int)time(0);
+		time_allocation = (int)(local_end_ms - get_time_in_ms());
 	}
 
 	FESS(b, time_allocation, search_type, t, h);
@@ -253,6 +218,45 @@ void forward_search_control(board b, int time_allocation, int search_type, tree*
 }
 
 
+// A strategy is a pair of searches: a backward (packing) search followed by a forward search.
+// Strategies A-H are the main portfolio. Further strategies are parameter variants that are
+// only scheduled when there are more cores than main strategies. Most variants repeat a main
+// strategy with an unweighted forward search, which explores the tree in a different order.
+
+typedef struct
+{
+	int backward_search_type;
+	int forward_search_type;
+	int weighted; // forward search weights moves by their attributes
+} strategy;
+
+strategy strategies[] =
+{
+	{ BASE_SEARCH,      FORWARD_WITH_BASES, 1 },
+	{ MAX_DIST_SEARCH2, HF_SEARCH,          1 },
+	{ GIRL_SEARCH,      GIRL_SEARCH,        1 },
+	{ HF_SEARCH,        HF_SEARCH,          1 },
+	{ BICON_SEARCH,     HF_SEARCH,          1 },
+	{ MAX_DIST_SEARCH,  HF_SEARCH,          1 },
+	{ REV_SEARCH,       REV_SEARCH,         1 },
+	{ DRAGONFLY,        NAIVE_SEARCH,       1 },
+
+	// variants
+	{ NORMAL,           NORMAL,             1 },
+	{ NORMAL,           HF_SEARCH,          1 },
+	{ BASE_SEARCH,      FORWARD_WITH_BASES, 0 },
+	{ MAX_DIST_SEARCH2, HF_SEARCH,          0 },
+	{ GIRL_SEARCH,      GIRL_SEARCH,        0 },
+	{ HF_SEARCH,        HF_SEARCH,          0 },
+	{ BICON_SEARCH,     HF_SEARCH,          0 },
+	{ MAX_DIST_SEARCH,  HF_SEARCH,          0 },
+	{ REV_SEARCH,       REV_SEARCH,         0 },
+	{ NORMAL,           NORMAL,             0 },
+};
+
+#define MAIN_STRATEGIES_NUM 8
+#define STRATEGIES_NUM ((int)(sizeof(strategies) / sizeof(strategy)))
+
 void solve_with_alg(board b, int time_allocation, int strategy_index, helper *h)
 {
 	// Strategy A: eliminate boxes via sink squares. Stop packing search when boxes are removed from targets.
@@ -260,50 +264,27 @@ void solve_with_alg(board b, int time_allocation, int strategy_index, helper *h)
 	// Strategy C: girl mode 
 	// strategy D: HF search
 
-	int local_start_time, remaining_time;
+	UINT_64 local_start_ms;
+	int remaining_time;
 	int search_type;
 	tree *t;
 
-	int backward_search_type[8] = 
-	{
-		BASE_SEARCH,
-		MAX_DIST_SEARCH2, //NORMAL, 
-		GIRL_SEARCH, 
-		HF_SEARCH , 
-		BICON_SEARCH, 
-		MAX_DIST_SEARCH, 
-		REV_SEARCH,
-		DRAGONFLY
-	};
-	
-	int forward_search_type[8] = 
-	{
-		FORWARD_WITH_BASES, 
-		HF_SEARCH, //NORMAL, 
-		GIRL_SEARCH, 
-		HF_SEARCH , 
-		HF_SEARCH,    
-		HF_SEARCH, 
-		REV_SEARCH,
-		NAIVE_SEARCH,
-	};
-
 	if (time_allocation <= 0) return;
 
 	reset_helper(h);
-	t = search_trees + h->my_core;
+	t = current_level->search_trees + h->my_core;
 	
 	// backward search
 
-	search_type = backward_search_type[strategy_index];
+	search_type = strategies[strategy_index].backward_search_type;
 
 	if (verbose >= 4)
 	{
 		printf("Starting strategy %c. ", 'A' + strategy_index);
-		printf(" Time limit: %d seconds\n", time_allocation);
+		printf(" Time limit: %d ms\n", time_allocation);
 	}
 
-	local_start_time = (int)time(0);
+	local_start_ms = get_time_in_ms();
 	
 	packing_search_control(b, time_allocation / 3, search_type, t, h);
 
@@ -312,180 +293,240 @@ void solve_with_alg(board b, int time_allocation, int strategy_index, helper *h)
 
 	// forward search
 
-	remaining_time = local_start_time + time_allocation - (int)time(0);
+	remaining_time = time_allocation - get_elapsed_ms(local_start_ms);
+
+	search_type = strategies[strategy_index].forward_search_type;
+
+	forward_search_control(b, remaining_time, search_type, strategies[strategy_index].weighted, t, h);
+}
+
+int get_search_time(double ratio)
+{
+	// in milliseconds, so that short time limits are split without rounding
+	int remaining_time;
 
-	search_type = forward_search_type[strategy_index];;
+	if (ratio > 1.0) ratio = 1.0;
 
-	forward_search_control(b, remaining_time, search_type, t, h);
+	remaining_time = time_limit_ms - get_elapsed_ms(current_level->start_ms);
+	return (int)(remaining_time * ratio);
 }
 
+// The scheduler keeps a queue of strategies. Each worker takes the next strategy from the queue
+// when it becomes free, so a slow strategy only delays its own worker. The workers together
+// have workers_num * remaining time. The strategies that are running keep what is left of their
+// budgets, and the rest is split equally between the strategies that were not started yet,
+// so a strategy that finishes early leaves its time to the later ones.
+// When the queue is empty, a free worker exits: the strategies are deterministic, and a running
+// strategy can't be split between workers.
+
 typedef struct
 {
 	board b;
-	int time_allocation;
-	int alg;
+	level_context *level;
+	int tasks_num;
+	int next_task;
+	int workers_num;
+	UINT_64 *end_ms; // when the strategy of each worker runs out of time, 0 if it has none
+#ifdef THREADS
+	pthread_mutex_t mutex;
+#endif
+} scheduler_data;
+
+typedef struct
+{
+	scheduler_data *scheduler;
 	helper *h;
-} work_element;
+} scheduler_worker_data;
 
-void *solve_work_element(void *we_in)
+int get_task_budget(scheduler_data *scheduler, int worker, int pending)
 {
-	work_element *we = (work_element*)we_in;
+	// called with the scheduler locked
+	UINT_64 now = get_time_in_ms();
+	double remaining_time, committed = 0, left, budget;
+	int i;
 
-	if ((cores_num > 1) && (verbose >= 4))
-		printf("core %d starting\n", we->h->my_core);
+	remaining_time = get_search_time(1.0);
+	if (remaining_time <= 0) return 0;
 
-	solve_with_alg(we->b, we->time_allocation, we->alg, we->h);
+	for (i = 0; i < scheduler->workers_num; i++)
+	{
+		if ((i == worker) || (scheduler->end_ms[i] <= now)) continue;
 
-	if ((cores_num > 1) && (verbose >= 4))
-		printf("core %d ending\n", we->h->my_core);
-	
-	return NULL;
-}
+		left = (double)(scheduler->end_ms[i] - now);
+		committed += (left < remaining_time ? left : remaining_time);
+	}
 
+	budget = (remaining_time * scheduler->workers_num - committed) / pending;
 
+	if (budget > remaining_time) budget = remaining_time; // a strategy runs on one worker
+	if (budget < 0) budget = 0;
 
-void prepare_work_element(board b, int time_allocation, int alg, helper *h, work_element *we)
-{
-	copy_board(b, we->b);
-	we->time_allocation = time_allocation;
-	we->alg = alg;
-	we->h = h;
+	return (int)budget;
 }
 
-int get_search_time(double ratio)
+int get_next_task(scheduler_data *scheduler, int worker, int *time_allocation)
 {
-	int remaining_time;
-
-	remaining_time = start_time + time_limit - (int)time(0);
-	return (int)(remaining_time * ratio);
-}
+	int task = -1;
+	int pending;
 
-void solve_with_time_control_single_core(board b)
-{
-	work_element we;
-	int search_time;
-	int i;
+#ifdef THREADS
+	if (scheduler->workers_num > 1) pthread_mutex_lock(&scheduler->mutex);
+#endif
 
-	if (forced_alg != -1)
+	if ((current_level->any_core_solved == 0) && (scheduler->next_task < scheduler->tasks_num))
 	{
-		search_time = get_search_time(1.0);
-		prepare_work_element(b, search_time, forced_alg, helpers + 0, &we);
-		solve_work_element((void*)(&we));
-		return;
-	}
+		task = scheduler->next_task++;
+		pending = scheduler->tasks_num - task;
 
-	for (i = 0; i < 8; i++)
-	{
-		search_time = get_search_time(1 / (double)(8 - i));
+		if (forced_alg != -1)
+			task = forced_alg;
 
-		prepare_work_element(b, search_time, i, helpers + 0, &we);
-		solve_work_element((void*)(&we));
-		if (helpers[0].level_solved) return;
+		*time_allocation = get_task_budget(scheduler, worker, pending);
+		scheduler->end_ms[worker] = get_time_in_ms() + *time_allocation;
 	}
-}
+	else
+		scheduler->end_ms[worker] = 0;
+
+#ifdef THREADS
+	if (scheduler->workers_num > 1) pthread_mutex_unlock(&scheduler->mutex);
+#endif
 
+	return task;
+}
 
-void solve_with_time_control_two_cores(board b)
+void *scheduler_worker(void *data_in)
 {
-#ifndef THREADS
-	return;
-#else
-	work_element we_0, we_1;
-	int search_time;
-	int rc0, rc1;
-	int i;
-	pthread_t threads[2];
+	scheduler_worker_data *data = (scheduler_worker_data*)data_in;
+	helper *h = data->h;
+	int task, time_allocation;
 
-	for (i = 0; i < 4; i++)
-	{
-		search_time = get_search_time(1 / (double)(4 - i));
+	current_level = data->scheduler->level; // the worker may run in a new thread
 
-		prepare_work_element(b, search_time, i*2 + 0, helpers + 0, &we_0);
-		prepare_work_element(b, search_time, i*2 + 1, helpers + 1, &we_1);
+	if ((cores_num > 1) && (verbose >= 4))
+		printf("core %d starting\n", h->my_core);
 
-		rc0 = pthread_create(&threads[0], NULL, solve_work_element, &we_0);
-		rc1 = pthread_create(&threads[1], NULL, solve_work_element, &we_1);
+	while (1)
+	{
+		task = get_next_task(data->scheduler, h->my_core, &time_allocation);
+		if (task == -1) break;
 
-		pthread_join(threads[0], NULL);
-		pthread_join(threads[1], NULL);
+		solve_with_alg(data->scheduler->b, time_allocation, task, h);
 
-		if (any_core_solved) return;
+		if (h->level_solved)
+		{
+			ATOMIC_STORE_RELEASE(&current_level->any_core_solved, 1);
+			break;
+		}
 	}
-#endif
-}
 
+	if ((cores_num > 1) && (verbose >= 4))
+		printf("core %d ending\n", h->my_core);
+
+	if (data->scheduler->workers_num > 1)
+		free_thread_scratch(); // the thread is about to exit
+
+	return NULL;
+}
 
-void solve_with_time_control_four_cores(board b)
+int get_scheduler_tasks_num()
 {
-#ifndef THREADS
-	return;
-#else
-	work_element we[4];
-	int search_time;
-	int rc[4];
-	int i,j;
-	pthread_t threads[4];
+	int tasks_num = MAIN_STRATEGIES_NUM;
 
-	for (i = 0; i < 2; i++)
-	{
-		search_time = get_search_time(1 / (double)(2 - i));
+	if (forced_alg != -1) return 1;
 
-		for (j = 0 ; j < 4 ; j++)
-			prepare_work_element(b, search_time, i * 4 + j, helpers + j, we + j);
+	// variants are used only when there is a free core for them
+	if (cores_num > tasks_num)
+		tasks_num = (cores_num < STRATEGIES_NUM ? cores_num : STRATEGIES_NUM);
 
-		for (j = 0 ; j < 4 ; j++)
-			rc[j] = pthread_create(&threads[j], NULL, solve_work_element, we + j);
+	return tasks_num;
+}
 
-		for (j = 0 ; j < 4 ; j++)
-			pthread_join(threads[j], NULL);
+int get_scheduler_workers_num()
+{
+	// a worker without a strategy would only hold a search tree, so the search tables
+	// and helpers are allocated for this number of workers and not for cores_num.
+	int workers_num = cores_num;
 
-		if (any_core_solved) return;
-	}
+#ifndef THREADS
+	workers_num = 1;
 #endif
-}
 
+	if (workers_num > get_scheduler_tasks_num())
+		workers_num = get_scheduler_tasks_num();
 
+	return workers_num;
+}
 
-void solve_with_time_control_eight_cores(board b)
+void solve_with_scheduler(board b)
 {
-#ifndef THREADS
-	return;
-#else
-	work_element we[8];
-	int rc[8];
-	pthread_t threads[8];
-	int i,search_time;
+	scheduler_data scheduler;
+	scheduler_worker_data *workers;
+	int i;
 
-	search_time = get_search_time(1.0);
+	if ((forced_alg != -1) && ((forced_alg < 0) || (forced_alg >= STRATEGIES_NUM)))
+		exit_with_error("illegal strategy index\n");
 
-	for (i = 0 ; i < 8 ; i++)
+	copy_board(b, scheduler.b);
+	scheduler.level = current_level;
+	scheduler.next_task = 0;
+	scheduler.tasks_num = get_scheduler_tasks_num();
+	scheduler.workers_num = current_level->workers_num;
+
+	workers = (scheduler_worker_data*)malloc(sizeof(scheduler_worker_data) * scheduler.workers_num);
+	scheduler.end_ms = (UINT_64*)malloc(sizeof(UINT_64) * scheduler.workers_num);
+	if ((workers == 0) || (scheduler.end_ms == 0)) exit_with_error("can't allocate workers\n");
+
+	for (i = 0; i < scheduler.workers_num; i++)
 	{
-		prepare_work_element(b, search_time, i, helpers + i, we + i);
-		rc[i] = pthread_create(&threads[i], NULL, solve_work_element, &we[i]);
+		workers[i].scheduler = &scheduler;
+		workers[i].h = current_level->helpers + i;
+		scheduler.end_ms[i] = 0;
 	}
 
-	for (i = 0 ; i < 8 ; i++)
-		pthread_join(threads[i], NULL);
+	if (scheduler.workers_num == 1)
+		scheduler_worker((void*)workers);
+	else
+	{
+#ifdef THREADS
+		pthread_t *threads = (pthread_t*)malloc(sizeof(pthread_t) * scheduler.workers_num);
+		if (threads == 0) exit_with_error("can't allocate threads\n");
+
+		pthread_mutex_init(&scheduler.mutex, NULL);
+
+		for (i = 0; i < scheduler.workers_num; i++)
+			pthread_create(&threads[i], NULL, scheduler_worker, workers + i);
+
+		for (i = 0; i < scheduler.workers_num; i++)
+			pthread_join(threads[i], NULL);
+
+		pthread_mutex_destroy(&scheduler.mutex);
+		free(threads);
 #endif
+	}
+
+	free(scheduler.end_ms);
+	free(workers);
 }
 
 
-void solve_with_time_control(board b)
+void solve_with_time_control(level_context *l, board b)
 {
 	int i;
 
-	start_time = (int)time(0);
-	any_core_solved = 0;
+	current_level = l;
+
+	current_level->start_time = (int)time(0);
+	current_level->start_ms = get_time_in_ms();
+	current_level->any_core_solved = 0;
 
-	for (i = 0; i < cores_num; i++)
-		reset_helper(helpers + i); // remove leftovers solutions from previous levels
+	for (i = 0; i < current_level->workers_num; i++)
+		reset_helper(current_level->helpers + i); // remove leftovers solutions from previous levels
 
-	if (preprocess_level(b) == 1)
+	if (preprocess_level(l, b) == 1)
 	{
-		if (cores_num == 1) solve_with_time_control_single_core(b);
-		if (cores_num == 2) solve_with_time_control_two_cores(b);
-		if (cores_num == 4) solve_with_time_control_four_cores(b);
-		if (cores_num == 8) solve_with_time_control_eight_cores(b);
+		solve_with_scheduler(b);
+		cancel_speculation(current_level);
+		save_knowledge();
 	}
 	else
 	{
@@ -493,9 +534,17 @@ void solve_with_time_control(board b)
 			printf("preprocess failed\n");
 	}
 
-	end_time = (int)time(0);
+	current_level->end_time = (int)time(0);
+	current_level->end_ms = get_time_in_ms();
 
-	if (end_time < start_time) end_time = start_time;
+	if (current_level->end_time < current_level->start_time) current_level->end_time = current_level->start_time;
+
+	if (verbose >= 4)
+	{
+		print_deadlock_cache_stats();
+		print_perimeter_stats();
+		print_deadlock_stats();
+	}
 
 }
 
@@ -506,19 +555,19 @@ int save_solution_if_found()
 
 	if (save_best_flag)
 	{
-		for (i = 0; i < cores_num; i++)
+		for (i = 0; i < current_level->workers_num; i++)
 		{
-			save_sol_moves(helpers + i);
-			solved |= helpers[i].level_solved;
+			save_sol_moves(current_level->helpers + i);
+			solved |= current_level->helpers[i].level_solved;
 		}
 		return solved;
 	}
 
-	for (i = 0; i < cores_num; i++)
+	for (i = 0; i < current_level->workers_num; i++)
 	{
-		if (helpers[i].level_solved)
+		if (current_level->helpers[i].level_solved)
 		{
-			save_sol_moves(helpers + i);
+			save_sol_moves(current_level->helpers + i);
 			return 1;
 		}
 	}
@@ -526,6 +575,234 @@ int save_solution_if_found()
 }
 
 
+int solve_level(level_context *l, board b)
+{
+	int solved;
+
+	current_level = l;
+
+	printf("\n=================\nLevel %d\n=================\n", current_level->level_id);
+
+	load_level_from_file(b, current_level->level_id);
+	save_level_to_solution_file(b);
+
+	solve_with_time_control(l, b);
+
+	solved = save_solution_if_found();
+	if (solved) printf("SOLVED!\n");
+
+	save_times_to_solutions_file(current_level->end_time - current_level->start_time);
+
+	if ((current_level->end_ms - current_level->start_ms) >= (UINT_64)time_limit_ms)
+	{
+		if (strcmp(current_level->fail_reason, "Too many moves") != 0)
+			strcpy(current_level->fail_reason, "Time limit exceeded");
+	}
+
+	return solved;
+}
+
+// Batch mode: several worker processes solve different levels of the set at the same time.
+// Each worker has its own tables and per-level data. Workers write the solution of a level to a
+// separate part file, and the main process merges the parts and the log in the order of the levels.
+
+#ifdef LINUX
+
+#define BATCH_PENDING 0
+#define BATCH_RUNNING 1
+#define BATCH_DONE    2
+
+typedef struct
+{
+	int state;
+	int solved;
+	int sol_time;
+	int moves;
+	int pushes;
+	char fail_reason[50];
+	char title[1000];
+} batch_result;
+
+typedef struct
+{
+	int next_level;
+	int worker_level[MAX_BATCH_WORKERS];
+	batch_result results[1]; // allocated with one entry per level
+} batch_data;
+
+void get_batch_part_filename(char *solutions_filename, int level, char *filename, int size)
+{
+	// the part name becomes the output file of the worker, so it must fit global_output_filename
+	int len = snprintf(filename, size, "%s.part%d", solutions_filename, level);
+
+	if ((len < 0) || (len >= size))
+		exit_with_error("solution file name is too long for batch mode\n");
+}
+
+void batch_worker(batch_data *batch, int worker, int from, int to, char *solutions_filename)
+{
+	board b;
+	int level;
+	batch_result *r;
+	FILE *fp;
+
+	allocate_search_tables(current_level, get_scheduler_workers_num()); // each worker allocates its own tables after the fork
+
+	while (1)
+	{
+		level = __sync_fetch_and_add(&batch->next_level, 1);
+		if (level > to) break;
+
+		r = batch->results + (level - from);
+		batch->worker_level[worker] = level;
+		r->state = BATCH_RUNNING;
+
+		// the level is written to its own part of the solution file
+		get_batch_part_filename(solutions_filename, level, global_output_filename, sizeof(global_output_filename));
+		fp = fopen(global_output_filename, "w");
+		if (fp) fclose(fp);
+
+		current_level->level_id = level;
+		r->solved = solve_level(current_level, b);
+		r->sol_time = current_level->end_time - current_level->start_time;
+		r->moves = current_level->level_sol_moves;
+		r->pushes = current_level->level_sol_pushes;
+		strcpy(r->fail_reason, current_level->fail_reason);
+		strcpy(r->title, current_level->level_title);
+
+		fflush(stdout);
+		__sync_synchronize();
+		r->state = BATCH_DONE;
+	}
+
+	stop_speculation();
+	free_level_context(current_level);
+}
+
+void merge_batch_result(batch_data *batch, int level, int from, char *solutions_filename)
+{
+	batch_result *r = batch->results + (level - from);
+	char part_filename[sizeof(global_output_filename)];
+
+	get_batch_part_filename(solutions_filename, level, part_filename, sizeof(part_filename));
+	append_to_solutions_file(part_filename);
+	remove(part_filename);
+
+	current_level->level_id = level;
+	strcpy(current_level->level_title, r->title);
+	strcpy(current_level->fail_reason, r->fail_reason);
+	current_level->level_sol_moves = r->moves;
+	current_level->level_sol_pushes = r->pushes;
+	current_level->start_time = 0;
+	current_level->end_time = r->sol_time;
+
+	if (verbose >= 3)
+		printf("Level %d: %s\n", level, r->solved ? "SOLVED" : r->fail_reason);
+
+	save_level_log(r->solved);
+}
+
+void mark_crashed_level(batch_data *batch, int level, int from)
+{
+	batch_result *r = batch->results + (level - from);
+
+	if (r->state == BATCH_DONE) return;
+
+	r->solved = 0;
+	r->sol_time = 0;
+	strcpy(r->fail_reason, "Solver crashed");
+	sprintf(r->title, "Level %d", level);
+	r->state = BATCH_DONE;
+}
+
+void solve_level_set_in_batch(int from, int to)
+{
+	batch_data *batch;
+	size_t size;
+	pid_t pids[MAX_BATCH_WORKERS];
+	pid_t pid;
+	int i, w, status, level;
+	int workers_num = batch_size;
+	int alive;
+	char solutions_filename[2000];
+	char part_filename[sizeof(global_output_filename)];
+
+	if (workers_num > (to - from + 1)) workers_num = to - from + 1;
+
+	size = sizeof(batch_data) + sizeof(batch_result) * (to - from + 1);
+	batch = (batch_data*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (batch == MAP_FAILED) exit_with_error("can't allocate batch data\n");
+
+	memset(batch, 0, size);
+	batch->next_level = from;
+
+	for (w = 0; w < workers_num; w++)
+		batch->worker_level[w] = -1;
+
+	get_solution_filename(solutions_filename);
+	get_batch_part_filename(solutions_filename, to, part_filename, sizeof(part_filename)); // fail before forking
+
+	// -mem is the budget of the whole run, so each worker sizes its tables to its share
+	memory_budget /= workers_num;
+
+	printf("Solving levels %d-%d with %d batch workers\n", from, to, workers_num);
+	fflush(stdout);
+
+	for (w = 0; w < workers_num; w++)
+	{
+		pid = fork();
+		if (pid < 0) exit_with_error("fork failed\n");
+
+		if (pid == 0)
+		{
+			batch_worker(batch, w, from, to, solutions_filename);
+			exit(0);
+		}
+		pids[w] = pid;
+	}
+
+	alive = workers_num;
+	level = from;
+
+	while (level <= to)
+	{
+		if (batch->results[level - from].state == BATCH_DONE)
+		{
+			merge_batch_result(batch, level, from, solutions_filename);
+			level++;
+			continue;
+		}
+
+		pid = waitpid(-1, &status, WNOHANG);
+
+		if (pid > 0)
+		{
+			alive--;
+
+			// a worker that died in the middle of a level does not report it
+			for (w = 0; w < workers_num; w++)
+				if ((pids[w] == pid) && (batch->worker_level[w] != -1))
+					mark_crashed_level(batch, batch->worker_level[w], from);
+
+			if (alive == 0)
+				for (i = level; i <= to; i++)
+					mark_crashed_level(batch, i, from);
+			continue;
+		}
+
+		usleep(100000);
+	}
+
+	while (alive > 0)
+	{
+		waitpid(-1, &status, 0);
+		alive--;
+	}
+
+	munmap(batch, size);
+}
+#endif
+
 void solve_level_set()
 {	
 	board b;
@@ -533,7 +810,7 @@ void solve_level_set()
 	int levels_num;
 	int from, to;
 
-	levels_num = load_level_from_file(b, 10000); // count levels in file
+	levels_num = get_levels_num();
 
 	write_log_header();
 	write_solution_header();
@@ -546,26 +823,24 @@ void solve_level_set()
 	if (just_one_level != -1)
 		from = to = just_one_level;
 
-	for (i = from; i <= to; i++) // using one-based here
+	if (batch_size > 1)
 	{
-		level_id = i;
-		printf("\n=================\nLevel %d\n=================\n", level_id);
-
-		load_level_from_file(b, level_id);
-		save_level_to_solution_file(b);
-
-		solve_with_time_control(b);
+#ifdef LINUX
+		solve_level_set_in_batch(from, to);
+		write_log_footer();
+		return;
+#else
+		printf("Batch mode is not supported on this platform\n");
+#endif
+	}
 
-		solved = save_solution_if_found();
-		if (solved) printf("SOLVED!\n");
+	allocate_search_tables(current_level, get_scheduler_workers_num());
 
-		save_times_to_solutions_file(end_time - start_time);
+	for (i = from; i <= to; i++) // using one-based here
+	{
+		current_level->level_id = i;
 
-		if ((end_time - start_time) >= time_limit)
-		{
-			if (strcmp(global_fail_reason, "Too many moves") != 0)
-				strcpy(global_fail_reason, "Time limit exceeded");
-		}
+		solved = solve_level(current_level, b);
 
 		save_level_log(solved);
 	}
@@ -574,6 +849,23 @@ void solve_level_set()
 }
 
 
+UINT_64 parse_memory_size(char *s)
+{
+	// a number of megabytes, or a number with a K/M/G suffix, e.g. "12G"
+	UINT_64 val = 0;
+	char unit = 'M';
+
+	if (sscanf(s, "%llu%c", &val, &unit) < 1)
+		exit_with_error("bad memory size");
+
+	if ((unit == 'K') || (unit == 'k')) return val << 10;
+	if ((unit == 'M') || (unit == 'm')) return val << 20;
+	if ((unit == 'G') || (unit == 'g')) return val << 30;
+
+	exit_with_error("bad memory size");
+	return 0;
+}
+
 void process_args(int argc, char **argv)
 {
 	int i;
@@ -598,8 +890,26 @@ void process_args(int argc, char **argv)
 		if (strcmp(argv[i], "-out_dir") == 0)
 			strcpy(global_dir, argv[i + 1]);
 
+		if (strcmp(argv[i], "-kb_dir") == 0)
+			strcpy(knowledge_dir, argv[i + 1]);
+
 		if (strcmp(argv[i], "-time") == 0)
-			sscanf(argv[i + 1], "%d", &time_limit);
+		{
+			sscanf(argv[i + 1], "%d", &time_limit_ms);
+
+			if (time_limit_ms > MAX_TIME_LIMIT_MS / 1000)
+				time_limit_ms = MAX_TIME_LIMIT_MS;
+			else
+				time_limit_ms *= 1000;
+		}
+
+		if (strcmp(argv[i], "-time_ms") == 0)
+		{
+			sscanf(argv[i + 1], "%d", &time_limit_ms);
+
+			if (time_limit_ms > MAX_TIME_LIMIT_MS)
+				time_limit_ms = MAX_TIME_LIMIT_MS;
+		}
 
 		if (strcmp(argv[i], "-from") == 0)
 			sscanf(argv[i + 1], "%d", &global_from_level);
@@ -616,6 +926,12 @@ void process_args(int argc, char **argv)
 		if (strcmp(argv[i], "-save_best") == 0)
 			save_best_flag = 1;
 
+		if (strcmp(argv[i], "-adaptive_deadlocks") == 0)
+			adaptive_deadlocks = 1;
+
+		if (strcmp(argv[i], "-spec_threads") == 0)
+			sscanf(argv[i + 1], "%d", &spec_threads);
+
 		if (strcmp(argv[i], "-cores") == 0)
 			sscanf(argv[i + 1], "%d", &cores_num);
 
@@ -624,8 +940,22 @@ void process_args(int argc, char **argv)
 
 		if (strcmp(argv[i], "-extra_mem") == 0)
 			sscanf(argv[i + 1], "%d", &extra_mem);
+
+		if (strcmp(argv[i], "-deadlock_cache_mb") == 0)
+			sscanf(argv[i + 1], "%d", &deadlock_cache_mb);
+
+		if (strcmp(argv[i], "-mem") == 0)
+			memory_budget = parse_memory_size(argv[i + 1]);
+
+		if (strcmp(argv[i], "-batch") == 0)
+			sscanf(argv[i + 1], "%d", &batch_size);
 	}
 
+	if (batch_size > MAX_BATCH_WORKERS) batch_size = MAX_BATCH_WORKERS;
+
+	if ((cores_num == -1) && (batch_size > 1))
+		cores_num = 1; // the cores are used for solving several levels at once
+
 	if (cores_num == -1) 
 		cores_num = get_number_of_cores();
 }
@@ -640,23 +970,17 @@ int main(int argc, char **argv)
 
 	process_args(argc, argv);
 
-	allocate_perimeter();
-	allocate_deadlock_cache();
-	allocate_search_trees();
-	allocate_helpers();
-	init_dragonfly();
-
+	init_board_hash_keys();
 
 	read_deadlock_patterns(0); // normal mode
 	read_deadlock_patterns(1); // pull mode
+
+	current_level = allocate_level_context();
  
 	solve_level_set();  // SOLVE LEVEL SETS
 
-	free_perimeter();
-	free_deadlock_cache();
-	free_search_trees();
-	free_helpers();
-
+	stop_speculation();
+	free_level_context(current_level);
 
 	return 0;
 }
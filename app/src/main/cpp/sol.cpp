@@ -14,8 +14,6 @@
 #include "util.h"
 #include "tree.h"
 
-int level_sol_pushes = 0;
-int level_sol_moves = 0;
 int global_total_pushes = 0;
 int global_total_moves = 0;
 int total_sol_time = 0;
@@ -41,7 +39,7 @@ int find_sol_move(board b_in,
 	int *current, *next, *src;
 	board b;
 
-	space_size = index_num * index_num;
+	space_size = current_level->index_num * current_level->index_num;
 
 	current = (int*)malloc(sizeof(int) * space_size);
 	next    = (int*)malloc(sizeof(int) * space_size);
@@ -59,9 +57,9 @@ int find_sol_move(board b_in,
 	for (i = 0; i < space_size; i++)
 		src[i] = -1;
 
-	target_index = start_sok_index * index_num + start_box_index;
+	target_index = start_sok_index * current_level->index_num + start_box_index;
 
-	current[0] = end_sok_index * index_num + end_box_index; // we'll start from the end and pull back
+	current[0] = end_sok_index * current_level->index_num + end_box_index; // we'll start from the end and pull back
 	src[current[0]] = current[0];
 	current_num = 1;
 
@@ -73,8 +71,8 @@ int find_sol_move(board b_in,
 		{
 			current_index = current[i];
 
-			sok_index = current_index / index_num;
-			box_index = current_index % index_num;
+			sok_index = current_index / current_level->index_num;
+			box_index = current_index % current_level->index_num;
 
 			index_to_y_x(sok_index, &sok_y, &sok_x);
 			index_to_y_x(box_index, &box_y, &box_x);
@@ -90,7 +88,7 @@ int find_sol_move(board b_in,
 
 				if (b[next_sok_y][next_sok_x] & OCCUPIED) continue;
 
-				next_index = y_x_to_index(next_sok_y, next_sok_x) * index_num + box_index;
+				next_index = y_x_to_index(next_sok_y, next_sok_x) * current_level->index_num + box_index;
 				if (src[next_index] != -1) continue;
 
 				src[next_index] = current_index;
@@ -111,7 +109,7 @@ int find_sol_move(board b_in,
 
 				if (b[next_sok_y][next_sok_x] & OCCUPIED) continue;
 
-				next_index = y_x_to_index(next_sok_y, next_sok_x) * index_num +
+				next_index = y_x_to_index(next_sok_y, next_sok_x) * current_level->index_num +
 					y_x_to_index(next_box_y, next_box_x);
 
 				if (src[next_index] != -1) continue;
@@ -144,10 +142,10 @@ int find_sol_move(board b_in,
 
 	while (next_index != current_index)
 	{
-		index_to_y_x(current_index / index_num, &sok_y, &sok_x);
+		index_to_y_x(current_index / current_level->index_num, &sok_y, &sok_x);
 
-		index_to_y_x(next_index / index_num, &next_sok_y, &next_sok_x);
-		index_to_y_x(next_index % index_num, &next_box_y, &next_box_x);
+		index_to_y_x(next_index / current_level->index_num, &next_sok_y, &next_sok_x);
+		index_to_y_x(next_index % current_level->index_num, &next_box_y, &next_box_x);
 
 		m = ' ';
 		if (next_sok_y == (sok_y + 1)) m = 'd';
@@ -158,7 +156,7 @@ int find_sol_move(board b_in,
 		if (m == ' ')
 			exit_with_error("move error");
 
-		if ((current_index % index_num) != (next_index % index_num))
+		if ((current_index % current_level->index_num) != (next_index % current_level->index_num))
 			m = m + 'A' - 'a';
 
 //		printf("%c", m);
@@ -176,11 +174,8 @@ int find_sol_move(board b_in,
 }
 
 
-void write_solution_header()
+void get_solution_filename(char *filename)
 {
-	FILE *fp;
-	char filename[2000];
-
 #ifndef LINUX
 	sprintf(filename, "%s\\solutions.sok", global_dir);
 #else
@@ -188,6 +183,14 @@ void write_solution_header()
 #endif
 
 	if (global_output_filename[0]) strcpy(filename, global_output_filename);
+}
+
+void write_solution_header()
+{
+	FILE *fp;
+	char filename[2000];
+
+	get_solution_filename(filename);
 
 	fp = fopen(filename, "w");
 	if (fp)
@@ -204,28 +207,22 @@ void save_level_to_solution_file(board b)
 	FILE *fp;
 	char filename[2000];
 
-	if ((height == 0) || (width == 0)) return;
+	if ((current_level->height == 0) || (current_level->width == 0)) return;
 
-#ifndef LINUX
-	sprintf(filename, "%s\\solutions.sok", global_dir);
-#else
-	sprintf(filename, "%s/solutions.sok", global_dir);
-#endif
-
-	if (global_output_filename[0]) strcpy(filename, global_output_filename);
+	get_solution_filename(filename);
 
 	fp = fopen(filename, "a");
 	if (fp == NULL) return;
 
 	fprintf(fp, "\n");
 
-	if (strcmp(level_title, "None") == 0)
+	if (strcmp(current_level->level_title, "None") == 0)
 	{
-		fprintf(fp, "Level %d\n", level_id);
+		fprintf(fp, "Level %d\n", current_level->level_id);
 	}
 	else
 	{
-		fprintf(fp, "%s\n", level_title);
+		fprintf(fp, "%s\n", current_level->level_title);
 	}
 	fprintf(fp, "\n");
 
@@ -295,26 +292,20 @@ void save_sol_moves(helper *h)
 
 	if (h->sol_len == 0) return;
 
-#ifndef LINUX
-	sprintf(filename, "%s\\solutions.sok", global_dir);
-#else
-	sprintf(filename, "%s/solutions.sok", global_dir);
-#endif
-
-	if (global_output_filename[0]) strcpy(filename, global_output_filename);
+	get_solution_filename(filename);
 
 	fp = fopen(filename, "a");
 	if (fp == 0) return;
 
 	fprintf(fp, "Solution\n");
 
-	sok_y = global_initial_sokoban_y;
-	sok_x = global_initial_sokoban_x;
+	sok_y = current_level->initial_sokoban_y;
+	sok_x = current_level->initial_sokoban_x;
 
-	copy_board(initial_board, b);
+	copy_board(current_level->initial_board, b);
 
-	level_sol_moves = 0;
-	level_sol_pushes = 0;
+	current_level->level_sol_moves = 0;
+	current_level->level_sol_pushes = 0;
 
 	n = h->sol_len;
 
@@ -334,8 +325,8 @@ void save_sol_moves(helper *h)
 		moves_num = find_sol_move(b, y_x_to_index(sok_y, sok_x), start_box_index,
 			y_x_to_index(next_sok_y, next_sok_x), end_box_index, buffer);
 
-		level_sol_moves += moves_num;
-		level_sol_pushes += count_pushes(buffer, moves_num);
+		current_level->level_sol_moves += moves_num;
+		current_level->level_sol_pushes += count_pushes(buffer, moves_num);
 
 		fwrite(buffer, 1, moves_num, fp);
 
@@ -395,7 +386,7 @@ void save_level_log(int solved)
 
 	if (YASC_mode) return;
 
-	sol_time = end_time - start_time;
+	sol_time = current_level->end_time - current_level->start_time;
 	total_sol_time += sol_time;
 
 	total_levels_tried++;
@@ -426,26 +417,26 @@ void save_level_log(int solved)
 	}
 	else
 	{
-		sprintf(s, "%-23s", global_fail_reason);
+		sprintf(s, "%-23s", current_level->fail_reason);
 		fprintf(fp, "%s", s);
 	}
 
 	if (solved)
 	{
-		fprintf(fp, "%9d", level_sol_moves);
-		fprintf(fp, "%8d ", level_sol_pushes);
+		fprintf(fp, "%9d", current_level->level_sol_moves);
+		fprintf(fp, "%8d ", current_level->level_sol_pushes);
 	}
 	else
 		fprintf(fp, "                  ");
 
-	fprintf(fp, "%s\n", level_title);
+	fprintf(fp, "%s\n", current_level->level_title);
 
 	fclose(fp);
 
 	if (solved)
 	{
-		global_total_moves += level_sol_moves;
-		global_total_pushes += level_sol_pushes;
+		global_total_moves += current_level->level_sol_moves;
+		global_total_pushes += current_level->level_sol_pushes;
 	}
 }
 
@@ -488,6 +479,30 @@ void write_log_footer()
 	fclose(fp);
 }
 
+void append_to_solutions_file(char *part_filename)
+{
+	// copy a solution file part that was written separately (batch mode)
+	char filename[2000];
+	char buffer[4096];
+	FILE *fp, *part;
+	size_t n;
+
+	part = fopen(part_filename, "rb");
+	if (part == 0) return;
+
+	get_solution_filename(filename);
+
+	fp = fopen(filename, "ab");
+	if (fp)
+	{
+		while ((n = fread(buffer, 1, sizeof(buffer), part)) > 0)
+			fwrite(buffer, 1, n, fp);
+		fclose(fp);
+	}
+
+	fclose(part);
+}
+
 void save_times_to_solutions_file(int sol_time)
 {
 	char filename[1000];
@@ -496,13 +511,7 @@ void save_times_to_solutions_file(int sol_time)
 	char date[200];
 	char time[200];
 
-#ifndef LINUX
-	sprintf(filename, "%s\\solutions.sok", global_dir);
-#else
-	sprintf(filename, "%s/solutions.sok", global_dir);
-#endif
-
-	if (global_output_filename[0]) strcpy(filename, global_output_filename);
+	get_solution_filename(filename);
 
 	fp = fopen(filename, "a");
 	if (fp == 0) return;
@@ -16,6 +16,9 @@ void write_log_footer();
 void write_solution_header();
 void save_level_to_solution_file(board b);
 void save_times_to_solutions_file(int sol_time);
+void get_solution_filename(char *filename);
+void append_to_solutions_file(char *part_filename);
+
 
 void init_log_file();
 void write_tree_size_to_log();
\ No newline at end of file
@@ -0,0 +1,219 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef THREADS
+#include <pthread.h>
+#endif
+
+#include "speculate.h"
+#include "advanced_deadlock.h"
+#include "util.h"
+
+// The queue is circular. New jobs are added at the head and taken from the head, since
+// the search is more likely to pick the sons of recent expansions. When the queue is full,
+// the oldest job is dropped.
+
+#define SPEC_QUEUE_SIZE 1024
+#define MAX_SPEC_THREADS 64
+
+typedef struct spec_job
+{
+	board b;
+	move m;
+	int pull_mode;
+	int search_mode;
+	level_context *level;
+} spec_job;
+
+#ifdef THREADS
+
+spec_job *spec_queue = 0;
+int spec_tail = 0;
+int spec_num = 0;
+
+level_context *spec_running[MAX_SPEC_THREADS]; // the level of the job that each thread runs
+pthread_t spec_thread_ids[MAX_SPEC_THREADS];
+int spec_stop = 0;
+
+pthread_mutex_t spec_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t spec_job_added = PTHREAD_COND_INITIALIZER;
+pthread_cond_t spec_job_done = PTHREAD_COND_INITIALIZER;
+
+void *spec_worker(void *arg)
+{
+	int id = (int)(size_t)arg;
+	spec_job *job;
+
+	// the job is copied out of the queue, so the queue can be refilled while it runs
+	job = (spec_job*)malloc(sizeof(spec_job));
+	if (job == 0) exit_with_error("can't allocate speculation job\n");
+
+	while (1)
+	{
+		pthread_mutex_lock(&spec_mutex);
+
+		while ((spec_num == 0) && (spec_stop == 0))
+			pthread_cond_wait(&spec_job_added, &spec_mutex);
+
+		if (spec_stop)
+		{
+			pthread_mutex_unlock(&spec_mutex);
+			break;
+		}
+
+		spec_num--;
+		*job = spec_queue[(spec_tail + spec_num) % SPEC_QUEUE_SIZE];
+		spec_running[id] = job->level;
+
+		pthread_mutex_unlock(&spec_mutex);
+
+		current_level = job->level;
+
+		if (ATOMIC_LOAD_ACQUIRE(&current_level->any_core_solved) == 0)
+			move_is_deadlocked(job->b, &job->m, job->pull_mode, job->search_mode);
+
+		pthread_mutex_lock(&spec_mutex);
+		spec_running[id] = 0;
+		pthread_cond_broadcast(&spec_job_done);
+		pthread_mutex_unlock(&spec_mutex);
+	}
+
+	free(job);
+	return NULL;
+}
+
+void start_spec_threads()
+{
+	// called with spec_mutex locked
+	int i;
+
+	if (spec_threads > MAX_SPEC_THREADS)
+		spec_threads = MAX_SPEC_THREADS;
+
+	spec_queue = (spec_job*)malloc(sizeof(spec_job) * SPEC_QUEUE_SIZE);
+	if (spec_queue == 0) exit_with_error("can't allocate speculation queue\n");
+
+	for (i = 0; i < spec_threads; i++)
+	{
+		spec_running[i] = 0;
+
+		if (pthread_create(spec_thread_ids + i, NULL, spec_worker, (void*)(size_t)i) != 0)
+			exit_with_error("can't create speculation thread\n");
+	}
+
+	if (verbose >= 4)
+		printf("started %d speculation threads\n", spec_threads);
+}
+
+void speculate_move(board b, move *m, int pull_mode, int search_mode)
+{
+	spec_job *job;
+
+	if (spec_threads <= 0) return;
+	if ((m->kill) || (m->base)) return; // never deadlocked
+
+	pthread_mutex_lock(&spec_mutex);
+
+	if (spec_queue == 0)
+		start_spec_threads();
+
+	if (spec_num == SPEC_QUEUE_SIZE)
+	{
+		spec_tail = (spec_tail + 1) % SPEC_QUEUE_SIZE;
+		spec_num--;
+	}
+
+	job = spec_queue + (spec_tail + spec_num) % SPEC_QUEUE_SIZE;
+	spec_num++;
+
+	copy_board(b, job->b);
+	job->m = *m;
+	job->pull_mode = pull_mode;
+	job->search_mode = search_mode;
+	job->level = current_level;
+
+	pthread_cond_signal(&spec_job_added);
+	pthread_mutex_unlock(&spec_mutex);
+}
+
+void cancel_speculation(level_context *l)
+{
+	// remove the jobs of the level, and wait for the jobs that are running.
+	// Must be called before the level's tables are cleared or freed.
+	int i, n = 0, busy;
+
+	if (spec_threads <= 0) return;
+
+	pthread_mutex_lock(&spec_mutex);
+
+	for (i = 0; i < spec_num; i++)
+		if (spec_queue[(spec_tail + i) % SPEC_QUEUE_SIZE].level != l)
+		{
+			if (n != i)
+				spec_queue[(spec_tail + n) % SPEC_QUEUE_SIZE] = spec_queue[(spec_tail + i) % SPEC_QUEUE_SIZE];
+			n++;
+		}
+	spec_num = n;
+
+	do
+	{
+		busy = 0;
+		for (i = 0; i < spec_threads; i++)
+			if (spec_running[i] == l)
+				busy = 1;
+
+		if (busy)
+			pthread_cond_wait(&spec_job_done, &spec_mutex);
+	} while (busy);
+
+	pthread_mutex_unlock(&spec_mutex);
+}
+
+void stop_speculation()
+{
+	// drops the waiting jobs, lets the running ones finish, and joins the threads
+	int i;
+
+	if (spec_threads <= 0) return;
+
+	pthread_mutex_lock(&spec_mutex);
+
+	if (spec_queue == 0) // never started
+	{
+		pthread_mutex_unlock(&spec_mutex);
+		return;
+	}
+
+	spec_num = 0;
+	spec_stop = 1;
+	pthread_cond_broadcast(&spec_job_added);
+	pthread_mutex_unlock(&spec_mutex);
+
+	for (i = 0; i < spec_threads; i++)
+		pthread_join(spec_thread_ids[i], NULL);
+
+	free(spec_queue);
+	spec_queue = 0;
+	spec_stop = 0;
+}
+
+#else
+
+// speculation needs threads
+
+void speculate_move(board, move *, int, int)
+{
+}
+
+void cancel_speculation(level_context *)
+{
+}
+
+void stop_speculation()
+{
+}
+
+#endif
@@ -0,0 +1,19 @@
+// Festival Sokoban Solver
+// Copyright 2018-2022 Yaron Shoham
+
+#ifndef __SPECULATE
+#define __SPECULATE
+
+#include "global.h"
+#include "moves.h"
+
+// With -spec_threads N, helper threads run move_is_deadlocked() on the sons of new expansions
+// in the background. The verdicts are stored in the deadlock cache, so when the search picks
+// one of these sons, its check is a cache hit. Jobs are dropped when the queue is full.
+// The threads start with the first job, and are joined by stop_speculation() when the solver exits.
+
+void speculate_move(board b, move *m, int pull_mode, int search_mode);
+void cancel_speculation(level_context *l);
+void stop_speculation();
+
+#endif
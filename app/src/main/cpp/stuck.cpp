@@ -12,6 +12,7 @@
 #include "wobblers.h"
 #include "deadlock_cache.h"
 #include "mini_search.h"
+#include "knowledge.h"
 
 #define MAX_STUCK_PATTERN_SIZE 12
 #define MAX_STUCK_PATTERNS 500
@@ -30,14 +31,72 @@ typedef struct
 } stuck_pattern;
 
 
-stuck_pattern stuck_patterns[MAX_STUCK_PATTERNS];
-int stuck_patterns_num = 0;
+typedef struct stuck_data
+{
+	stuck_pattern patterns[MAX_STUCK_PATTERNS];
+	int patterns_num;
+} stuck_data;
+
+void allocate_stuck_data(level_context *l)
+{
+	l->stuck = (stuck_data*)calloc(1, sizeof(stuck_data));
+	if (l->stuck == 0) exit_with_error("can't allocate stuck patterns\n");
+}
 
 void init_stuck_patterns()
 {
-	stuck_patterns_num = 0;
+	current_level->stuck->patterns_num = 0;
+}
+
+
+int write_stuck_patterns(FILE *fp, int pull_mode)
+{
+	int i, n = 0;
+	stuck_pattern *sp;
+
+	for (i = 0; i < current_level->stuck->patterns_num; i++)
+		if (current_level->stuck->patterns[i].pull == pull_mode)
+			n++;
+
+	if (write_kb_data(fp, &n, sizeof(int)) == 0) return 0;
+
+	for (i = 0; i < current_level->stuck->patterns_num; i++)
+	{
+		sp = current_level->stuck->patterns + i;
+		if (sp->pull != pull_mode) continue;
+
+		if (write_kb_data(fp, &sp->boxes_num, sizeof(int)) == 0) return 0;
+		if (write_kb_data(fp, sp->boxes, sizeof(int) * sp->boxes_num) == 0) return 0;
+		if (write_kb_board(fp, sp->b) == 0) return 0;
+	}
+	return 1;
 }
 
+int read_stuck_patterns(FILE *fp, int pull_mode)
+{
+	int i, j, n;
+	stuck_pattern sp;
+
+	if (read_kb_data(fp, &n, sizeof(int)) == 0) return 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (read_kb_data(fp, &sp.boxes_num, sizeof(int)) == 0) return 0;
+		if ((sp.boxes_num <= 0) || (sp.boxes_num > MAX_STUCK_PATTERN_SIZE)) return 0;
+
+		if (read_kb_data(fp, sp.boxes, sizeof(int) * sp.boxes_num) == 0) return 0;
+		for (j = 0; j < sp.boxes_num; j++)
+			if ((sp.boxes[j] < 0) || (sp.boxes[j] >= current_level->index_num))
+				return 0;
+
+		if (read_kb_board(fp, sp.b) == 0) return 0;
+		sp.pull = pull_mode;
+
+		if (current_level->stuck->patterns_num < (MAX_STUCK_PATTERNS - 1))
+			current_level->stuck->patterns[current_level->stuck->patterns_num++] = sp;
+	}
+	return 1;
+}
 
 int is_in_stuck_patterns(board b, int pull_mode)
 {
@@ -45,13 +104,13 @@ int is_in_stuck_patterns(board b, int pull_mode)
 	int i, j, y, x;
 	stuck_pattern *sp;
 
-	if (stuck_patterns_num == 0) return 0;
+	if (current_level->stuck->patterns_num == 0) return 0;
 
 	mark_indices_with_boxes(b, indices);
 
-	for (i = 0; i < stuck_patterns_num; i++)
+	for (i = 0; i < current_level->stuck->patterns_num; i++)
 	{
-		sp = stuck_patterns + i;
+		sp = current_level->stuck->patterns + i;
 
 		if (sp->pull != pull_mode) continue;
 
@@ -86,9 +145,9 @@ void add_stuck_pattern(board b, int pull_mode)
 		if (verbose >= 4)
 		{
 			if (pull_mode)
-				printf("adding stuck pattern %d (pull)\n", stuck_patterns_num);
+				printf("adding stuck pattern %d (pull)\n", current_level->stuck->patterns_num);
 			else
-				printf("adding stuck pattern %d \n", stuck_patterns_num);
+				printf("adding stuck pattern %d \n", current_level->stuck->patterns_num);
 
 			print_board(b);
 		}
@@ -97,17 +156,19 @@ void add_stuck_pattern(board b, int pull_mode)
 		if (n > MAX_STUCK_PATTERN_SIZE) exit_with_error("pattern too big");
 		if (n == 0) exit_with_error("empty pattern");
 
-		sp = stuck_patterns + stuck_patterns_num;
+		sp = current_level->stuck->patterns + current_level->stuck->patterns_num;
 
 		copy_board(b, sp->b);
 		get_indices_of_boxes(b, sp->boxes);
 		sp->boxes_num = n;
 		sp->pull = pull_mode;
 
-		stuck_patterns_num++;
+		current_level->stuck->patterns_num++;
+
+		if (current_level->stuck->patterns_num >= MAX_STUCK_PATTERNS) 
+			current_level->stuck->patterns_num--;
 
-		if (stuck_patterns_num >= MAX_STUCK_PATTERNS) 
-			stuck_patterns_num--;
+		ATOMIC_ADD(&current_level->learned_deadlocks, 1);
 
 	}
 
@@ -125,8 +186,8 @@ void distill_pattern(board b, int pull_mode, int distill_method)
 
 	int i, j, res, deadlocked;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b[i][j] & BOX)
 			{
@@ -169,20 +230,20 @@ void register_mini_corral(board b_in)
 	board b;
 	int i, j, res;
 
-	copy_board(initial_board, b);
+	copy_board(current_level->initial_board, b);
 	clear_boxes_inplace(b);
 	clear_sokoban_inplace(b);
 
 	if (is_in_stuck_patterns(b, 0)) return;
 
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (b_in[i][j] & BOX)
 				b[i][j] |= BOX;
 
 			// restore wallified boxes
-			if ((b_in[i][j] == WALL) && (initial_board[i][j] != WALL))
+			if ((b_in[i][j] == WALL) && (current_level->initial_board[i][j] != WALL))
 				b[i][j] |= BOX;
 		}
 
@@ -219,7 +280,7 @@ void slow_xy_deadlock(board b_in, int pull_mode)
 	n = boxes_in_level(b);
 	if (n == 0) return;
 	if (n > MAX_STUCK_PATTERN_SIZE) return;
-	if (n == global_boxes_in_level) return;
+	if (n == current_level->boxes_in_level) return;
 
 	res = xy_deadlock_search(b, pull_mode);
 
@@ -251,7 +312,7 @@ void learn_from_subtrees(tree* t, expansion_data* e)
 	{
 		if (e->subtree_size == (64 + 64*pull_mode))
 		{
-			bytes_to_board(e->b, b);
+			get_expansion_board(e, b);
 			slow_xy_deadlock(b, pull_mode);
 		}
 		e = e->father;
@@ -271,7 +332,7 @@ void recheck_tree_with_patterns(tree* t)
 
 		if (e->node->deadlocked) continue;
 
-		bytes_to_board(e->b, b);
+		get_expansion_board(e, b);
 
 		if (is_in_stuck_patterns(b, t->pull_mode))
 		{
@@ -284,7 +345,7 @@ void recheck_tree_with_patterns(tree* t)
 int test_best_for_patterns(tree* t, expansion_data* e)
 {
 	board b;
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 
 	return is_in_stuck_patterns(b, t->pull_mode);
 }
\ No newline at end of file
@@ -1,8 +1,13 @@
+#include <stdio.h>
+
 #include "board.h"
 #include "tree.h"
 
 int is_stuck_deadlock(board b, int pull_mode);
+void allocate_stuck_data(level_context *l);
 void init_stuck_patterns();
+int write_stuck_patterns(FILE *fp, int pull_mode);
+int read_stuck_patterns(FILE *fp, int pull_mode);
 void learn_from_subtrees(tree* t, expansion_data* e);
 void register_mini_corral(board b);
 
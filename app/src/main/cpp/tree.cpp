@@ -1,5 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stddef.h>
 
 #include "tree.h"
 #include "util.h"
@@ -12,61 +14,89 @@
 #include "naive.h"
 #include "hf_search.h"
 #include "max_dist.h"
+#include "packed_board.h"
+#include "speculate.h"
 
-void init_tree(tree *t, int log_max_nodes)
+UINT_64 get_tree_memory(int log_max_nodes)
+{
+	// the tables allocated by init_tree
+	UINT_64 expansions = (UINT_64)sizeof(expansion_data) << (log_max_nodes - 3);
+
+	return ((UINT_64)sizeof(int) << (log_max_nodes + 2)) +
+		((UINT_64)sizeof(node_element) << log_max_nodes) +
+		expansions * 3 + // including the boards
+		((UINT_64)sizeof(move_hash_data) << (log_max_nodes + 1));
+}
+
+// The tree tables are reserved at their largest size (log_max_nodes), but a tree starts small
+// and doubles when it is nearly full. Since the tables grow in place, indices and pointers
+// into them stay valid. Only the hash array is rebuilt when the tree grows.
+
+#define INITIAL_TREE_LOG_SIZE 16
+
+UINT_64 get_boards_size(int log_size)
+{
+	return ((UINT_64)sizeof(expansion_data) << (log_size - 3)) * 2;
+}
+
+void set_tree_size(tree *t, int log_size)
 {
 	int i;
-	size_t size; 
 
-	// hash_array
-	t->hash_size = 1 << (log_max_nodes + 2);
-	size = sizeof(int) * (size_t)t->hash_size;
-	if (verbose >= 4)
-		printf("Allocating %12llu bytes for hash_array\n", (UINT_64)size);
-	t->hash_array = (int*)malloc(size);
+	t->log_size = log_size;
+
+	t->hash_size = 1 << (log_size + 2);
 	t->mask = t->hash_size - 1;
+	t->max_nodes = 1 << log_size;
+	t->max_expansions = 1 << (log_size - 3);
+	t->boards_size = get_boards_size(log_size);
+	t->max_move_hashes = 1 << (log_size + 1);
+
+	commit_memory(t->hash_array, sizeof(int) * (UINT_64)t->hash_size);
+	commit_memory(t->nodes, sizeof(node_element) * (UINT_64)t->max_nodes);
+	commit_memory(t->expansions, sizeof(expansion_data) * (UINT_64)t->max_expansions);
+	commit_memory(t->boards, t->boards_size);
+	commit_memory(t->move_hashes, sizeof(move_hash_data) * (UINT_64)t->max_move_hashes);
 
-	if (t->hash_array == 0) exit_with_error("can't allocate hash_array");
 	for (i = 0; i < t->hash_size; i++)
 		t->hash_array[i] = -1;
+}
+
+void init_tree(tree *t, int log_max_nodes)
+{
+	UINT_64 size;
+
+	t->max_log_size = log_max_nodes;
 
-	// nodes
-	t->max_nodes = 1 << log_max_nodes;
-	size = sizeof(node_element) * (size_t)t->max_nodes;
 	if (verbose >= 4)
-		printf("Allocating %12llu bytes for %12d nodes\n", (UINT_64)size, t->max_nodes);
-	t->nodes = (node_element*)malloc(size);
+		printf("Reserving  %12llu bytes for a tree of up to %d nodes\n", 
+			get_tree_memory(log_max_nodes), 1 << log_max_nodes);
+
+	size = sizeof(int) << (log_max_nodes + 2);
+	t->hash_array = (int*)reserve_memory(size);
+
+	size = sizeof(node_element) << log_max_nodes;
+	t->nodes = (node_element*)reserve_memory(size);
 	t->nodes_num = 0;
-	if (t->nodes == 0) exit_with_error("can't allocate nodes");
 
-	// expansions
-	t->max_expansions = 1 << (log_max_nodes - 3);
-	size = sizeof(expansion_data) * (size_t)t->max_expansions;
-	if (verbose >= 4)
-		printf("Allocating %12llu bytes for %12d expansions\n", (UINT_64)size, t->max_expansions);
-	t->expansions = (expansion_data *)malloc(size);
-	if (t->expansions == 0) exit_with_error("can't allocate expansions list");
+	size = sizeof(expansion_data) << (log_max_nodes - 3);
+	t->expansions = (expansion_data *)reserve_memory(size);
 	t->expansions_num = 0;
 
-	// boards
-	t->boards_size = size * 2;
-	if (verbose >= 4)
-		printf("Allocating %12llu bytes for    ~ %7d boards\n", (UINT_64)t->boards_size, 
-			(int)(t->boards_size / 225)); // assume 15x15 boards
-	t->boards = (UINT_8 *)malloc((size_t)t->boards_size);
-	if (t->boards == 0) exit_with_error("can't allocate boards");
-
-	// move-shashes
-	t->max_move_hashes = 1 << (log_max_nodes + 1);
-	size = sizeof(move_hash_data) * (size_t)t->max_move_hashes;
-	if (verbose >= 4)
-		printf("Allocating %12llu bytes for %12d move-hashes\n", (UINT_64)size, t->max_move_hashes);
-	t->move_hashes = (move_hash_data *)malloc(size);
-	if (t->move_hashes == 0) exit_with_error("can't allocate move-hashes");
+	t->boards = (UINT_8 *)reserve_memory(get_boards_size(log_max_nodes));
+	t->boards_used = 0;
+	t->fixed_board_set = 0;
+
+	size = sizeof(move_hash_data) << (log_max_nodes + 1);
+	t->move_hashes = (move_hash_data *)reserve_memory(size);
 	t->move_hashes_num = 0;
 
+	set_tree_size(t, (log_max_nodes < INITIAL_TREE_LOG_SIZE ? log_max_nodes : INITIAL_TREE_LOG_SIZE));
+
 	// label queues
-	t->queues = (queue*)malloc(sizeof(queue) * MAX_TREE_LABELS);
+	t->max_labels = 256;
+	t->queues = (queue*)malloc(sizeof(queue) * t->max_labels);
+	if (t->queues == 0) exit_with_error("can't allocate queues");
 	t->labels_num = 0;
 
 	t->pull_mode = -1;
@@ -76,12 +106,13 @@ void init_tree(tree *t, int log_max_nodes)
 void free_tree(tree *t)
 {
 	int i;
+	int log_size = t->max_log_size;
 
-	free(t->hash_array);
-	free(t->nodes);
-	free(t->expansions);
-	free(t->move_hashes);
-	free(t->boards);
+	release_memory(t->hash_array, sizeof(int) << (log_size + 2));
+	release_memory(t->nodes, sizeof(node_element) << log_size);
+	release_memory(t->expansions, sizeof(expansion_data) << (log_size - 3));
+	release_memory(t->move_hashes, sizeof(move_hash_data) << (log_size + 1));
+	release_memory(t->boards, get_boards_size(log_size));
 
 	for (i = 0; i < t->labels_num; i++)
 		free_heap(t->queues + i);
@@ -92,11 +123,14 @@ void reset_tree(tree *t)
 {
 	int i;
 
-	for (i = 0; i < t->hash_size; i++)
-		t->hash_array[i] = -1;
 	t->nodes_num = 0;
 	t->expansions_num = 0;
 	t->move_hashes_num = 0;
+	t->boards_used = 0;
+	t->fixed_board_set = 0;
+
+	// start small again, this also clears the hash array
+	set_tree_size(t, (t->max_log_size < INITIAL_TREE_LOG_SIZE ? t->max_log_size : INITIAL_TREE_LOG_SIZE));
 
 	for (i = 0; i < t->labels_num; i++)
 		reset_heap(t->queues + i);
@@ -104,33 +138,28 @@ void reset_tree(tree *t)
 	
 }
 
-int tree_nearly_full(tree *t)
+void store_expansion_board(tree *t, expansion_data *e, board b)
 {
-	if (t->expansions_num > (t->max_expansions - 2))
+	if (t->fixed_board_set == 0)
 	{
-		if (verbose >= 4) printf("max tree expansions reached\n");
-		return 1;
-	}
-	if (t->nodes_num > (t->max_nodes - MAX_MOVES))
-	{
-		if (verbose >= 4) printf("max tree nodes reached\n");
-		return 1;
-	}
-	if (t->move_hashes_num > (t->max_move_hashes - MAX_MOVES))
-	{
-		if (verbose >= 4) printf("max tree move-hashes reached\n");
-		return 1;
+		set_fixed_board(b, t->fixed_board);
+		t->fixed_board_set = 1;
 	}
 
-	if (((t->expansions_num + 1) * height * width) >= (t->boards_size))
-	{
-		if (verbose >= 4) printf("max boards reached\n");
-		return 1;
-	}
+	if ((t->boards_used + get_max_packed_board_size()) > t->boards_size)
+		exit_with_error("boards overflow");
 
-	return 0;
+	e->b = t->boards + t->boards_used;
+	e->fixed = t->fixed_board;
+	t->boards_used += pack_board(b, t->fixed_board, e->b);
 }
 
+void get_expansion_board(expansion_data *e, board b)
+{
+	if (e->b == 0) exit_with_error("board of a pruned expansion");
+
+	unpack_board(e->b, e->fixed, b);
+}
 
 int find_node_by_hash(tree *t, UINT_64 hash)
 {
@@ -165,6 +194,255 @@ void add_entry_to_hash_array(tree *t, UINT_64 hash, int node_place)
 	t->hash_array[index] = node_place;
 }
 
+int tree_needs_room(tree *t)
+{
+	// returns which table is nearly full, or 0
+	if (t->expansions_num > (t->max_expansions - 2))
+		return 1;
+	if (t->nodes_num > (t->max_nodes - MAX_MOVES))
+		return 2;
+	if (t->move_hashes_num > (t->max_move_hashes - MAX_MOVES))
+		return 3;
+	if ((t->boards_used + get_max_packed_board_size()) >= t->boards_size)
+		return 4;
+	return 0;
+}
+
+int grow_tree(tree *t)
+{
+	int i;
+
+	if (t->log_size >= t->max_log_size)
+		return 0;
+
+	set_tree_size(t, t->log_size + 1);
+
+	for (i = 0; i < t->nodes_num; i++)
+		add_entry_to_hash_array(t, t->nodes[i].hash, i);
+
+	if (verbose >= 4)
+		printf("tree grown to %d nodes\n", t->max_nodes);
+
+	return 1;
+}
+
+void make_room_in_tree(tree *t)
+{
+	while (tree_needs_room(t))
+		if (grow_tree(t) == 0)
+			return;
+}
+
+int get_expansion_board_size(tree *t, int i, UINT_8 *boards_end)
+{
+	// boards are stored in the order of the expansions
+	int j;
+
+	for (j = i + 1; j < t->expansions_num; j++)
+		if (t->expansions[j].b)
+			return (int)(t->expansions[j].b - t->expansions[i].b);
+
+	return (int)(boards_end - t->expansions[i].b);
+}
+
+void rebuild_label_queues(tree *t)
+{
+	int i;
+	expansion_data *e;
+
+	for (i = 0; i < t->labels_num; i++)
+		reset_heap(t->queues + i);
+
+	for (i = 0; i < t->expansions_num; i++)
+	{
+		e = t->expansions + i;
+		e->heap_pos = -1;
+		set_best_move(t, e);
+		if (e->best_move != -1)
+			heap_insert(t->queues + e->label, i);
+	}
+}
+
+int compact_tree(tree *t, expansion_data **best_so_far)
+{
+	// Reclaims the space of subtrees that the search is not likely to request:
+	// - deadlocked expansions, and expansions that have no move left to expand.
+	// - the worse half of the queue of each label. The labels are requested in turn, and each
+	//   request takes the best expansion of the label, so these are requested last.
+	// Kept are the rest, the last expansion, the best so far, and their ancestors (the moves of
+	// the ancestors are needed to rebuild the solution).
+	// A removed expansion that is the son of a kept one is left as a node: as an unexpanded son
+	// if it still had moves, so it can be expanded again, or as a deadlocked son if it had none.
+	// The expansions table is compacted in order, so fathers stay before their sons, and the
+	// label queues are rebuilt.
+	// Returns 1 if at least 1/16 of one of the tables was reclaimed, so the search does not
+	// compact again after every expansion.
+
+	int i, j, k;
+	int nodes_num = t->nodes_num;
+	int expansions_num = t->expansions_num;
+	int move_hashes_num = t->move_hashes_num;
+	UINT_64 boards_used = t->boards_used;
+	int *exp_place, *node_place, *board_size;
+	expansion_data *e;
+	move_hash_data *mh;
+	queue *q;
+	UINT_8 *b;
+
+	if (t->search_mode == GIRL_SEARCH) return 0; // walks the tree through all the moves
+	if (t->expansions_num == 0) return 0;
+
+	exp_place = (int*)malloc(sizeof(int) * expansions_num);
+	board_size = (int*)malloc(sizeof(int) * expansions_num);
+	node_place = (int*)malloc(sizeof(int) * nodes_num);
+	if ((exp_place == 0) || (board_size == 0) || (node_place == 0))
+		exit_with_error("can't compact tree");
+
+	rebuild_label_queues(t); // the queues are updated lazily, so some of their moves are taken
+
+	for (i = 0; i < expansions_num; i++)
+		exp_place[i] = -1;
+
+	for (i = 0; i < t->labels_num; i++)
+	{
+		q = t->queues + i;
+		for (j = (q->heap_size + 1) / 2; j > 0; j--)
+			exp_place[extarct_max(q)] = 0;
+	}
+
+	exp_place[expansions_num - 1] = 0;
+	if (*best_so_far)
+		exp_place[*best_so_far - t->expansions] = 0;
+
+	// fathers are expanded before their sons
+	for (i = expansions_num - 1; i >= 0; i--)
+		if ((exp_place[i] == 0) && t->expansions[i].father)
+			exp_place[t->expansions[i].father - t->expansions] = 0;
+
+	for (i = 0; i < expansions_num; i++)
+	{
+		e = t->expansions + i;
+		board_size[i] = get_expansion_board_size(t, i, t->boards + boards_used);
+
+		if (exp_place[i] == -1)
+		{
+			e->node->expansion = -1;
+			if (e->best_move == -1)
+				e->node->deadlocked = 1;
+		}
+	}
+
+	// nodes of kept expansions, and their sons, are kept
+	for (i = 0; i < nodes_num; i++)
+		node_place[i] = -1;
+
+	for (i = 0; i < expansions_num; i++)
+	{
+		if (exp_place[i] == -1) continue;
+		e = t->expansions + i;
+		node_place[e->node - t->nodes] = 0;
+
+		mh = t->move_hashes + e->move_hash_place;
+		for (j = 0; j < e->moves_num; j++)
+			node_place[find_node_by_hash(t, mh[j].hash)] = 0;
+	}
+
+	t->nodes_num = 0;
+	for (i = 0; i < nodes_num; i++)
+	{
+		if (node_place[i] == -1) continue;
+		node_place[i] = t->nodes_num;
+		t->nodes[t->nodes_num++] = t->nodes[i];
+	}
+
+	t->expansions_num = 0;
+	t->move_hashes_num = 0;
+	t->boards_used = 0;
+
+	for (i = 0; i < expansions_num; i++)
+	{
+		if (exp_place[i] == -1) continue;
+
+		k = t->expansions_num++;
+		exp_place[i] = k;
+		e = t->expansions + i;
+
+		// best_past points to the score of the node of an ancestor
+		j = (int)(((node_element*)((char*)e->best_past - offsetof(node_element, score))) - t->nodes);
+		e->best_past = &(t->nodes[node_place[j]].score);
+		e->node = t->nodes + node_place[e->node - t->nodes];
+		e->node->expansion = k;
+
+		if (e->father)
+			e->father = t->expansions + exp_place[e->father - t->expansions];
+
+		memmove(t->move_hashes + t->move_hashes_num, t->move_hashes + e->move_hash_place,
+			sizeof(move_hash_data) * e->moves_num);
+		e->move_hash_place = t->move_hashes_num;
+		t->move_hashes_num += e->moves_num;
+
+		b = t->boards + t->boards_used;
+		memmove(b, e->b, board_size[i]);
+		e->b = b;
+		t->boards_used += board_size[i];
+
+		t->expansions[k] = *e;
+	}
+
+	for (i = 0; i < t->hash_size; i++)
+		t->hash_array[i] = -1;
+	for (i = 0; i < t->nodes_num; i++)
+		add_entry_to_hash_array(t, t->nodes[i].hash, i);
+
+	// removed sons may now be the best moves of their fathers
+	rebuild_label_queues(t);
+
+	if (*best_so_far)
+		*best_so_far = t->expansions + exp_place[*best_so_far - t->expansions];
+
+	free(exp_place);
+	free(board_size);
+	free(node_place);
+
+	if (verbose >= 4)
+		printf("tree compacted. expansions: %d -> %d nodes: %d -> %d move-hashes: %d -> %d boards: %llu -> %llu bytes\n",
+			expansions_num, t->expansions_num, nodes_num, t->nodes_num,
+			move_hashes_num, t->move_hashes_num, boards_used, t->boards_used);
+
+	if ((expansions_num - t->expansions_num) >= (t->max_expansions >> 4)) return 1;
+	if ((nodes_num - t->nodes_num) >= (t->max_nodes >> 4)) return 1;
+	if ((move_hashes_num - t->move_hashes_num) >= (t->max_move_hashes >> 4)) return 1;
+	if ((boards_used - t->boards_used) >= (t->boards_size >> 4)) return 1;
+	return 0;
+}
+
+int tree_nearly_full(tree *t, expansion_data **best_so_far)
+{
+	// the tree may be compacted, which moves the expansions. best_so_far is updated, and the
+	// last expansion stays the last.
+	int table;
+
+	make_room_in_tree(t);
+
+	table = tree_needs_room(t);
+
+	// at the largest size, try to reclaim the space of subtrees that are no longer searched
+	if (table)
+		if (compact_tree(t, best_so_far))
+			table = tree_needs_room(t);
+
+	if (verbose >= 4)
+	{
+		if (table == 1) printf("max tree expansions reached\n");
+		if (table == 2) printf("max tree nodes reached\n");
+		if (table == 3) printf("max tree move-hashes reached\n");
+		if (table == 4) printf("max boards reached\n");
+	}
+
+	return (table != 0);
+}
+
+
 void get_score_of_hash(tree *t, UINT_64 hash, score_element *s)
 {
 	int place;
@@ -212,7 +490,7 @@ int node_is_solved(tree *t, expansion_data *e)
 {
 	board b;
 
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 
 	if (e->depth == 0) return 0;
 	// a poistion can't be solved without making any moves
@@ -289,7 +567,7 @@ void set_advisors_in_node(tree *t, expansion_data *e, helper *h)
 	}
 
 
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 	set_advisors_inner(b, &(e->node->score), e->moves_num, moves, scores, 
 		t->pull_mode, t->search_mode, &(e->advisors), already_expanded, h);
 }
@@ -327,20 +605,21 @@ void fill_expansion_structures(tree *t, expansion_data *e, helper *h)
 	UINT_64 hash;
 	score_element s;
 	board b,c;
+	move_parent parent;
 	int moves_num;
 	int i;
 
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 	moves_num = find_possible_moves(b, moves, t->pull_mode, &(e->has_corral), t->search_mode, h);
 
 	e->moves_num = moves_num;
 
+	prepare_move_parent(b, e->node->hash, &parent);
+
 	e->move_hash_place = t->move_hashes_num;
 	for (i = 0; i < moves_num; i++)
 	{
-		bytes_to_board(e->b, c);
-		apply_move(c, moves + i, t->search_mode);
-		hash = get_board_hash(c);
+		hash = apply_move_and_hash(&parent, moves + i, t->search_mode, c);
 
 		t->move_hashes[t->move_hashes_num + i].move = moves[i];
 		t->move_hashes[t->move_hashes_num + i].hash = hash;
@@ -423,6 +702,7 @@ void set_best_move(tree *t, expansion_data *e)
 	{
 		e->best_score = best_score;
 		e->best_weight = e->weight + best_weight;
+		e->has_score_key = get_score_key(&best_score, t->pull_mode, t->search_mode, &e->best_score_key);
 	}
 	else
 		set_deadlock_status(t, e);
@@ -464,11 +744,41 @@ void add_board_to_tree(tree *t, board b, helper *h)
 	UINT_64 hash;
 	score_element s;
 
+	make_room_in_tree(t);
+
 	hash = get_board_hash(b);
 	score_board(b, &s, t->pull_mode, t->search_mode, h);
 	add_node_to_tree(t, hash, &s);
 }
 
+void speculate_on_sons(tree *t, expansion_data *e)
+{
+	// let the speculation threads check the sons that may be expanded later
+	int i, place;
+	move_hash_data *mh;
+	node_element *node;
+	board b;
+
+	if (spec_threads <= 0) return;
+	if (e->node->deadlocked) return;
+
+	get_expansion_board(e, b);
+
+	mh = t->move_hashes + e->move_hash_place;
+	for (i = 0; i < e->moves_num; i++)
+	{
+		if (mh[i].deadlocked) continue;
+
+		place = find_node_by_hash(t, mh[i].hash);
+		if (place == -1) continue;
+		node = t->nodes + place;
+
+		if ((node->deadlocked) || (node->expansion != -1)) continue;
+
+		speculate_move(b, &mh[i].move, t->pull_mode, t->search_mode);
+	}
+}
+
 void set_root(tree *t, board b, helper *h)
 {
 	UINT_64 hash;
@@ -479,6 +789,8 @@ void set_root(tree *t, board b, helper *h)
 
 	if (t->search_mode == -1) exit_with_error("search mode not initialized");
 
+	make_room_in_tree(t);
+
 	nodes_before_expansion = t->nodes_num;
 
 	hash = get_board_hash(b);
@@ -502,8 +814,7 @@ void set_root(tree *t, board b, helper *h)
 	t->expansions_num++;
 
 	e->node = t->nodes + node_place;
-	e->b = t->boards + height*width*(t->expansions_num - 1);
-	board_to_bytes(b, e->b);
+	store_expansion_board(t, e, b);
 	e->best_past = &(e->node->score);
 	e->label = -1;
 	e->weight = 0;
@@ -511,10 +822,13 @@ void set_root(tree *t, board b, helper *h)
 	e->father = NULL;
 	e->best_move = -1;
 	e->best_weight = 1000000;
+	e->has_score_key = 0;
+	e->heap_pos = -1;
 
 	fill_expansion_structures(t, e, h);
 
 	set_deadlock_status(t, e);
+	speculate_on_sons(t, e);
 
 	// some initializations for girl mode
 	e->subtree_size = 1;
@@ -536,6 +850,8 @@ void expand_node(tree *t, expansion_data *e, int son, helper *h)
 	int nodes_before_expansion;
 	move move_to_play;
 
+	make_room_in_tree(t);
+
 	nodes_before_expansion = t->nodes_num;
 
 	mh = t->move_hashes + e->move_hash_place;
@@ -555,14 +871,13 @@ void expand_node(tree *t, expansion_data *e, int son, helper *h)
 	if (t->expansions_num >= t->max_expansions)
 		exit_with_error("max expansions reached");
 
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 	move_to_play = mh[son].move;
 	apply_move(b, &move_to_play, t->search_mode);
 	if (get_board_hash(b) != mh[son].hash) exit_with_error("hash error");
 
 	next->node = n;
-	next->b = t->boards + height*width*(t->expansions_num - 1);
-	board_to_bytes(b, next->b);
+	store_expansion_board(t, next, b);
 
 	next->best_past = e->best_past;
 	if (is_better_score(&(n->score), e->best_past, t->pull_mode, t->search_mode))
@@ -573,12 +888,15 @@ void expand_node(tree *t, expansion_data *e, int son, helper *h)
 	next->depth  = e->depth + 1;
 	next->best_weight = 1000000;
 	next->best_move = -1;
+	next->has_score_key = 0;
+	next->heap_pos = -1;
 	next->father = e;
 	next->subtree_size = 0;
 
 	fill_expansion_structures(t, next, h);
 
 	set_deadlock_status(t, next);
+	speculate_on_sons(t, next);
 
 	update_subtree_size(t, next);
 
@@ -619,7 +937,7 @@ void set_imagine_data_in_node(tree *t, expansion_data *e, helper *h)
 		get_score_of_hash(t, mh[i].hash, scores + i);
 	}
 	
-	bytes_to_board(e->b, b);
+	get_expansion_board(e, b);
 	compute_imagine_distance(b, &(e->node->score), e->moves_num, moves, scores, t->search_mode, h);
 
 	for (i = 0; i < e->moves_num; i++)
@@ -820,7 +1138,7 @@ void add_label_to_last_node(tree *t, int label, helper *h)
 {
 	int last_node = t->expansions_num - 1;
 
-	if ((label < 0) || (label >= MAX_TREE_LABELS))
+	if (label < 0)
 		exit_with_error("label overflow");
 
 	t->expansions[last_node].label = label;
@@ -832,6 +1150,13 @@ void add_label_to_last_node(tree *t, int label, helper *h)
 
 		if (label == t->labels_num)
 		{
+			if (t->labels_num == t->max_labels)
+			{
+				t->max_labels *= 2;
+				t->queues = (queue*)realloc(t->queues, sizeof(queue) * t->max_labels);
+				if (t->queues == 0) exit_with_error("can't grow queues");
+			}
+
 //			printf("Adding new queue: %d\n", label);
 			init_queue(t->queues + label, t);
 			t->labels_num++;
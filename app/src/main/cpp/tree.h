@@ -8,8 +8,6 @@
 #include "queue.h"
 #include "helper.h"
 
-#define MAX_TREE_LABELS 10000
-
 typedef struct move_hash_data
 {
 	move move;
@@ -28,7 +26,8 @@ typedef struct node_element
 
 typedef struct expansion_data
 {
-	UINT_8 *b;
+	UINT_8 *b; // packed, see packed_board.h
+	UINT_8 (*fixed)[MAX_SIZE];
 	node_element *node;
 	expansion_data *father;
 	int moves_num;
@@ -36,6 +35,9 @@ typedef struct expansion_data
 	int best_move;
 	int best_weight;
 	score_element best_score;
+	UINT_64 best_score_key; // see get_score_key, valid if has_score_key
+	int has_score_key;
+	int heap_pos; // place in the queue of its label, -1 if not queued
 	score_element *best_past;
 	int label;
 	int has_corral;
@@ -53,6 +55,10 @@ typedef struct expansion_data
 
 typedef struct tree
 {
+	// current size, and the size reserved for the tree to grow to
+	int log_size;
+	int max_log_size;
+
 	// hash_array
 	int *hash_array;
 	int hash_size;
@@ -73,22 +79,27 @@ typedef struct tree
 	int move_hashes_num;
 	int max_move_hashes;
 
-	// boards
+	// packed boards
 	UINT_8 *boards;
 	unsigned long long boards_size;
+	unsigned long long boards_used;
+	board fixed_board;
+	int fixed_board_set;
 
-	// queues
+	// queues, one per label. Grows as labels are added
 	queue *queues;
 	int labels_num;
+	int max_labels;
 
 	int pull_mode;
 	int search_mode;
 } tree;
 
 
+UINT_64 get_tree_memory(int log_max_nodes);
 void init_tree(tree *t, int log_max_nodes);
 void free_tree(tree *t);
-int tree_nearly_full(tree *t);
+int tree_nearly_full(tree *t, expansion_data **best_so_far);
 void set_root(tree *t, board b, helper *h);
 void set_advisors_and_weights_to_last_node(tree *t, helper *h);
 int best_move_in_tree(tree *t, int label, int *best_pos, int *best_son);
@@ -114,5 +125,6 @@ int update_best_so_far(expansion_data **best_so_far, expansion_data *new_node, i
 expansion_data *best_node_in_tree(tree *t);
 int tree_has_unexpanded_nodes(tree *t);
 void set_subtree_as_deadlocked(tree* t, expansion_data* e);
+void get_expansion_board(expansion_data *e, board b);
 
 #endif
\ No newline at end of file
@@ -19,6 +19,7 @@
 #else
 #include <termios.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #endif
 
 
@@ -45,9 +46,9 @@ void print_2d_array(int a[MAX_SIZE][MAX_SIZE])
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if (a[i][j] == 1000000)
 				printf(".");
@@ -122,11 +123,11 @@ void show_ints_on_initial_board(int dist[MAX_SIZE][MAX_SIZE])
 {
 	int i, j;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (initial_board[i][j] == WALL)
+			if (current_level->initial_board[i][j] == WALL)
 			{
 				printf("#");
 				continue;
@@ -170,6 +171,44 @@ char linux_getch(void)
 }
 #endif
 
+void *reserve_memory(UINT_64 size)
+{
+	// address space for a table that grows in place, so pointers into it stay valid.
+	// Only the committed part is backed by memory (on Linux, the part that was written).
+	void *p;
+
+#ifdef LINUX
+	p = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED) p = 0;
+#else
+	p = VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE, PAGE_READWRITE);
+#endif
+
+	if (p == 0) exit_with_error("can't reserve memory");
+	return p;
+}
+
+void commit_memory(void *p, UINT_64 size)
+{
+#ifndef LINUX
+	if (VirtualAlloc(p, (SIZE_T)size, MEM_COMMIT, PAGE_READWRITE) == 0)
+		exit_with_error("can't commit memory");
+#else
+	// the reservation is committed on first touch
+	(void)p;
+	(void)size;
+#endif
+}
+
+void release_memory(void *p, UINT_64 size)
+{
+#ifdef LINUX
+	munmap(p, (size_t)size);
+#else
+	VirtualFree(p, 0, MEM_RELEASE);
+#endif
+}
+
 void my_getch()
 {
 #ifndef LINUX
@@ -203,19 +242,50 @@ void get_sol_time_as_hms(int sol_time, char *hms)
 int is_cyclic_level()
 {
 	int i, j;
-	for (i = 0; i < height; i++)
-		for (j = 0; j < width; j++)
+	for (i = 0; i < current_level->height; i++)
+		for (j = 0; j < current_level->width; j++)
 		{
-			if (initial_board[i][j] == BOX) return 0;
-			if (initial_board[i][j] == TARGET) return 0;
+			if (current_level->initial_board[i][j] == BOX) return 0;
+			if (current_level->initial_board[i][j] == TARGET) return 0;
 		}
 	return 1;
 }
 
-int time_limit_exceeded(int time_limit, int local_start_time)
+UINT_64 get_time_in_ms()
+{
+	// monotonic wall clock, used to measure short intervals
+#ifndef LINUX
+	return GetTickCount64();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT_64)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+UINT_64 get_time_in_us()
 {
-	int running_time = (int)time(0) - local_start_time;
-	if (running_time > time_limit)
+#ifndef LINUX
+	LARGE_INTEGER counter, frequency;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&frequency);
+	return (UINT_64)(counter.QuadPart * 1000000 / frequency.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (UINT_64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+int get_elapsed_ms(UINT_64 start_ms)
+{
+	return (int)(get_time_in_ms() - start_ms);
+}
+
+int time_limit_exceeded(int time_allocation, UINT_64 local_start_ms)
+{
+	// time_allocation is in milliseconds
+	if (get_elapsed_ms(local_start_ms) > time_allocation)
 	{
 		if (verbose >= 4) printf("time limit exceeded\n");
 		return 1;
@@ -226,8 +296,8 @@ int time_limit_exceeded(int time_limit, int local_start_time)
 
 int get_number_of_cores()
 {
-	int processor_count;
-	unsigned long long memory;
+	int processor_count = 1;
+	unsigned long long memory = 0;
 
 	cores_num = 1;
 
@@ -238,24 +308,49 @@ int get_number_of_cores()
 	SYSTEM_INFO sysinfo;
 	GetSystemInfo(&sysinfo);
 	processor_count = sysinfo.dwNumberOfProcessors;
-	printf("detected %d cores\n", processor_count);
 
 	MEMORYSTATUSEX status;
 	status.dwLength = sizeof(status);
 	GlobalMemoryStatusEx(&status);
 	memory = status.ullTotalPhys;
-	memory = (int)((memory / 1073741824.0) + 0.5);
-	printf("detected %lld GB memory\n", memory);
+#else
+#ifdef THREADS
+	processor_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	memory = (unsigned long long)sysconf(_SC_PHYS_PAGES) * (unsigned long long)sysconf(_SC_PAGE_SIZE);
+#endif
+#endif
+	memory = (unsigned long long)((memory / 1073741824.0) + 0.5);
 
-	if ((processor_count >= 2) && (memory >= 5))
-		cores_num = 2;
+	if (processor_count > 1)
+	{
+		printf("detected %d cores\n", processor_count);
+		printf("detected %lld GB memory\n", memory);
+	}
 
-	if ((processor_count >= 4) && (memory >= 9))
-		cores_num = 4;
+	// each core needs about 2GB for its search tree and its share of the global tables
+	if (memory > 1)
+		cores_num = (int)((memory - 1) / 2);
+
+	if (cores_num > processor_count) cores_num = processor_count;
+	if (cores_num < 1) cores_num = 1;
 
-	if ((processor_count >= 8) && (memory >= 16))
-		cores_num = 8;
-#endif
 	printf("using %d threads\n", cores_num);
 	return cores_num;
-}
\ No newline at end of file
+}
+
+int get_cores_log()
+{
+	// the global tables grow with the number of cores, up to the size used for 8 cores
+	int cores_log = 0;
+
+	while (((2 << cores_log) <= cores_num) && (cores_log < 3))
+		cores_log++;
+
+	return cores_log;
+}
+
+int threads_share_level()
+{
+	// the tables of a level need locks if several search threads or speculation threads use them
+	return (cores_num > 1) || (spec_threads > 0);
+}
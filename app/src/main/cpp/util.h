@@ -19,6 +19,15 @@ void show_ints_on_initial_board(int_board dist);
 void get_date_as_string(char *time, char *date);
 void get_sol_time_as_hms(int sol_time, char *hms);
 int is_cyclic_level();
-int time_limit_exceeded(int time_limit, int local_start_time);
-
-int get_number_of_cores();
\ No newline at end of file
+int time_limit_exceeded(int time_allocation, UINT_64 local_start_ms);
+UINT_64 get_time_in_ms();
+int get_elapsed_ms(UINT_64 start_ms);
+UINT_64 get_time_in_us();
+
+void *reserve_memory(UINT_64 size);
+void commit_memory(void *p, UINT_64 size);
+void release_memory(void *p, UINT_64 size);
+
+int get_number_of_cores();
+int get_cores_log();
+int threads_share_level();
\ No newline at end of file
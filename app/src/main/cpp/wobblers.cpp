@@ -64,9 +64,9 @@ void remove_boxes_with_no_player_access(board b, int pull_mode, int with_diag)
 	int touched;
 	int untouched;
 
-	for (i = 0; i < height; i++)
+	for (i = 0; i < current_level->height; i++)
 	{
-		for (j = 0; j < width; j++)
+		for (j = 0; j < current_level->width; j++)
 		{
 			if ((b[i][j] & BOX) == 0) continue;
 
@@ -153,9 +153,9 @@ void remove_wobblers(board b, int pull_mode)
 	{
 		changed = 0;
 
-		for (i = 0; i < height; i++)
+		for (i = 0; i < current_level->height; i++)
 		{
-			for (j = 0; j < width; j++)
+			for (j = 0; j < current_level->width; j++)
 			{
 				if ((b[i][j] & BOX) == 0) continue;
 
@@ -211,31 +211,7 @@ int is_better_wobblers_score(score_element *new_score, score_element *old_score)
 
 int get_best_wobblers_move(position *positions, int pos_num, int *son)
 {
-	int i, j;
-	position *p;
-	int best_pos = -1;
-	score_element best_score;
-
-	for (i = 0; i < pos_num; i++)
-	{
-		p = positions + i;
-		if (p->position_deadlocked) continue;
-
-		for (j = 0; j < p->moves_num; j++)
-		{
-			if (p->move_deadlocked[j]) continue;
-			if (p->place_in_positions[j]) continue;
-
-			if ((best_pos == -1) || (is_better_wobblers_score(p->scores + j, &best_score)))
-			{
-				best_pos = i;
-				*son = j;
-				best_score = p->scores[j];
-			}
-		}
-	}
-
-	return best_pos;
+	return best_frontier_move(positions, pos_num, son, is_better_wobblers_score);
 }
 
 
@@ -307,7 +283,7 @@ int wobblers_search_actual(board b, int pull_mode, int max_positions)
 		}
 	}
 
-	free_positions(positions, max_positions);
+	free_positions(positions);
 
 	return res;
 }
@@ -395,7 +371,7 @@ int is_wobblers_deadlock(board b_in, int pull_mode)
 
 	n = boxes_in_level(b);
 	if (n == 0) return 0;
-	if (n == global_boxes_in_level) return 0;
+	if (n == current_level->boxes_in_level) return 0;
 
 	res = wobbler_deadlock_search(b, pull_mode);
 
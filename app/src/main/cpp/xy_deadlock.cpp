@@ -39,7 +39,7 @@ void mark_hv_indices(board b, move *moves, int moves_num, int *indices)
 			con_ok[i] = 1;
 	}
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 		h_indices[i] = v_indices[i] = 0;
 
 	for (i = 0; i < moves_num; i++)
@@ -56,7 +56,7 @@ void mark_hv_indices(board b, move *moves, int moves_num, int *indices)
 		if (to_x != from_x) h_indices[from] = 1;
 	}
 
-	for (i = 0; i < index_num; i++)
+	for (i = 0; i < current_level->index_num; i++)
 		indices[i] = v_indices[i] & h_indices[i];
 }
 
@@ -98,31 +98,7 @@ int is_better_xy_score(score_element *new_score, score_element *old_score)
 
 int get_best_xy_move(position *positions, int pos_num, int *son)
 {
-	int i, j;
-	position *p;
-	int best_pos = -1;
-	score_element best_score;
-
-	for (i = 0; i < pos_num; i++)
-	{
-		p = positions + i;
-		if (p->position_deadlocked) continue;
-
-		for (j = 0; j < p->moves_num; j++)
-		{
-			if (p->move_deadlocked[j]) continue;
-			if (p->place_in_positions[j]) continue;
-
-			if ((best_pos == -1) || (is_better_xy_score(p->scores + j, &best_score)))
-			{
-				best_pos = i;
-				*son = j;
-				best_score = p->scores[j];
-			}
-		}
-	}
-
-	return best_pos;
+	return best_frontier_move(positions, pos_num, son, is_better_xy_score);
 }
 
 void show_deadlocking(position* positions, int pos_num)
@@ -213,7 +189,7 @@ int xy_search_actual(board b, int pull_mode, int max_positions)
 	if ((res == IS_DEADLOCK) && (verbose >= 5))
 		show_deadlocking(positions, pos_num);
 
-	free_positions(positions, max_positions);
+	free_positions(positions);
 
 	return res;
 }